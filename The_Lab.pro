@@ -2,6 +2,7 @@ QT       += core gui
 QT += core gui widgets sql testlib
 QT += sql
 QT += core gui widgets sql
+QT += concurrent
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
@@ -11,16 +12,65 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    connectionmanager.cpp \
+    dbbackup.cpp \
+    dbwriter.cpp \
+    gamejournal.cpp \
+    historyfilter.cpp \
+    leaderboard.cpp \
     logicandsettings.cpp \
     login.cpp \
     mainwindow.cpp \
+    matcharchive.cpp \
+    matchexport.cpp \
+    matchimport.cpp \
+    matchhistorymodel.cpp \
+    matchlogstore.cpp \
+    memorymatchstore.cpp \
+    memoryuserstore.cpp \
+    migrations.cpp \
+    openingtrie.cpp \
+    schemamigrator.cpp \
     setupUI.cpp \
+    sqlitematchstore.cpp \
+    sqliteuserstore.cpp \
+    statementcache.cpp \
+    storagemetrics.cpp \
+    storageprofile.cpp \
     theme.cpp \
-    tictactoe.cpp
+    tictactoe.cpp \
+    timedstores.cpp
 
 HEADERS += \
+    connectionmanager.h \
+    dbbackup.h \
+    dbwriter.h \
+    gamebody.h \
+    gamejournal.h \
+    historyfilter.h \
+    leaderboard.h \
     mainwindow.h \
-    tictactoe.h
+    matcharchive.h \
+    matchexport.h \
+    matchimport.h \
+    matchhistorymodel.h \
+    matchlogstore.h \
+    matchrecord.h \
+    matchstore.h \
+    memorymatchstore.h \
+    memoryuserstore.h \
+    movecodec.h \
+    openingtrie.h \
+    ranktree.h \
+    schemamigrator.h \
+    sqlitematchstore.h \
+    sqliteuserstore.h \
+    statementcache.h \
+    storagemetrics.h \
+    storageprofile.h \
+    tictactoe.h \
+    timedstores.h \
+    userstore.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,86 @@
+#include "connectionmanager.h"
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <utility>
+
+ConnectionManager::ConnectionManager(const QString &databasePath, const StorageProfile &profile, const QString &prefix)
+    : path(databasePath), profile(profile), prefix(prefix), owner(QThread::currentThread()) {
+    this->profile.busyTimeoutMs = qMax(profile.busyTimeoutMs, MinBusyTimeoutMs);
+}
+
+ConnectionManager::~ConnectionManager() {
+    {
+        QMutexLocker locker(&mutex);
+        for (const QMetaObject::Connection &hook : std::as_const(finishHooks)) QObject::disconnect(hook);
+        finishHooks.clear();
+    }
+    close(connectionName());
+}
+
+QString ConnectionManager::connectionName() const {
+    QThread *thread = QThread::currentThread();
+    return thread == owner ? prefix : QString("%1_%2").arg(prefix).arg(reinterpret_cast<quintptr>(thread), 0, 16);
+}
+
+QSqlDatabase ConnectionManager::connection(QString *error) {
+    const QString name = connectionName();
+    if (QSqlDatabase::contains(name)) return QSqlDatabase::database(name, false);
+
+    QThread *thread = QThread::currentThread();
+    if (path == ":memory:" && thread != owner) {
+        if (error) *error = "An in-memory database can't be shared with another thread";
+        return QSqlDatabase();
+    }
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(path);
+    // Already set while opening, in case the file is locked right away
+    db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(profile.busyTimeoutMs));
+    QString problem;
+    if (!db.open()) {
+        problem = db.lastError().text();
+    } else {
+        profile.apply(db); // Logs a failure; the connection still works with SQLite's defaults
+        // The normalized schema relies on ON DELETE CASCADE
+        QSqlQuery pragma(db);
+        if (!pragma.exec("PRAGMA foreign_keys = ON")) problem = pragma.lastError().text();
+    }
+    if (!problem.isEmpty()) {
+        if (error) *error = problem;
+        db = QSqlDatabase();
+        close(name);
+        return QSqlDatabase();
+    }
+
+    if (thread != owner) {
+        QMutexLocker locker(&mutex);
+        // finished is emitted on the thread itself, which may still close its connection
+        finishHooks.insert(thread, QObject::connect(thread, &QThread::finished, thread, [this, thread, name]() {
+            {
+                QMutexLocker locker(&mutex);
+                finishHooks.remove(thread);
+            }
+            close(name);
+        }, Qt::DirectConnection));
+    }
+    return db;
+}
+
+void ConnectionManager::release() {
+    QThread *thread = QThread::currentThread();
+    {
+        QMutexLocker locker(&mutex);
+        QObject::disconnect(finishHooks.take(thread));
+    }
+    close(connectionName());
+}
+
+void ConnectionManager::close(const QString &name) {
+    if (!QSqlDatabase::contains(name)) return;
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
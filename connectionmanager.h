@@ -0,0 +1,58 @@
+#ifndef CONNECTIONMANAGER_H
+#define CONNECTIONMANAGER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include "storageprofile.h"
+
+class QThread;
+
+// One SQLite connection per thread to the same database file. Qt SQL
+// connections are thread-affine, so the GUI, the write-behind queue, the
+// archive and any worker (AI, analytics, history reads) each ask for
+// connection() on their own thread and get a named connection set up the
+// same way: the storage profile, a busy timeout of at least
+// MinBusyTimeoutMs and foreign_keys = ON. Under WAL (the "balanced"
+// default) readers and the writer don't block each other; the busy
+// timeout covers checkpoints and writer/writer overlap.
+//
+// The thread that creates the manager gets the prefix as its connection
+// name; other threads get "<prefix>_<thread>". A thread's connection is
+// closed by release() from that thread, or when its QThread finishes
+// (pool threads only finish when they expire, so tasks release() at the
+// end). Holders of the QSqlDatabase drop their copies first. The manager
+// must outlive the threads using it.
+//
+// In-memory databases are private to a connection: connection() refuses
+// them on any thread but the manager's own.
+class ConnectionManager {
+public:
+    static constexpr int MinBusyTimeoutMs = 5000;
+
+    ConnectionManager(const QString &databasePath, const StorageProfile &profile,
+                      const QString &prefix = QSqlDatabase::defaultConnection);
+    ~ConnectionManager(); // Releases the calling thread's connection
+
+    QString databasePath() const { return path; }
+    StorageProfile storageProfile() const { return profile; }
+
+    QSqlDatabase connection(QString *error = nullptr); // Invalid on failure
+    QString connectionName() const; // The calling thread's
+    void release();
+
+private:
+    Q_DISABLE_COPY(ConnectionManager)
+    static void close(const QString &name);
+
+    QString path;
+    StorageProfile profile;
+    QString prefix;
+    QThread *owner;
+    QMutex mutex;
+    QHash<QThread *, QMetaObject::Connection> finishHooks;
+};
+
+#endif // CONNECTIONMANAGER_H
@@ -0,0 +1,232 @@
+#include "dbbackup.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+
+DbBackup::DbBackup(const QString &databasePath, QObject *parent)
+    : QThread(parent), databasePath(databasePath) {}
+
+DbBackup::~DbBackup() {
+    stop();
+}
+
+void DbBackup::setSchedule(int newIntervalMs, int newKeep) {
+    QMutexLocker locker(&mutex);
+    intervalMs = newIntervalMs;
+    keep = qMax(1, newKeep);
+    wake.wakeAll();
+}
+
+// Returns false for "off"; the outputs get the defaults either way
+bool DbBackup::scheduleFromString(const QString &text, int *intervalMs, int *keep) {
+    *intervalMs = 60 * 60 * 1000;
+    *keep = 5;
+    const QString value = text.trimmed().toLower();
+    if (value == "off") return false;
+
+    bool ok = false;
+    const int minutes = value.section(':', 0, 0).toInt(&ok);
+    if (ok && minutes > 0) *intervalMs = minutes * 60 * 1000;
+    const int count = value.section(':', 1).toInt(&ok);
+    if (ok && count > 0) *keep = count;
+    return true;
+}
+
+void DbBackup::requestSnapshot() {
+    QMutexLocker locker(&mutex);
+    requested = true;
+    wake.wakeOne();
+}
+
+void DbBackup::stop() {
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        wake.wakeAll();
+    }
+    wait(); // A snapshot in progress is finished, not abandoned
+}
+
+void DbBackup::run() {
+    QMutexLocker locker(&mutex);
+    while (!stopping) {
+        bool due = requested;
+        if (!due) {
+            if (intervalMs > 0) {
+                due = !wake.wait(&mutex, static_cast<unsigned long>(intervalMs)); // Timed out
+            } else {
+                wake.wait(&mutex);
+            }
+            due = due || requested;
+        }
+        if (stopping) break;
+        if (!due) continue; // Woken by a schedule change
+
+        requested = false;
+        const int keepCount = keep;
+        locker.unlock();
+        QString path;
+        QString error;
+        if (snapshot(databasePath, keepCount, &path, &error)) {
+            emit snapshotTaken(path);
+        } else {
+            qWarning() << "DbBackup: snapshot of" << databasePath << "failed:" << error;
+            emit snapshotFailed(error);
+        }
+        locker.relock();
+    }
+}
+
+QString DbBackup::backupDirectory(const QString &databasePath) {
+    return databasePath + "-backups";
+}
+
+// Names embed the UTC time, so name order is age order
+QStringList DbBackup::snapshots(const QString &databasePath) {
+    QDir dir(backupDirectory(databasePath));
+    QStringList paths;
+    for (const QString &name : dir.entryList({"*.db"}, QDir::Files, QDir::Name)) {
+        paths << dir.filePath(name);
+    }
+    return paths;
+}
+
+bool DbBackup::snapshot(const QString &databasePath, int keep, QString *snapshotPath, QString *error) {
+    if (!QFileInfo::exists(databasePath)) {
+        if (error) *error = databasePath + " does not exist";
+        return false;
+    }
+    QDir dir(backupDirectory(databasePath));
+    if (!dir.mkpath(".")) {
+        if (error) *error = "cannot create " + dir.path();
+        return false;
+    }
+    QString target;
+    do {
+        if (!target.isEmpty()) QThread::msleep(1); // Two snapshots within a millisecond
+        target = dir.filePath(QFileInfo(databasePath).completeBaseName() + "-" +
+                              QDateTime::currentDateTimeUtc().toString("yyyyMMdd-HHmmss-zzz") + ".db");
+    } while (QFileInfo::exists(target));
+    const QString part = target + ".part";
+    QFile::remove(part); // Left over from a crash mid-snapshot
+
+    // Qt SQL connections are thread-affine, so every caller gets its own
+    const QString connectionName = QString("db_backup_%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+    QString problem;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databasePath);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            problem = db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            if (!query.exec(QString("VACUUM INTO '%1'").arg(QString(part).replace('\'', "''")))) {
+                problem = query.lastError().text();
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (problem.isEmpty() && verify(part, &problem) && !QFile::rename(part, target)) {
+        problem = "cannot rename " + part;
+    }
+    if (!problem.isEmpty()) {
+        if (error) *error = problem;
+        QFile::remove(part);
+        return false;
+    }
+    if (snapshotPath) *snapshotPath = target;
+    prune(databasePath, keep);
+    return true;
+}
+
+void DbBackup::prune(const QString &databasePath, int keep) {
+    QStringList paths = snapshots(databasePath);
+    while (paths.size() > qMax(1, keep)) {
+        QFile::remove(paths.takeFirst());
+    }
+}
+
+bool DbBackup::verify(const QString &path, QString *error) {
+    if (!QFileInfo::exists(path)) {
+        if (error) *error = path + " does not exist";
+        return false;
+    }
+
+    const QString connectionName = QString("db_verify_%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+    QString problem;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(path);
+        if (!db.open()) {
+            problem = db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            if (!query.exec("PRAGMA integrity_check")) {
+                problem = query.lastError().text(); // e.g. "file is not a database"
+            } else {
+                QStringList messages;
+                while (query.next()) messages << query.value(0).toString();
+                if (messages != QStringList{"ok"}) problem = messages.join("; ");
+            }
+            if (problem.isEmpty() && (!query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'matches'")
+                                      || !query.next())) {
+                problem = "no matches table";
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (!problem.isEmpty()) {
+        if (error) *error = path + ": " + problem;
+        return false;
+    }
+    return true;
+}
+
+// Derived files keyed to the old match ids (<db>-openings) are dropped so
+// they are rebuilt from the restored matches.
+bool DbBackup::restore(const QString &snapshotPath, const QString &databasePath, QString *error) {
+    if (!verify(snapshotPath, error)) return false;
+
+    const QString staging = databasePath + "-restore";
+    QFile::remove(staging);
+    if (!QFile::copy(snapshotPath, staging)) {
+        if (error) *error = "cannot copy " + snapshotPath + " to " + staging;
+        return false;
+    }
+    if (!verify(staging, error)) {
+        QFile::remove(staging);
+        return false;
+    }
+
+    // The live database moves aside together with its WAL, never half of it
+    const QString replaced = databasePath + "-replaced";
+    const QStringList suffixes = {"", "-wal", "-shm"};
+    for (const QString &suffix : suffixes) QFile::remove(replaced + suffix);
+    if (QFileInfo::exists(databasePath)) {
+        for (const QString &suffix : suffixes) {
+            if (QFileInfo::exists(databasePath + suffix) && !QFile::rename(databasePath + suffix, replaced + suffix)) {
+                if (error) *error = "cannot move " + databasePath + suffix + " aside (is the game still running?)";
+                for (const QString &undo : suffixes) QFile::rename(replaced + undo, databasePath + undo);
+                QFile::remove(staging);
+                return false;
+            }
+        }
+    }
+    if (!QFile::rename(staging, databasePath)) {
+        if (error) *error = "cannot move " + staging + " into place";
+        for (const QString &undo : suffixes) QFile::rename(replaced + undo, databasePath + undo);
+        return false;
+    }
+    QFile::remove(databasePath + "-openings");
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef DBBACKUP_H
+#define DBBACKUP_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+
+// Online snapshots of the database, taken while the game keeps running.
+//
+// A snapshot is a VACUUM INTO from a dedicated thread and connection: one
+// read transaction produces a compact, consistent copy. Under WAL (every
+// profile but "default") that never blocks the GUI or the write-behind
+// queue. Snapshots go to <db>-backups/<name>-<UTC time>.db; they are
+// written as .part, integrity-checked, then renamed, so anything listed
+// there is complete. After each snapshot only the newest `keep` are kept.
+//
+// Restoring is done with the application closed (see --restore in main):
+// the snapshot is verified, copied next to the database, verified again
+// and swapped in; the replaced database is kept as <db>-replaced.
+class DbBackup : public QThread {
+    Q_OBJECT
+public:
+    explicit DbBackup(const QString &databasePath, QObject *parent = nullptr);
+    ~DbBackup() override;
+
+    // intervalMs <= 0: only on request
+    void setSchedule(int intervalMs, int keep);
+    // "off", "<minutes>" or "<minutes>:<keep>"; defaults to hourly, keeping 5
+    static bool scheduleFromString(const QString &text, int *intervalMs, int *keep);
+
+    void requestSnapshot();
+    void stop();
+
+    // Synchronous building blocks, also used headless by main
+    static QString backupDirectory(const QString &databasePath);
+    static QStringList snapshots(const QString &databasePath); // Oldest first
+    static bool snapshot(const QString &databasePath, int keep, QString *snapshotPath, QString *error = nullptr);
+    static bool verify(const QString &path, QString *error = nullptr);
+    static bool restore(const QString &snapshotPath, const QString &databasePath, QString *error = nullptr);
+
+signals:
+    void snapshotTaken(const QString &path);
+    void snapshotFailed(const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    static void prune(const QString &databasePath, int keep);
+
+    QString databasePath;
+    QMutex mutex;
+    QWaitCondition wake;
+    int intervalMs = 0;
+    int keep = 5;
+    bool requested = false;
+    bool stopping = false;
+};
+
+#endif // DBBACKUP_H
@@ -0,0 +1,387 @@
+#include "dbwriter.h"
+#include "gamebody.h"
+#include "storagemetrics.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QUuid>
+#include <QDebug>
+
+DbWriter::DbWriter(const QString &databasePath, int capacity, QObject *parent)
+    : QThread(parent), databasePath(databasePath), capacity(qMax(1, capacity)),
+      journal(databasePath + "-pending") {
+    // Crash recovery: rows that never made it into a committed transaction
+    // are queued again ahead of anything new.
+    if (journal.open(QIODevice::ReadOnly)) {
+        while (!journal.atEnd()) {
+            MatchRecord record;
+            if (recordFromJson(journal.readLine().trimmed(), &record)) {
+                // Tails written before client ids existed get one now, kept by the rewrite below
+                if (record.clientId.isEmpty()) record.clientId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+                pending.enqueue(record);
+            }
+        }
+        journal.close();
+        recoveredCount = pending.size();
+        uncommitted = pending.size();
+        if (recoveredCount > 0) {
+            qDebug() << "DbWriter: replaying" << recoveredCount << "uncommitted game(s) from" << journal.fileName();
+        }
+    }
+    // Rewrite the recovered rows so a torn last line can't swallow new ones
+    if (journal.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        for (const MatchRecord &record : pending) {
+            journal.write(recordToJson(record));
+        }
+        journal.flush();
+    } else {
+        qWarning() << "DbWriter: could not open pending journal" << journal.fileName();
+    }
+}
+
+DbWriter::~DbWriter() {
+    stop();
+    if (journal.isOpen() && journal.size() == 0) {
+        journal.remove();
+    }
+}
+
+void DbWriter::setFlushPolicy(FlushPolicy newPolicy, int newIntervalMs) {
+    QMutexLocker locker(&mutex);
+    policy = newPolicy;
+    intervalMs = qMax(1, newIntervalMs);
+    notEmpty.wakeAll();
+}
+
+void DbWriter::setStorageProfile(const StorageProfile &profile) {
+    storageProfile = profile;
+}
+
+void DbWriter::setConnections(ConnectionManager *manager) {
+    connections = manager;
+}
+
+// "game", "series" or "interval:<ms>"
+DbWriter::FlushPolicy DbWriter::policyFromString(const QString &text, int *intervalMs) {
+    const QString value = text.trimmed().toLower();
+    if (value == "series") return FlushPolicy::PerSeries;
+    if (value.startsWith("interval")) {
+        if (intervalMs) {
+            bool ok = false;
+            int ms = value.section(':', 1).toInt(&ok);
+            *intervalMs = (ok && ms > 0) ? ms : 250;
+        }
+        return FlushPolicy::Interval;
+    }
+    return FlushPolicy::PerGame;
+}
+
+void DbWriter::enqueue(const MatchRecord &queued) {
+    MatchRecord record = queued;
+    record.clientId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    QMutexLocker locker(&mutex);
+    while (pending.size() >= capacity && !stopping) {
+        notFull.wait(&mutex); // Back-pressure: wait for the writer to catch up
+    }
+    if (journal.isOpen()) {
+        // No fsync here: the journal only has to survive a process crash
+        journal.write(recordToJson(record));
+        journal.flush();
+    }
+    pending.enqueue(record);
+    uncommitted++;
+    notEmpty.wakeOne();
+}
+
+void DbWriter::endSeries() {
+    QMutexLocker locker(&mutex);
+    commitRequested = true;
+    notEmpty.wakeOne();
+}
+
+void DbWriter::flush() {
+    QMutexLocker locker(&mutex);
+    if (!isRunning()) return;
+    commitRequested = true;
+    notEmpty.wakeOne();
+    while (uncommitted > 0) {
+        drained.wait(&mutex);
+    }
+}
+
+void DbWriter::stop() {
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        notEmpty.wakeAll();
+        notFull.wakeAll();
+    }
+    wait(); // run() commits everything before returning
+}
+
+const char *const DbWriter::SERIES_INSERT_QUERY =
+    "INSERT OR IGNORE INTO series (series_key, total, target, game_mode) "
+    "VALUES (:series_id, :series_total, :series_target, :game_mode)";
+
+const char *const DbWriter::BODY_INSERT_QUERY =
+    "INSERT OR IGNORE INTO game_bodies (hash, moves_blob) VALUES (:hash, :body)";
+
+// Names are kept for display (AI and guest opponents have no account);
+// registered players are linked by id for history lookups and cascades.
+const char *const DbWriter::MATCH_INSERT_QUERY =
+    "INSERT INTO matches "
+    "(player1, player2, player1_id, player2_id, winner, result, body_id, body_symmetry, played_at, timestamp, "
+    "starting_player, game_mode, difficulty, series_ref, game_number, client_id) "
+    "VALUES (:player1, :player2, "
+    "(SELECT id FROM users WHERE username = :player1), "
+    "(SELECT id FROM users WHERE username = :player2), "
+    ":winner, :result, (SELECT id FROM game_bodies WHERE hash = :hash), :symmetry, "
+    ":played_at, :timestamp, :starting_player, :game_mode, :difficulty, "
+    "(SELECT id FROM series WHERE series_key = :series_id), :game_number, :client_id)";
+
+bool DbWriter::insertRecord(QSqlDatabase &db, const MatchRecord &record, QString *error) {
+    QSqlQuery series(db);
+    QSqlQuery body(db);
+    QSqlQuery match(db);
+    if (!series.prepare(SERIES_INSERT_QUERY) || !body.prepare(BODY_INSERT_QUERY) || !match.prepare(MATCH_INSERT_QUERY)) {
+        if (error) *error = (series.lastError().isValid() ? series : body.lastError().isValid() ? body : match).lastError().text();
+        return false;
+    }
+    return insertRecord(series, body, match, record, error);
+}
+
+bool DbWriter::insertRecord(QSqlQuery &series, QSqlQuery &body, QSqlQuery &match,
+                            const MatchRecord &record, QString *error) {
+    // Series settings are stored once per series, not on every game row
+    if (!record.seriesId.isEmpty()) {
+        series.bindValue(":series_id", record.seriesId);
+        series.bindValue(":series_total", record.seriesTotal);
+        series.bindValue(":series_target", record.seriesTarget);
+        series.bindValue(":game_mode", record.gameMode);
+        if (!series.exec()) {
+            if (error) *error = series.lastError().text();
+            return false;
+        }
+    }
+
+    // Moves are stored once per distinct game up to symmetry (see gamebody.h)
+    const GameBody::Canonical canonical = GameBody::canonicalize(record.moves);
+    body.bindValue(":hash", canonical.hash);
+    body.bindValue(":body", canonical.body);
+    if (!body.exec()) {
+        if (error) *error = body.lastError().text();
+        return false;
+    }
+
+    match.bindValue(":player1", record.player1);
+    match.bindValue(":player2", record.player2);
+    match.bindValue(":winner", record.winner);
+    match.bindValue(":result", record.result);
+    match.bindValue(":hash", canonical.hash);
+    match.bindValue(":symmetry", canonical.symmetry); // moves_blob and the legacy TEXT column stay NULL
+    // Text that doesn't parse is kept for display and sorts as the oldest
+    // (played_at 0), as the played_at backfill leaves legacy rows
+    const qint64 playedAt = playedAtOf(record);
+    match.bindValue(":played_at", playedAt);
+    match.bindValue(":timestamp", playedAt != 0 ? QVariant() : QVariant(record.timestamp));
+    match.bindValue(":starting_player", record.startingPlayer);
+    match.bindValue(":game_mode", record.gameMode);
+    match.bindValue(":difficulty", record.difficulty > 0 ? QVariant(record.difficulty) : QVariant());
+    match.bindValue(":series_id", record.seriesId.isEmpty() ? QVariant() : QVariant(record.seriesId));
+    match.bindValue(":game_number", record.seriesId.isEmpty() ? QVariant() : QVariant(record.gameNumber));
+    match.bindValue(":client_id", record.clientId.isEmpty() ? QVariant() : QVariant(record.clientId));
+
+    if (!match.exec()) {
+        if (error) *error = match.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DbWriter::commitBatch(QSqlDatabase &db, StatementCache &statements, const QList<MatchRecord> &batch, int recovered,
+                           QString *error) {
+    if (!db.transaction()) {
+        *error = db.lastError().text();
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < batch.size() && ok; ++i) {
+        const MatchRecord &record = batch[i];
+        if (i < recovered) {
+            // A crash between COMMIT and journal truncation leaves rows that
+            // are already stored; skip those instead of duplicating them.
+            StatementCache::Statement exists = statements.statement(
+                "SELECT 1 FROM matches WHERE client_id = :client_id");
+            exists->bindValue(":client_id", record.clientId);
+            if (!exists->exec()) {
+                *error = exists->lastError().text();
+                ok = false;
+                break;
+            }
+            if (exists->next()) continue;
+        }
+        StatementCache::Statement series = statements.statement(SERIES_INSERT_QUERY);
+        StatementCache::Statement body = statements.statement(BODY_INSERT_QUERY);
+        StatementCache::Statement match = statements.statement(MATCH_INSERT_QUERY);
+        ok = insertRecord(*series, *body, *match, record, error);
+    }
+
+    if (ok && !db.commit()) {
+        *error = db.lastError().text();
+        ok = false;
+    }
+    if (!ok) db.rollback();
+    return ok;
+}
+
+// Called with the mutex held after a commit: the journal keeps rows from
+// failed batches (replayed on next start) and rows that are still queued.
+void DbWriter::rewriteJournal() {
+    if (!journal.isOpen()) return;
+    journal.resize(0);
+    journal.seek(0);
+    for (const MatchRecord &record : std::as_const(failed)) {
+        journal.write(recordToJson(record));
+    }
+    for (const MatchRecord &record : pending) {
+        journal.write(recordToJson(record));
+    }
+    journal.flush();
+}
+
+void DbWriter::run() {
+    // Qt SQL connections are thread-affine, so the writer's thread gets its own.
+    ConnectionManager ownConnections(databasePath, storageProfile,
+                                     QString("db_writer_%1").arg(reinterpret_cast<quintptr>(this)));
+    ConnectionManager &manager = connections ? *connections : ownConnections;
+    {
+        QString openError;
+        QSqlDatabase db = manager.connection(&openError);
+        bool opened = db.isValid();
+        StatementCache statements(db); // Inserts are prepared once for the writer's lifetime
+        if (!opened) {
+            emit writeFailed("Failed to open database for writing: " + openError);
+        }
+
+        QList<MatchRecord> held;   // Drained but not yet committed
+        int heldRecovered = 0;
+        QElapsedTimer heldSince;
+
+        forever {
+            bool commitNow = false;
+            bool exiting = false;
+            {
+                QMutexLocker locker(&mutex);
+                forever {
+                    while (!pending.isEmpty()) {
+                        if (recoveredCount > 0) {
+                            recoveredCount--;
+                            heldRecovered++;
+                        }
+                        if (held.isEmpty()) heldSince.start();
+                        held.append(pending.dequeue());
+                    }
+                    notFull.wakeAll();
+
+                    exiting = stopping;
+                    if (held.isEmpty()) {
+                        commitRequested = false;
+                        if (exiting) break;
+                        notEmpty.wait(&mutex);
+                        continue;
+                    }
+
+                    if (exiting || commitRequested || policy == FlushPolicy::PerGame) {
+                        commitNow = true;
+                    } else if (policy == FlushPolicy::Interval) {
+                        qint64 remaining = intervalMs - heldSince.elapsed();
+                        if (remaining <= 0) {
+                            commitNow = true;
+                        } else {
+                            notEmpty.wait(&mutex, static_cast<unsigned long>(remaining));
+                            continue;
+                        }
+                    } else {
+                        notEmpty.wait(&mutex); // PerSeries: wait for endSeries()/flush()
+                        continue;
+                    }
+                    commitRequested = false;
+                    break;
+                }
+            }
+            if (!commitNow) break; // Stopping with nothing left to write
+
+            QString error = "Database is not open.";
+            bool ok = false;
+            if (opened) {
+                StorageMetrics::Timer timer("commit batch");
+                ok = commitBatch(db, statements, held, heldRecovered, &error);
+            }
+            if (!ok) {
+                qWarning() << "DbWriter: failed to save" << held.size() << "game(s):" << error;
+                emit writeFailed("Failed to save game result: " + error);
+            }
+
+            QMutexLocker locker(&mutex);
+            if (!ok) failed.append(held);
+            uncommitted -= held.size();
+            held.clear();
+            heldRecovered = 0;
+            rewriteJournal();
+            drained.wakeAll();
+        }
+    }
+    manager.release();
+
+    QMutexLocker locker(&mutex);
+    drained.wakeAll();
+}
+
+QByteArray DbWriter::recordToJson(const MatchRecord &record) {
+    QJsonObject object;
+    object["player1"] = record.player1;
+    object["player2"] = record.player2;
+    object["winner"] = record.winner;
+    object["result"] = record.result;
+    object["moves_blob"] = QString::fromLatin1(record.moves.toBase64());
+    object["timestamp"] = record.timestamp;
+    object["starting_player"] = record.startingPlayer;
+    object["game_mode"] = record.gameMode;
+    object["difficulty"] = record.difficulty;
+    object["series_id"] = record.seriesId;
+    object["game_number"] = record.gameNumber;
+    object["series_total"] = record.seriesTotal;
+    object["series_target"] = record.seriesTarget;
+    object["client_id"] = record.clientId;
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool DbWriter::recordFromJson(const QByteArray &line, MatchRecord *record) {
+    if (line.isEmpty()) return false;
+    QJsonDocument document = QJsonDocument::fromJson(line);
+    if (!document.isObject()) return false; // Torn last line after a crash
+
+    QJsonObject object = document.object();
+    record->player1 = object["player1"].toString();
+    record->player2 = object["player2"].toString();
+    record->winner = object["winner"].toString();
+    record->result = object["result"].toString();
+    if (object.contains("moves_blob")) {
+        record->moves = QByteArray::fromBase64(object["moves_blob"].toString().toLatin1());
+    } else {
+        record->moves = encodeMovesText(object["moves"].toString()); // Pre-BLOB journal
+    }
+    record->timestamp = object["timestamp"].toString();
+    record->startingPlayer = object["starting_player"].toString();
+    record->gameMode = object["game_mode"].toString();
+    record->difficulty = object["difficulty"].toInt();
+    record->seriesId = object["series_id"].toString();
+    record->gameNumber = object["game_number"].toInt();
+    record->seriesTotal = object["series_total"].toInt();
+    record->seriesTarget = object["series_target"].toInt();
+    record->clientId = object["client_id"].toString();
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef DBWRITER_H
+#define DBWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include "connectionmanager.h"
+#include "matchrecord.h"
+#include "statementcache.h"
+#include "storageprofile.h"
+
+// Write-behind queue for match persistence.
+// The GUI thread enqueues finished games; a dedicated thread with its own
+// SQLite connection commits them in explicit transactions according to the
+// flush policy. The queue is bounded: enqueue() blocks when it is full
+// (back-pressure), and flush()/the destructor wait until every queued row
+// is committed.
+//
+// Every enqueued row is also appended to a "pending tail" journal next to
+// the database (<db>-pending) and dropped from it once committed, so rows
+// held for a per-series or timed batch survive a crash and are replayed
+// the next time a writer is created for that database. Rows of a batch
+// that fails to commit stay in it until then. Each row gets a unique
+// client id when queued, stored with it (matches.client_id), so a tail
+// that outlived its commit is skipped rather than stored twice.
+class DbWriter : public QThread {
+    Q_OBJECT
+public:
+    enum class FlushPolicy {
+        PerGame,   // Commit as soon as rows arrive (coalescing whatever is queued)
+        PerSeries, // Hold rows until endSeries()/flush()
+        Interval   // Commit at most every intervalMs
+    };
+
+    explicit DbWriter(const QString &databasePath, int capacity = 1024, QObject *parent = nullptr);
+    ~DbWriter() override;
+
+    void setFlushPolicy(FlushPolicy policy, int intervalMs = 250);
+    void setStorageProfile(const StorageProfile &profile); // Call before start()
+    // Call before start(); the writer's thread takes its connection from the
+    // manager instead of opening one with the storage profile
+    void setConnections(ConnectionManager *connections);
+    static FlushPolicy policyFromString(const QString &text, int *intervalMs);
+
+    void enqueue(const MatchRecord &record);
+    void endSeries();
+    void flush();
+    void stop();
+
+    // Synchronous INSERT used by the writer thread and by callers that
+    // can't hand their connection over (e.g. ":memory:" databases).
+    static bool insertRecord(QSqlDatabase &db, const MatchRecord &record, QString *error = nullptr);
+
+    // The three statements behind insertRecord(), for callers that insert
+    // many rows and prepare them once (see MatchImport and the writer thread).
+    static const char *const SERIES_INSERT_QUERY;
+    static const char *const BODY_INSERT_QUERY;
+    static const char *const MATCH_INSERT_QUERY;
+    static bool insertRecord(QSqlQuery &series, QSqlQuery &body, QSqlQuery &match,
+                             const MatchRecord &record, QString *error = nullptr);
+
+signals:
+    void writeFailed(const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    bool commitBatch(QSqlDatabase &db, StatementCache &statements, const QList<MatchRecord> &batch, int recoveredCount,
+                     QString *error);
+    void rewriteJournal();
+    static QByteArray recordToJson(const MatchRecord &record);
+    static bool recordFromJson(const QByteArray &line, MatchRecord *record);
+
+    QString databasePath;
+    int capacity;
+    StorageProfile storageProfile;
+    ConnectionManager *connections = nullptr;
+    FlushPolicy policy = FlushPolicy::PerGame;
+    int intervalMs = 250;
+
+    QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    QWaitCondition drained;
+    QQueue<MatchRecord> pending;
+    QFile journal;
+    int uncommitted = 0;     // Queued + held rows not yet committed
+    int recoveredCount = 0;  // Rows at the front of the queue replayed from the journal
+    QList<MatchRecord> failed; // Rows of failed batches, kept in the journal
+    bool commitRequested = false;
+    bool stopping = false;
+};
+
+#endif // DBWRITER_H
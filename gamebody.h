@@ -0,0 +1,111 @@
+#ifndef GAMEBODY_H
+#define GAMEBODY_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QVariant>
+#include <vector>
+#include "matchrecord.h"
+
+// Content-addressed game bodies (the game_bodies table).
+//
+// A match's move sequence is stored once per distinct game up to symmetry:
+// the sequence is mapped through all 8 rotations/reflections of the board,
+// the lexicographically smallest image is the canonical body, and the match
+// row keeps only body_id plus the symmetry index that maps its own moves
+// onto the body. Bodies are keyed by a hash of the canonical encoding and
+// reference-counted by triggers on matches.
+namespace GameBody {
+
+constexpr int HashSize = 16; // Truncated SHA-256
+
+struct Canonical {
+    QByteArray body;  // MoveCodec blob of the canonical sequence
+    QByteArray hash;
+    int symmetry = 0; // body == transform(symmetry, moves)
+};
+
+// Symmetry t of an n x n board applied to one cell
+inline int transformCell(int t, int cell, int side) {
+    const int r = cell / side, c = cell % side, m = side - 1;
+    switch (t) {
+    case 1: return c * side + (m - r);       // rotate 90
+    case 2: return (m - r) * side + (m - c); // rotate 180
+    case 3: return (m - c) * side + r;       // rotate 270
+    case 4: return r * side + (m - c);       // mirror left-right
+    case 5: return (m - r) * side + c;       // mirror top-bottom
+    case 6: return c * side + r;             // main diagonal
+    case 7: return (m - c) * side + (m - r); // anti-diagonal
+    default: return cell;
+    }
+}
+
+inline int inverseSymmetry(int t) {
+    return t == 1 ? 3 : t == 3 ? 1 : t; // Only the quarter turns aren't self-inverse
+}
+
+inline bool decodeWithSide(const QByteArray &blob, std::vector<int> *moves, int *side) {
+    moves->resize(blob.size() * 2);
+    const int count = MoveCodec::decode(reinterpret_cast<const unsigned char *>(blob.constData()), blob.size(),
+                                        moves->data(), static_cast<int>(moves->size()), side);
+    if (count < 0) return false;
+    moves->resize(count);
+    return true;
+}
+
+inline QByteArray encodeWithSide(const std::vector<int> &moves, int side) {
+    QByteArray blob(MoveCodec::maxEncodedSize(static_cast<int>(moves.size()), side), Qt::Uninitialized);
+    const int size = MoveCodec::encode(moves.data(), static_cast<int>(moves.size()), side,
+                                       reinterpret_cast<unsigned char *>(blob.data()), blob.size());
+    blob.truncate(qMax(0, size));
+    return blob;
+}
+
+// An undecodable blob is stored as its own body under the identity symmetry
+inline Canonical canonicalize(const QByteArray &movesBlob) {
+    Canonical result;
+    std::vector<int> moves;
+    int side = 0;
+    if (!decodeWithSide(movesBlob, &moves, &side)) {
+        result.body = movesBlob;
+    } else {
+        std::vector<int> best = moves, image(moves.size());
+        for (int t = 1; t < 8; ++t) {
+            for (size_t i = 0; i < moves.size(); ++i) image[i] = transformCell(t, moves[i], side);
+            if (image < best) {
+                best = image;
+                result.symmetry = t;
+            }
+        }
+        result.body = encodeWithSide(best, side);
+    }
+    result.hash = QCryptographicHash::hash(result.body, QCryptographicHash::Sha256).left(HashSize);
+    return result;
+}
+
+// The match's own moves from its body and symmetry index
+inline QByteArray restore(const QByteArray &body, int symmetry) {
+    std::vector<int> moves;
+    int side = 0;
+    if (symmetry == 0 || !decodeWithSide(body, &moves, &side)) return body;
+    const int inverse = inverseSymmetry(symmetry);
+    for (int &cell : moves) cell = transformCell(inverse, cell, side);
+    return encodeWithSide(moves, side);
+}
+
+// Readers select MovesColumns (joined with BodyJoin) and hand the four
+// values here; rows not yet moved to game_bodies fall back to moves_blob,
+// then to the legacy TEXT column.
+constexpr const char *MovesColumns = "b.moves_blob, m.body_symmetry, m.moves_blob, m.moves";
+constexpr const char *BodyJoin = "LEFT JOIN game_bodies b ON b.id = m.body_id";
+
+inline QByteArray movesFromColumns(const QVariant &body, const QVariant &symmetry,
+                                   const QVariant &movesBlob, const QVariant &movesText) {
+    if (!body.isNull()) return restore(body.toByteArray(), symmetry.toInt());
+    if (!movesBlob.isNull()) return movesBlob.toByteArray();
+    return encodeMovesText(movesText.toString());
+}
+
+} // namespace GameBody
+
+#endif // GAMEBODY_H
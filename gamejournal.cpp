@@ -0,0 +1,106 @@
+#include "gamejournal.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+void GameJournal::setPath(const QString &journalPath) {
+    file.close();
+    path = journalPath;
+    unsyncedMoves = 0;
+}
+
+// QSaveFile syncs before its atomic rename, so a state line is never torn
+void GameJournal::writeState(const State &state) {
+    if (!isEnabled()) return;
+    QJsonObject object;
+    object["user"] = state.user;
+    object["guest"] = state.guest;
+    object["mode"] = state.mode;
+    object["difficulty"] = state.difficulty;
+    object["player1"] = state.player1;
+    object["player2"] = state.player2;
+    object["total"] = state.totalGames;
+    object["target"] = state.gamesToWin;
+    object["series"] = state.seriesId;
+    object["player1_wins"] = state.player1Wins;
+    object["player2_wins"] = state.player2Wins;
+    object["ties"] = state.ties;
+    object["starter"] = QString(QChar::fromLatin1(state.startingPlayer));
+    object["between"] = state.betweenGames;
+
+    file.close();
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)
+        || out.write(QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n') < 0
+        || !out.commit()) {
+        qWarning() << "GameJournal: could not write" << path << out.errorString();
+        return;
+    }
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "GameJournal: could not open" << path << file.errorString();
+    }
+    unsyncedMoves = 0;
+    sinceSync.start();
+}
+
+void GameJournal::appendMove(int cell) {
+    if (!file.isOpen()) return;
+    file.write(QByteArray("{\"m\":") + QByteArray::number(cell) + "}\n");
+    file.flush(); // Survives a process crash from here on
+    if (++unsyncedMoves >= SyncEveryMoves || sinceSync.elapsed() >= SyncIntervalMs) sync();
+}
+
+void GameJournal::sync() {
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    ::fsync(file.handle());
+#endif
+    unsyncedMoves = 0;
+    sinceSync.restart();
+}
+
+void GameJournal::discard() {
+    file.close();
+    if (isEnabled()) QFile::remove(path);
+}
+
+bool GameJournal::load(State *state) const {
+    if (!isEnabled()) return false;
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly)) return false;
+
+    const QJsonDocument header = QJsonDocument::fromJson(in.readLine().trimmed());
+    if (!header.isObject()) return false;
+    const QJsonObject object = header.object();
+    state->user = object["user"].toString();
+    state->guest = object["guest"].toBool();
+    state->mode = object["mode"].toInt(1);
+    state->difficulty = object["difficulty"].toInt(3);
+    state->player1 = object["player1"].toString();
+    state->player2 = object["player2"].toString();
+    state->totalGames = object["total"].toInt(3);
+    state->gamesToWin = object["target"].toInt(2);
+    state->seriesId = object["series"].toString();
+    state->player1Wins = object["player1_wins"].toInt();
+    state->player2Wins = object["player2_wins"].toInt();
+    state->ties = object["ties"].toInt();
+    const QString starter = object["starter"].toString();
+    state->startingPlayer = starter.isEmpty() ? 'X' : starter.at(0).toLatin1();
+    state->betweenGames = object["between"].toBool();
+
+    state->moves.clear();
+    while (!state->betweenGames && !in.atEnd()) {
+        const QJsonDocument move = QJsonDocument::fromJson(in.readLine().trimmed());
+        if (!move.isObject() || !move.object().contains("m")) break; // Torn last line after a crash
+        state->moves.push_back(move.object()["m"].toInt());
+    }
+    return !state->user.isEmpty();
+}
@@ -0,0 +1,62 @@
+#ifndef GAMEJOURNAL_H
+#define GAMEJOURNAL_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <vector>
+
+// Crash-safe record of the series being played (<db>-game-<player>).
+//
+// The file is one JSON line with the series state as of the start of the
+// current game, followed by one short line per move. The state line is
+// rewritten (and synced) at every game boundary, so the file never holds
+// more than one game's moves. Moves are appended as they are made and
+// fsynced in batches: once SyncEveryMoves moves are pending, or when the
+// previous sync is more than SyncIntervalMs old. That bounds both the
+// per-move cost (a ~10 byte append plus an amortized fsync) and what a
+// power loss can take back.
+//
+// A torn last line is ignored on load, so a crash mid-append only loses
+// that move.
+class GameJournal {
+public:
+    static constexpr int SyncEveryMoves = 4;
+    static constexpr int SyncIntervalMs = 1000;
+
+    struct State {
+        QString user;
+        bool guest = false;
+        int mode = 1;       // 1: PvP, 2: PvAI
+        int difficulty = 3;
+        QString player1;
+        QString player2;
+        int totalGames = 3;
+        int gamesToWin = 2;
+        QString seriesId;
+        int player1Wins = 0;
+        int player2Wins = 0;
+        int ties = 0;
+        char startingPlayer = 'X'; // Of the current game
+        bool betweenGames = false; // The last game is scored and the next hasn't started
+        std::vector<int> moves;    // Of the current game
+    };
+
+    void setPath(const QString &path); // Empty disables the journal
+    bool isEnabled() const { return !path.isEmpty(); }
+
+    void writeState(const State &state);
+    void appendMove(int cell);
+    void discard();
+    bool load(State *state) const; // false if there is no usable journal
+
+private:
+    void sync();
+
+    QString path;
+    QFile file; // Open for appending moves after writeState()
+    int unsyncedMoves = 0;
+    QElapsedTimer sinceSync;
+};
+
+#endif // GAMEJOURNAL_H
@@ -0,0 +1,98 @@
+#include "historyfilter.h"
+#include <QDate>
+#include <QDateTime>
+#include <QRegularExpression>
+
+namespace {
+
+// Case-folded runs of letters and digits, roughly as FTS5's unicode61
+// tokenizer splits the match_search columns
+QStringList words(const QString &text) {
+    static const QRegularExpression separators(R"([^\p{L}\p{N}]+)");
+    return text.toCaseFolded().split(separators, Qt::SkipEmptyParts);
+}
+
+// The FTS5 query "term"*: the term's words in a row, the last one a prefix
+bool containsPrefixPhrase(const QString &text, const QStringList &phrase) {
+    if (phrase.isEmpty()) return false;
+    const QStringList field = words(text);
+    for (qsizetype start = 0; start + phrase.size() <= field.size(); ++start) {
+        qsizetype i = 0;
+        while (i + 1 < phrase.size() && field[start + i] == phrase[i]) ++i;
+        if (i + 1 == phrase.size() && field[start + i].startsWith(phrase.last())) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool HistoryFilter::hasFacets() const {
+    return !terms.isEmpty() || !opponent.isEmpty() || outcome != Outcome::Any
+           || !gameMode.isEmpty() || !seriesId.isEmpty();
+}
+
+bool HistoryFilter::matches(const QString &user, const MatchRecord &record) const {
+    if (!range.contains(playedAtOf(record))) return false;
+    if (!opponent.isEmpty() && opponent != (record.player1 == user ? record.player2 : record.player1)) return false;
+    if (!gameMode.isEmpty() && gameMode != record.gameMode) return false;
+    if (!seriesId.isEmpty() && seriesId != record.seriesId) return false;
+    if (outcome != Outcome::Any) {
+        const Outcome actual = record.winner == user ? Outcome::Win : record.winner == "-" ? Outcome::Tie : Outcome::Loss;
+        if (actual != outcome) return false;
+    }
+    for (const QString &term : terms) {
+        const QStringList phrase = words(term);
+        const bool found = containsPrefixPhrase(record.player1, phrase)
+                           || containsPrefixPhrase(record.player2, phrase)
+                           || containsPrefixPhrase(record.result, phrase)
+                           || containsPrefixPhrase(record.seriesId, phrase)
+                           || containsPrefixPhrase(record.gameMode, phrase);
+        if (!found) return false;
+    }
+    return true;
+}
+
+bool HistoryFilter::parse(const QString &query, HistoryFilter *filter, QString *error) {
+    *filter = HistoryFilter();
+    // key:value, key:"quoted value", "quoted phrase" or a bare word
+    static const QRegularExpression token(R"re((\w+):(?:"([^"]*)"|(\S+))|"([^"]*)"|(\S+))re");
+    auto fail = [error](const QString &reason) {
+        if (error) *error = reason;
+        return false;
+    };
+
+    for (auto it = token.globalMatch(query); it.hasNext();) {
+        const QRegularExpressionMatch match = it.next();
+        if (match.captured(1).isEmpty()) {
+            const QString term = match.captured(4).isEmpty() ? match.captured(5) : match.captured(4);
+            if (!term.trimmed().isEmpty()) filter->terms.append(term.trimmed());
+            continue;
+        }
+        const QString key = match.captured(1).toLower();
+        const QString value = match.captured(2).isEmpty() ? match.captured(3) : match.captured(2);
+        if (key == "opponent" || key == "vs") {
+            filter->opponent = value;
+        } else if (key == "result") {
+            const QString result = value.toLower();
+            if (result == "win" || result == "wins") filter->outcome = Outcome::Win;
+            else if (result == "loss" || result == "losses") filter->outcome = Outcome::Loss;
+            else if (result == "tie" || result == "ties" || result == "draw") filter->outcome = Outcome::Tie;
+            else return fail("result: expects win, loss or tie");
+        } else if (key == "mode") {
+            const QString mode = value.toLower();
+            if (mode == "pvp") filter->gameMode = "PvP";
+            else if (mode == "pvai" || mode == "ai") filter->gameMode = "PvAI";
+            else return fail("mode: expects pvp or pvai");
+        } else if (key == "series") {
+            filter->seriesId = value;
+        } else if (key == "from" || key == "to") {
+            const QDate date = QDate::fromString(value, Qt::ISODate);
+            if (!date.isValid()) return fail(key + ": expects a date like 2025-01-31");
+            if (key == "from") filter->range.from = date.startOfDay().toMSecsSinceEpoch();
+            else filter->range.to = date.addDays(1).startOfDay().toMSecsSinceEpoch();
+        } else {
+            return fail("Unknown filter '" + key + ":'");
+        }
+    }
+    return true;
+}
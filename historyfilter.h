@@ -0,0 +1,44 @@
+#ifndef HISTORYFILTER_H
+#define HISTORYFILTER_H
+
+#include <QString>
+#include <QStringList>
+#include <limits>
+#include "matchrecord.h"
+
+// History filter on played_at: epoch ms UTC, from inclusive, to exclusive
+struct DateRange {
+    qint64 from = std::numeric_limits<qint64>::min();
+    qint64 to = std::numeric_limits<qint64>::max();
+    bool contains(qint64 playedAt) const { return playedAt >= from && playedAt < to; }
+    DateRange intersected(const DateRange &other) const {
+        return {qMax(from, other.from), qMin(to, other.to)};
+    }
+};
+
+// What the history screen's search bar asks for, all conditions ANDed.
+// Outcomes are from the point of view of the user whose history it is.
+// SqliteMatchStore serves the facets from composite indexes and the terms
+// from the match_search FTS5 table; the other stores and the archive apply
+// matches() while they walk. Either way a term matches at the start of a
+// word: "vic" finds "AI Victory", "ctory" finds nothing.
+struct HistoryFilter {
+    enum class Outcome { Any, Win, Loss, Tie };
+
+    DateRange range;
+    QStringList terms;  // Names, results, series and mode
+    QString opponent;
+    Outcome outcome = Outcome::Any;
+    QString gameMode;   // "PvP" or "PvAI"; empty for any
+    QString seriesId;
+
+    bool hasFacets() const; // Anything besides the date range
+    bool matches(const QString &user, const MatchRecord &record) const;
+
+    // "opponent:<name> result:win|loss|tie mode:pvp|pvai series:<id>
+    // from:<yyyy-MM-dd> to:<yyyy-MM-dd>" plus free text; dates are whole
+    // local days, both ends included. False with the reason on bad input.
+    static bool parse(const QString &query, HistoryFilter *filter, QString *error = nullptr);
+};
+
+#endif // HISTORYFILTER_H
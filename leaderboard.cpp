@@ -0,0 +1,89 @@
+#include "leaderboard.h"
+
+bool Leaderboard::load(UserStore &store, QString *error) {
+    clear();
+    QVector<UserStanding> users;
+    if (!store.standings(&users, error)) return false;
+    for (const UserStanding &user : users) {
+        Entry entry;
+        entry.userId = user.id;
+        entry.username = user.username;
+        entry.wins = user.wins;
+        entry.losses = user.losses;
+        entry.ties = user.ties;
+        tree.insert(keyOf(entry));
+        nameById.insert(entry.userId, entry.username);
+        byName.insert(entry.username, entry);
+    }
+    loaded = true;
+    return true;
+}
+
+void Leaderboard::clear() {
+    tree.clear();
+    byName.clear();
+    nameById.clear();
+    loaded = false;
+}
+
+void Leaderboard::addUser(qint64 userId, const QString &username) {
+    if (byName.contains(username)) return;
+    Entry entry;
+    entry.userId = userId;
+    entry.username = username;
+    tree.insert(keyOf(entry));
+    nameById.insert(userId, username);
+    byName.insert(username, entry);
+}
+
+void Leaderboard::removeUser(const QString &username) {
+    auto it = byName.find(username);
+    if (it == byName.end()) return;
+    tree.erase(keyOf(*it));
+    nameById.remove(it->userId);
+    byName.erase(it);
+}
+
+void Leaderboard::recordGame(const MatchRecord &record) {
+    applyOutcome(record.player1, record.winner);
+    if (record.player2 != record.player1) applyOutcome(record.player2, record.winner);
+}
+
+// Re-keys one user: O(log n) erase + insert
+void Leaderboard::applyOutcome(const QString &username, const QString &winner) {
+    auto it = byName.find(username);
+    if (it == byName.end()) return; // AI and guest names aren't ranked
+    tree.erase(keyOf(*it));
+    if (winner == username) ++it->wins;
+    else if (winner == "-") ++it->ties;
+    else ++it->losses;
+    tree.insert(keyOf(*it));
+}
+
+int Leaderboard::rankOf(const QString &username) const {
+    auto it = byName.constFind(username);
+    return it == byName.constEnd() ? 0 : tree.rank(keyOf(*it)) + 1;
+}
+
+QVector<Leaderboard::Entry> Leaderboard::top(int count) const {
+    return slice(0, count);
+}
+
+// The user's row with up to `radius` neighbours on each side
+QVector<Leaderboard::Entry> Leaderboard::around(const QString &username, int radius) const {
+    const int rank = rankOf(username);
+    if (rank == 0) return {};
+    const int first = qMax(0, rank - 1 - radius);
+    return slice(first, rank + radius - first);
+}
+
+QVector<Leaderboard::Entry> Leaderboard::slice(int first, int count) const {
+    QVector<Entry> entries;
+    const int last = qMin(tree.size(), first + qMax(0, count));
+    for (int index = first; index < last; ++index) {
+        Entry entry = byName.value(nameById.value(tree.at(index).userId));
+        entry.rank = index + 1;
+        entries.append(entry);
+    }
+    return entries;
+}
@@ -0,0 +1,65 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "matchrecord.h"
+#include "ranktree.h"
+#include "userstore.h"
+
+// Ranking of all registered users by wins (fewer losses breaks ties).
+// Loaded once from the user store, then kept current in memory as games are
+// saved, so rank lookups and top-K/neighbourhood slices cost O(log n)
+// instead of re-sorting the user table. Outcomes are classified exactly
+// like the user_stats trigger: winner == name is a win, "-" a tie, anything
+// else a loss.
+class Leaderboard {
+public:
+    struct Entry {
+        qint64 userId = 0;
+        QString username;
+        int wins = 0;
+        int losses = 0;
+        int ties = 0;
+        int rank = 0; // 1-based; filled in by the query methods
+    };
+
+    bool load(UserStore &store, QString *error = nullptr);
+    bool isLoaded() const { return loaded; }
+    void clear();
+
+    void addUser(qint64 userId, const QString &username);
+    void removeUser(const QString &username);
+    void recordGame(const MatchRecord &record);
+
+    int size() const { return tree.size(); }
+    int rankOf(const QString &username) const; // 1-based, 0 if unknown
+    QVector<Entry> top(int count) const;
+    QVector<Entry> around(const QString &username, int radius) const;
+
+private:
+    struct Key {
+        int wins;
+        int losses;
+        qint64 userId;
+    };
+    struct KeyOrder {
+        bool operator()(const Key &a, const Key &b) const {
+            if (a.wins != b.wins) return a.wins > b.wins;
+            if (a.losses != b.losses) return a.losses < b.losses;
+            return a.userId < b.userId;
+        }
+    };
+
+    static Key keyOf(const Entry &entry) { return {entry.wins, entry.losses, entry.userId}; }
+    void applyOutcome(const QString &username, const QString &winner);
+    QVector<Entry> slice(int first, int count) const;
+
+    RankTree<Key, KeyOrder> tree;
+    QHash<QString, Entry> byName;
+    QHash<qint64, QString> nameById;
+    bool loaded = false;
+};
+
+#endif // LEADERBOARD_H
@@ -108,12 +108,14 @@ void TicTacToe::resetGame() {
         }
     }
     updateStatus();
+    journalSeries(false);
 }
 void TicTacToe::makeMove(int index) {
     if (board[index] != EMPTY) return;
 
     board[index] = currentPlayer;
     moveHistory.push_back(index);
+    if (!inReplayMode) gameJournal.appendMove(index);
     updateBoard();
 
     if (checkWin(currentPlayer, this->board)) {
@@ -140,6 +142,9 @@ void TicTacToe::makeMove(int index) {
             result = "🥇 Win"; // Standard win with gold medal
         }
 
+        // The journal moves past the game before it is saved, so a crash in
+        // between can't resume it and record the same game number twice
+        journalSeries(true);
         // Save this individual game immediately with correct game number
         saveIndividualGameWithNumber(winner, result, actualGameNumber);
 
@@ -171,6 +176,7 @@ void TicTacToe::makeMove(int index) {
 
         ties++;
 
+        journalSeries(true); // Before the save, as above
         // Save this individual game as a tie with expressive emoji
         saveIndividualGameWithNumber("-", "🤝 Tie", actualGameNumber);
 
@@ -432,6 +438,85 @@ int TicTacToe::minimax(std::vector<char> &tempBoard, bool isMaximizing) {
     }
     return bestScore;
 }
+// ==================== Recorded Game Check ====================
+// Imported games must replay legally from their starting side, stop at the
+// first win and name the winner the board shows (player1 plays X). Only a
+// surrender may end before the board is decided. Safe to call from any
+// thread.
+QString TicTacToe::checkRecordedGame(const MatchRecord &record) {
+    if (record.startingPlayer != "X" && record.startingPlayer != "O") {
+        return "unknown starting player '" + record.startingPlayer + "'";
+    }
+    std::vector<int> moves(qMax(0, (record.moves.size() - 1) * 2));
+    int side = MoveCodec::ClassicSide;
+    const int count = record.moves.isEmpty() ? 0
+                      : MoveCodec::decode(reinterpret_cast<const unsigned char *>(record.moves.constData()),
+                                          record.moves.size(), moves.data(), static_cast<int>(moves.size()), &side);
+    if (count < 0) return "malformed moves";
+    if (side != MoveCodec::ClassicSide) return "not a 3x3 game";
+    moves.resize(count);
+
+    std::vector<char> tempBoard(9, EMPTY);
+    char player = record.startingPlayer.at(0).toLatin1();
+    char winnerMark = EMPTY;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        const int cell = moves[i];
+        if (winnerMark != EMPTY) return QString("move %1 comes after the game was won").arg(i + 1);
+        if (cell < 0 || cell >= 9) return QString("move %1 is off the board").arg(i + 1);
+        if (tempBoard[cell] != EMPTY) return QString("move %1 is on an occupied cell").arg(i + 1);
+        tempBoard[cell] = player;
+        if (checkWin(player, tempBoard)) winnerMark = player;
+        player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    }
+
+    if (winnerMark != EMPTY) {
+        const QString boardWinner = (winnerMark == PLAYER1) ? record.player1 : record.player2;
+        if (record.winner != boardWinner) return QString("%1 won on the board, %2 is recorded").arg(boardWinner, record.winner);
+    } else if (checkTie(tempBoard)) {
+        if (record.winner != "-") return "a drawn game is recorded as won by " + record.winner;
+    } else if (!record.result.contains("Surrender")) {
+        return "the game stops before it is decided";
+    } else if (record.winner != record.player1 && record.winner != record.player2) {
+        return "the surrender winner " + record.winner + " is not a player";
+    }
+    return QString();
+}
+
+// ==================== Perft ====================
+// (perft(), perftRecursive()) - counts every line of play up to `depth` plies.
+// Full depth (9) from an empty board must give 255,168 complete games:
+// 131,184 won by the side to move first, 77,904 by the second side, 46,080 draws.
+TicTacToe::PerftResult TicTacToe::perft(int depth, char startingPlayer) {
+    PerftResult result;
+    std::vector<char> tempBoard(9, EMPTY);
+    perftRecursive(tempBoard, startingPlayer, depth, result);
+    return result;
+}
+
+void TicTacToe::perftRecursive(std::vector<char> &tempBoard, char player, int depth, PerftResult &result) {
+    if (depth <= 0) {
+        result.leaves++;
+        return;
+    }
+
+    char nextPlayer = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    for (int i = 0; i < 9; i++) {
+        if (tempBoard[i] != EMPTY) continue;
+
+        tempBoard[i] = player;
+        if (checkWin(player, tempBoard)) {
+            result.leaves++;
+            if (player == PLAYER1) result.xWins++;
+            else result.oWins++;
+        } else if (checkTie(tempBoard)) {
+            result.leaves++;
+            result.draws++;
+        } else {
+            perftRecursive(tempBoard, nextPlayer, depth - 1, result);
+        }
+        tempBoard[i] = EMPTY;
+    }
+}
 // ==================== Mode Selection ====================
 // (setPlayerVsPlayer(), setPlayerVsAI(), setDifficultyEasy(), setDifficultyMedium(), setDifficultyHard())
 void TicTacToe::setPlayerVsPlayer() {
@@ -476,3 +561,189 @@ void TicTacToe::updateScoreboard() {
     scoreLabel->setText(scoreText);
 }
 
+
+// ==================== Opening Explorer ====================
+// The trie is snapshotted next to the database so startup only streams the
+// matches saved since the last run; in-memory databases rebuild from scratch.
+// Match ids (and so the snapshot's watermark) are specific to the match store.
+static QString openingSnapshotPath(const QSqlDatabase &db, const MatchStore &store) {
+    if (db.databaseName() == ":memory:" || store.name() == "memory") return QString();
+    return db.databaseName() + (store.name() == "sqlite" ? "-openings" : "-openings-" + store.name());
+}
+
+void TicTacToe::loadOpeningTrie() {
+    openingTrie.clear();
+    if (!db.isOpen() || !matchStore) return;
+    const QString path = openingSnapshotPath(db, *matchStore);
+    if (!path.isEmpty() && !openingTrie.loadSnapshot(path)) {
+        openingTrie.clear(); // Missing or unreadable: full scan
+    }
+    // Games the writer replays from its journal are only counted by the scan,
+    // and the saved watermark will cover them
+    flushPendingWrites();
+    QString error;
+    if (!openingTrie.catchUp(*matchStore, &error)) {
+        qWarning() << "Opening explorer catch-up failed:" << error;
+    }
+    openingSnapshotValid = true;
+}
+
+// Called after the write-behind queue has drained, so every game the trie
+// counted this session is in the match store at or below its last id.
+void TicTacToe::saveOpeningTrie() {
+    if (!matchStore || !openingSnapshotValid) return;
+    const QString path = openingSnapshotPath(db, *matchStore);
+    if (path.isEmpty()) return;
+    QString error;
+    if (!openingTrie.saveSnapshot(path, matchStore->lastMatchId(), &error)) {
+        qWarning() << "Failed to save opening explorer snapshot:" << error;
+    }
+}
+
+// Continuations from the current position, from the point of view of the
+// side to move (W/D/L percentages over recorded finished games).
+void TicTacToe::updateOpeningExplorer() {
+    static const char *const cellNames[9] = {"top-left", "top", "top-right", "left", "centre",
+                                             "right", "bottom-left", "bottom", "bottom-right"};
+    const OpeningTrie::Stats here = openingTrie.statsAt(moveHistory);
+    if (here.games() == 0) {
+        openingExplorerLabel->setText("Opening explorer: no recorded games from this position");
+        return;
+    }
+
+    const bool firstToMove = moveHistory.size() % 2 == 0;
+    QStringList lines;
+    lines << QString("Opening explorer: %1 recorded games from here").arg(here.games());
+    const QVector<OpeningTrie::Continuation> moves = openingTrie.continuations(moveHistory);
+    for (int i = 0; i < moves.size() && i < 4; ++i) {
+        const OpeningTrie::Stats &stats = moves[i].stats;
+        const double games = stats.games();
+        const quint32 wins = firstToMove ? stats.firstWins : stats.secondWins;
+        const quint32 losses = firstToMove ? stats.secondWins : stats.firstWins;
+        lines << QString("%1: %2 games, %3% W / %4% D / %5% L")
+                     .arg(cellNames[moves[i].cell])
+                     .arg(stats.games())
+                     .arg(qRound(100 * wins / games))
+                     .arg(qRound(100 * stats.draws / games))
+                     .arg(qRound(100 * losses / games));
+    }
+    openingExplorerLabel->setText(lines.join('\n'));
+}
+
+// ==================== Game Journal ====================
+// The series being played is journalled next to the database (see
+// gamejournal.h) and offered back at the next login of the same player.
+// Each player has their own file, so another player's series can't
+// overwrite a game left unfinished at logout; called whenever the
+// logged-in user changes.
+void TicTacToe::openGameJournal() {
+    if (db.databaseName() == ":memory:" || loggedInUser.isEmpty()) {
+        gameJournal.setPath(QString());
+        return;
+    }
+    const QString key = guestMode ? QString("guest") : QString::fromLatin1(loggedInUser.toUtf8().toHex());
+    gameJournal.setPath(db.databaseName() + "-game-" + key);
+}
+
+void TicTacToe::journalSeries(bool betweenGames) {
+    if (loggedInUser.isEmpty() || inReplayMode) return;
+    GameJournal::State state;
+    state.user = loggedInUser;
+    state.guest = guestMode;
+    state.mode = mode;
+    state.difficulty = difficulty;
+    state.player1 = player1Name;
+    state.player2 = player2Name;
+    state.totalGames = totalGames;
+    state.gamesToWin = gamesToWin;
+    state.seriesId = currentSeriesId;
+    state.player1Wins = player1Wins;
+    state.player2Wins = player2Wins;
+    state.ties = ties;
+    state.startingPlayer = gameStartingPlayer;
+    state.betweenGames = betweenGames;
+    gameJournal.writeState(state);
+}
+
+void TicTacToe::offerResume() {
+    GameJournal::State state;
+    if (!gameJournal.load(&state) || state.user != loggedInUser || state.guest != guestMode) return;
+    if (state.player1Wins >= state.gamesToWin || state.player2Wins >= state.gamesToWin ||
+        (state.player1Wins + state.player2Wins + state.ties) >= state.totalGames) {
+        gameJournal.discard(); // Decided before the series screen closed
+        return;
+    }
+
+    QMessageBox::StandardButton reply = QMessageBox::Yes; // Automatically "click" Yes during tests
+    if (!isTestRun) {
+        reply = QMessageBox::question(this, "Resume Series",
+                                      QString("Resume the unfinished series %1 vs %2 (%3-%4, %5 tied)?")
+                                          .arg(state.player1, state.player2)
+                                          .arg(state.player1Wins)
+                                          .arg(state.player2Wins)
+                                          .arg(state.ties),
+                                      QMessageBox::Yes | QMessageBox::No);
+    }
+    if (reply != QMessageBox::Yes) {
+        gameJournal.discard();
+        return;
+    }
+    resumeFromJournal(state);
+}
+
+void TicTacToe::resumeFromJournal(const GameJournal::State &state) {
+    mode = state.mode;
+    difficulty = state.difficulty;
+    player1Name = state.player1;
+    player2Name = state.player2;
+    totalGames = state.totalGames;
+    gamesToWin = state.gamesToWin;
+    currentSeriesId = state.seriesId;
+    player1Wins = state.player1Wins;
+    player2Wins = state.player2Wins;
+    ties = state.ties;
+    stackedWidget->setCurrentIndex(2);
+
+    if (state.betweenGames) {
+        resetGame();
+        return;
+    }
+
+    // A journalled move that ended the game means the crash came before the
+    // game was saved (see makeMove()), so it is taken back and played again.
+    board.assign(9, EMPTY);
+    moveHistory.clear();
+    gameStartingPlayer = state.startingPlayer;
+    currentPlayer = state.startingPlayer;
+    for (int cell : state.moves) {
+        if (cell < 0 || cell >= 9 || board[cell] != EMPTY) break;
+        board[cell] = currentPlayer;
+        moveHistory.push_back(cell);
+        currentPlayer = (currentPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
+    }
+    if (!moveHistory.empty() && !isMatchUnfinished()) {
+        board[moveHistory.back()] = EMPTY;
+        moveHistory.pop_back();
+        currentPlayer = (currentPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
+    }
+    firstMoveMade = !moveHistory.empty();
+
+    for (int i = 0; i < 9; i++) {
+        QPushButton *button = qobject_cast<QPushButton*>(buttonGroup->button(i));
+        if (button) {
+            button->setText("");
+            button->setEnabled(true);
+        }
+    }
+    updateBoard();
+    updateScoreboard();
+    updateStatus();
+
+    // Start the journal over from this position so later moves append to it
+    journalSeries(false);
+    for (int cell : moveHistory) gameJournal.appendMove(cell);
+
+    if (mode == 2 && currentPlayer == PLAYER1) {
+        QTimer::singleShot(500, this, [this]() { makeAIMove(); });
+    }
+}
@@ -1,17 +1,54 @@
 #include "tictactoe.h"
+#include <QApplication>
 #include <QCryptographicHash>
+#include <QFileDialog>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QProgressDialog>
 #include <QRandomGenerator>
+#include <QSaveFile>
 #include <QSqlError>
+#include <QtConcurrent/QtConcurrentRun>
+#include <atomic>
+#include <memory>
 
 // ==================== Constructor ====================
 TicTacToe::TicTacToe(QWidget *parent) : QMainWindow(parent) {
     setupUI();
     connectToDatabase();
     createTablesIfNeeded();
+    startDbWriter();
+    startDbBackup();
+    startMatchArchive();
+    openStores();
+    openGameJournal();
+    loadOpeningTrie();
     applyStyleSheet();
     resetGame();
 }
 
+TicTacToe::~TicTacToe() {
+    matchExport.waitForFinished(); // Uses a connection from the manager
+    // Flush-on-exit: every finished game is committed before the window goes away
+    if (dbWriter) {
+        dbWriter->stop();
+    }
+    if (dbBackup) {
+        dbBackup->stop();
+    }
+    if (matchArchive) {
+        matchArchive->stop();
+    }
+    saveOpeningTrie();
+    delete matchStore;
+    delete userStore;
+    // The GUI thread's connection goes last, once nothing holds a copy
+    delete schemaMigrator;
+    db = QSqlDatabase();
+    delete connections;
+    StorageMetrics::global().writeReport(); // Latency per operation, next to the slow queries
+}
+
 QString currentUsername;
 
 // ==================== Login / Logout ====================
@@ -26,19 +63,17 @@ void TicTacToe::handleLogin() {
         return;
     }
 
-    QSqlQuery query(this->db);
-    // Fixed: Use 'password_hash' instead of 'password'
-    query.prepare("SELECT password_hash, salt FROM users WHERE username = :username");
-    query.bindValue(":username", username);
-
-    if (!query.exec()) {
-        QMessageBox::critical(this, "Database Error", query.lastError().text());
+    UserAccount account;
+    bool found = false;
+    QString error;
+    if (!userStore->findUser(username, &account, &found, &error)) {
+        QMessageBox::critical(this, "Database Error", error);
         return;
     }
 
-    if (query.next()) {
-        QString storedHash = query.value(0).toString();  // This now gets password_hash
-        QByteArray salt = QByteArray::fromHex(query.value(1).toString().toUtf8());
+    if (found) {
+        QString storedHash = account.passwordHash;
+        QByteArray salt = QByteArray::fromHex(account.salt.toUtf8());
 
         QString computedHash = pbkdf2Hash(password, salt, 10000, 32);
 
@@ -55,6 +90,8 @@ void TicTacToe::handleLogin() {
 
             usernameEdit->clear();
             passwordEdit->clear();
+            openGameJournal();
+            offerResume();
         } else {
             QMessageBox::warning(this, "Login Failed", "Invalid username or password!");
         }
@@ -65,8 +102,9 @@ void TicTacToe::handleLogin() {
 
 
 void TicTacToe::logout() {
-    // Only save surrender if there's an active unfinished match
-    if (isMatchUnfinished() && !guestMode && !moveHistory.empty()) {
+    // Only save surrender if there's an active unfinished match that the
+    // journal can't bring back at the next login
+    if (isMatchUnfinished() && !guestMode && !moveHistory.empty() && !gameJournal.isEnabled()) {
         // Calculate BEFORE any score updates
         int actualGameNumber = player1Wins + player2Wins + ties + 1;
 
@@ -107,6 +145,7 @@ void TicTacToe::logout() {
     // Reset all user session data
     loggedInUser.clear();
     guestMode = false;
+    openGameJournal(); // Keeps the file for this player's next login
     usernameEdit->clear();
     passwordEdit->clear();
 
@@ -142,19 +181,19 @@ void TicTacToe::deleteAccount() {
 
 // This new function contains ONLY the database logic, which is now testable.
 void TicTacToe::performAccountDeletion() {
-    QSqlQuery query(this->db);
+    flushPendingWrites();
 
-    query.prepare("DELETE FROM matches WHERE player1 = :username OR player2 = :username");
-    query.bindValue(":username", loggedInUser);
-    query.exec();
-
-    query.prepare("DELETE FROM users WHERE username = :username");
-    query.bindValue(":username", loggedInUser);
-    if (query.exec()) {
+    QString error;
+    if (userStore->removeUser(loggedInUser, &error)) {
+        if (!matchStore->removeUserMatches(loggedInUser, &error)) {
+            qWarning() << "Failed to remove match history:" << error;
+        }
+        leaderboard.removeUser(loggedInUser);
+        gameJournal.discard();
         if (!isTestRun) QMessageBox::information(this, "Account Deleted", "Your account and match history have been deleted.");
         logout();
     } else {
-        if (!isTestRun) QMessageBox::critical(this, "Error", "Failed to delete account: " + query.lastError().text());
+        if (!isTestRun) QMessageBox::critical(this, "Error", "Failed to delete account: " + error);
     }
 }
 
@@ -202,6 +241,7 @@ void TicTacToe::backToModeSelection() {
     }
 
     // Normal game end - reset scores
+    gameJournal.discard();
     player1Wins = 0;
     player2Wins = 0;
     ties = 0;
@@ -211,26 +251,24 @@ void TicTacToe::backToModeSelection() {
 
 // FIXED: Enhanced loadRecordedMatch with complete button blocking
 void TicTacToe::loadRecordedMatch() {
-    int row = recordedMatchesTable->currentRow();
-    if (row < 0) {
+    qint64 matchId = recordedMatchesModel->matchId(recordedMatchesTable->currentIndex().row());
+    if (matchId < 0) {
         QMessageBox::warning(this, "No Match Selected", "Please select a match to replay.");
         return;
     }
 
-    QString matchId = recordedMatchesTable->item(row, 0)->text();
-    QSqlQuery query(this->db);
-    query.prepare("SELECT moves, player1, player2, starting_player, game_mode FROM matches WHERE id = :id");
-    query.bindValue(":id", matchId);
-    if (!query.exec() || !query.next()) {
-        QMessageBox::critical(this, "Error", "Failed to load match from database.");
+    MatchRecord match;
+    QString error;
+    if (!matchStore->loadMatch(matchId, &match, &error)) {
+        QMessageBox::critical(this, "Error", "Failed to load match: " + error);
         return;
     }
 
-    QString moveStr = query.value(0).toString();
-    QString originalPlayer1 = query.value(1).toString();
-    QString originalPlayer2 = query.value(2).toString();
-    QString startingPlayerStr = query.value(3).toString();
-    QString gameMode = query.value(4).toString();
+    QString originalPlayer1 = match.player1;
+    QString originalPlayer2 = match.player2;
+    QString startingPlayerStr = match.startingPlayer;
+    QString gameMode = match.gameMode;
+    QByteArray movesBlob = match.moves;
     char startingPlayer = startingPlayerStr.isEmpty() ? PLAYER1 : startingPlayerStr.at(0).toLatin1();
 
     // Store original game state to restore later
@@ -256,11 +294,7 @@ void TicTacToe::loadRecordedMatch() {
         player2Name = originalPlayer2;
     }
 
-    QStringList moveTokens = moveStr.split(',', Qt::SkipEmptyParts);
-    std::vector<int> replayMoves;
-    for (const QString &move : moveTokens) {
-        replayMoves.push_back(move.toInt());
-    }
+    std::vector<int> replayMoves = decodeMoves(movesBlob);
 
     // Complete reset for replay
     board = std::vector<char>(9, EMPTY);
@@ -446,6 +480,9 @@ void TicTacToe::gameOver(const QString &message, bool seriesOver) {
         }
     }
 
+    if (seriesOver && dbWriter)
+        dbWriter->endSeries();
+
     if (seriesOver)
         QTimer::singleShot(3000, this, &TicTacToe::backToModeSelection);
     else
@@ -508,6 +545,7 @@ void TicTacToe::updateBoard() {
             }
         }
     }
+    if (explorerVisible) updateOpeningExplorer();
 }
 
 void TicTacToe::updateStatus() {
@@ -519,6 +557,13 @@ void TicTacToe::updateStatus() {
     }
 }
 
+void TicTacToe::toggleOpeningExplorer() {
+    explorerVisible = !explorerVisible;
+    openingExplorerLabel->setVisible(explorerVisible);
+    explorerToggleButton->setText(explorerVisible ? "Hide Explorer" : "Show Explorer");
+    if (explorerVisible) updateOpeningExplorer();
+}
+
 void TicTacToe::toggleScoreboard() {
     scoreboardVisible = !scoreboardVisible;
     scoreLabel->setVisible(scoreboardVisible);
@@ -539,11 +584,33 @@ void TicTacToe::handleButtonClick(int index) {
     makeMove(index);
 }
 
+// TICTACTOE_DB_PROFILE picks the SQLite tuning (see StorageProfile::names()); "balanced" by default.
+// Worker threads get their own connections from the same manager.
 void TicTacToe::connectToDatabase(const QString& connectionName) {
-    db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
-    db.setDatabaseName("tictactoe.db");
-    if (!db.open()) {
-        QMessageBox::critical(this, "Database Error", "Failed to open database!");
+    QString profileName = qEnvironmentVariable("TICTACTOE_DB_PROFILE", "balanced");
+    storageProfile = StorageProfile::byName(profileName);
+
+    // TICTACTOE_SLOW_QUERY_MS: "off" or milliseconds; slow queries go to <db>-slowqueries.log
+    int slowQueryMs = StorageMetrics::DefaultSlowQueryMs;
+    if (!StorageMetrics::thresholdFromString(qEnvironmentVariable("TICTACTOE_SLOW_QUERY_MS"), &slowQueryMs)) {
+        qWarning() << "Invalid TICTACTOE_SLOW_QUERY_MS, using" << slowQueryMs << "ms";
+    }
+    StorageMetrics::global().setSlowQueryThreshold(slowQueryMs);
+
+    db = QSqlDatabase();
+    delete connections;
+    connections = new ConnectionManager("tictactoe.db", storageProfile, connectionName);
+    QString error;
+    db = connections->connection(&error);
+    if (!db.isValid()) {
+        QMessageBox::critical(this, "Database Error", "Failed to open database! " + error);
+        return;
+    }
+
+    const QString slowQueryLog = slowQueryMs > 0 && db.databaseName() != ":memory:"
+                                     ? db.databaseName() + "-slowqueries.log" : QString();
+    if (!StorageMetrics::global().setSlowQueryLog(slowQueryLog, &error)) {
+        qWarning() << "Slow-query log unavailable:" << error;
     }
 }
 
@@ -553,61 +620,18 @@ void TicTacToe::createTablesIfNeeded() {
         return;
     }
 
-    QSqlQuery query(db);
+    // Versioned migrations replace the old ad-hoc PRAGMA table_info checks;
+    // table-sized rewrites run afterwards as batched background backfills.
+    delete schemaMigrator;
+    schemaMigrator = new SchemaMigrator(db, this);
+    registerSchemaMigrations(*schemaMigrator);
 
-    // Create users table if not exists
-    if (!query.exec(
-            "CREATE TABLE IF NOT EXISTS users ("
-            "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-            "username TEXT UNIQUE NOT NULL,"
-            "password_hash TEXT NOT NULL,"
-            "salt TEXT NOT NULL"
-            ")")) {
-        QMessageBox::critical(this, "Database Error", "Failed to create users table: " + query.lastError().text());
+    QString error;
+    if (!schemaMigrator->migrate(&error)) {
+        QMessageBox::critical(this, "Database Error", "Failed to migrate database: " + error);
         return;
     }
-
-    // Create matches table if not exists (without starting_player, in case it already exists)
-    if (!query.exec(
-            "CREATE TABLE IF NOT EXISTS matches ("
-            "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-            "player1 TEXT NOT NULL,"
-            "player2 TEXT NOT NULL,"
-            "winner TEXT,"
-            "result TEXT,"
-            "moves TEXT,"
-            "timestamp TEXT,"
-            "starting_player TEXT,"
-            "game_mode TEXT,"
-            "series_id TEXT,"           // New: Unique identifier for the series
-            "game_number INTEGER,"      // New: Game number within the series
-            "series_total INTEGER,"     // New: Total games in the series
-            "series_target INTEGER"     // New: Games needed to win series
-            ")")) {
-        QMessageBox::critical(this, "Database Error", "Failed to create matches table: " + query.lastError().text());
-        return;
-    }
-
-    // Check if starting_player column exists
-    QSqlQuery pragmaQuery(db);
-    bool hasStartingPlayer = false;
-    if (pragmaQuery.exec("PRAGMA table_info(matches)")) {
-        while (pragmaQuery.next()) {
-            if (pragmaQuery.value(1).toString() == "starting_player") {
-                hasStartingPlayer = true;
-                break;
-            }
-        }
-    }
-
-    // Add starting_player column if missing
-    if (!hasStartingPlayer) {
-        QSqlQuery alterQuery(db);
-        if (!alterQuery.exec("ALTER TABLE matches ADD COLUMN starting_player TEXT")) {
-            // It's okay if this fails due to a race, but log it
-            qDebug() << "Could not add starting_player column (may already exist):" << alterQuery.lastError().text();
-        }
-    }
+    schemaMigrator->startBackfills();
 }
 
 void TicTacToe::saveMatchResult(const QString &winner, const QString &result) {
@@ -621,36 +645,22 @@ void TicTacToe::saveMatchResult(const QString &winner, const QString &result) {
         return;
     }
 
-    QString moveSequence;
-    for (int i = 0; i < static_cast<int>(moveHistory.size()); ++i) {
-        moveSequence += QString::number(moveHistory[i]);
-        if (i != static_cast<int>(moveHistory.size()) - 1)
-            moveSequence += ",";
-    }
-
     // FIXED: Use the stored starting player, not calculated from move history
     char startingPlayer = gameStartingPlayer;
 
+    MatchRecord record;
+    record.player1 = player1Name;
+    record.player2 = player2Name;
+    record.winner = winner;
+    record.result = result;
+    record.moves = encodeMoves(moveHistory);
+    record.playedAt = QDateTime::currentMSecsSinceEpoch();
+    record.timestamp = timestampText(record.playedAt);
+    record.startingPlayer = QString(startingPlayer);
     // Store the current game mode for proper replay
-    QString gameMode = (mode == 2) ? "PvAI" : "PvP";
-
-    QSqlQuery query;
-    query.prepare("INSERT INTO matches "
-                  "(player1, player2, winner, result, moves, timestamp, starting_player, game_mode) "
-                  "VALUES (:player1, :player2, :winner, :result, :moves, :timestamp, :starting_player, :game_mode)");
-    query.bindValue(":player1", player1Name);
-    query.bindValue(":player2", player2Name);
-    query.bindValue(":winner", winner);
-    query.bindValue(":result", result);
-    query.bindValue(":moves", moveSequence);
-    query.bindValue(":timestamp", QDateTime::currentDateTime().toString(Qt::ISODate));
-    query.bindValue(":starting_player", QString(startingPlayer));
-    query.bindValue(":game_mode", gameMode);
-
-    if (!query.exec()) {
-        QMessageBox::critical(this, "Database Error", "Failed to save match result: " + query.lastError().text());
-        return;
-    }
+    record.gameMode = (mode == 2) ? "PvAI" : "PvP";
+    record.difficulty = (mode == 2) ? difficulty : 0;
+    queueMatchRecord(record);
 }
 
 void TicTacToe::saveIndividualGameWithNumber(const QString &winner, const QString &result, int gameNumber) {
@@ -667,81 +677,286 @@ void TicTacToe::saveIndividualGameWithNumber(const QString &winner, const QStrin
                           QString::number(QRandomGenerator::global()->bounded(1000, 9999));
     }
 
-    QString moveSequence;
-    for (int i = 0; i < static_cast<int>(moveHistory.size()); ++i) {
-        moveSequence += QString::number(moveHistory[i]);
-        if (i != static_cast<int>(moveHistory.size()) - 1)
-            moveSequence += ",";
-    }
-
-    QString gameMode = (mode == 2) ? "PvAI" : "PvP";
-
-    QSqlQuery query(this->db);
-    query.prepare("INSERT INTO matches "
-                  "(player1, player2, winner, result, moves, timestamp, starting_player, game_mode, "
-                  "series_id, game_number, series_total, series_target) "
-                  "VALUES (:player1, :player2, :winner, :result, :moves, :timestamp, :starting_player, "
-                  ":game_mode, :series_id, :game_number, :series_total, :series_target)");
-
-    query.bindValue(":player1", player1Name);
-    query.bindValue(":player2", player2Name);
-    query.bindValue(":winner", winner);
-    query.bindValue(":result", result);
-    query.bindValue(":moves", moveSequence);
-    query.bindValue(":timestamp", QDateTime::currentDateTime().toString(Qt::ISODate));
-    query.bindValue(":starting_player", QString(gameStartingPlayer));
-    query.bindValue(":game_mode", gameMode);
-    query.bindValue(":series_id", currentSeriesId);
-    query.bindValue(":game_number", gameNumber); // Use the passed game number
-    query.bindValue(":series_total", totalGames);
-    query.bindValue(":series_target", gamesToWin);
-
-    if (!query.exec()) {
-        QMessageBox::critical(this, "Database Error", "Failed to save game result: " + query.lastError().text());
+    MatchRecord record;
+    record.player1 = player1Name;
+    record.player2 = player2Name;
+    record.winner = winner;
+    record.result = result;
+    record.moves = encodeMoves(moveHistory);
+    record.playedAt = QDateTime::currentMSecsSinceEpoch();
+    record.timestamp = timestampText(record.playedAt);
+    record.startingPlayer = QString(gameStartingPlayer);
+    record.gameMode = (mode == 2) ? "PvAI" : "PvP";
+    record.difficulty = (mode == 2) ? difficulty : 0;
+    record.seriesId = currentSeriesId;
+    record.gameNumber = gameNumber; // Use the passed game number
+    record.seriesTotal = totalGames;
+    record.seriesTarget = gamesToWin;
+    queueMatchRecord(record);
+
+    moveHistory.clear();
+}
+
+// Starts the write-behind queue. Creating it also replays any games a
+// previous run queued but never committed.
+// TICTACTOE_FLUSH_POLICY selects the batching: "game" (default), "series" or "interval:<ms>".
+void TicTacToe::startDbWriter() {
+    // In-memory databases are private to their connection, so they are written inline
+    if (!db.isOpen() || db.databaseName() == ":memory:") return;
+
+    int intervalMs = 250;
+    DbWriter::FlushPolicy policy = DbWriter::policyFromString(qEnvironmentVariable("TICTACTOE_FLUSH_POLICY"), &intervalMs);
+
+    dbWriter = new DbWriter(db.databaseName(), 1024, this);
+    dbWriter->setFlushPolicy(policy, intervalMs);
+    dbWriter->setConnections(connections);
+    connect(dbWriter, &DbWriter::writeFailed, this, &TicTacToe::handleMatchWriteFailed);
+    dbWriter->start();
+}
+
+// Scheduled online snapshots of the database (see dbbackup.h).
+// TICTACTOE_BACKUP: "off", "<minutes>" or "<minutes>:<keep>"; hourly, keeping 5, by default.
+void TicTacToe::startDbBackup() {
+    if (!db.isOpen() || db.databaseName() == ":memory:") return;
+
+    int intervalMs = 0;
+    int keep = 0;
+    if (!DbBackup::scheduleFromString(qEnvironmentVariable("TICTACTOE_BACKUP"), &intervalMs, &keep)) return;
+
+    dbBackup = new DbBackup(db.databaseName(), this);
+    dbBackup->setSchedule(intervalMs, keep);
+    dbBackup->start();
+}
+
+// Moves games past the retention period into the compressed archive (see matcharchive.h).
+// TICTACTOE_RETENTION: "off" (default), "<days>" or "<days>:<batch rows>".
+void TicTacToe::startMatchArchive() {
+    if (!db.isOpen() || db.databaseName() == ":memory:") return;
+
+    int retentionDays = 0;
+    int batchRows = 0;
+    if (!MatchArchive::policyFromString(qEnvironmentVariable("TICTACTOE_RETENTION"), &retentionDays, &batchRows)) return;
+
+    matchArchive = new MatchArchive(connections, this);
+    matchArchive->setPolicy(retentionDays, batchRows);
+    matchArchive->start();
+}
+
+// TICTACTOE_STORAGE selects the storage backend:
+//   "sqlite" (default) users and matches in the database
+//   "log"    matches in an append-only log next to the database (see
+//            matchlogstore.h), users and their stats in the database
+//   "memory" both in hash maps, nothing persisted (benchmarks, demos)
+void TicTacToe::openStores() {
+    delete matchStore;
+    matchStore = nullptr;
+    delete userStore;
+    userStore = nullptr;
+
+    const QString storage = qEnvironmentVariable("TICTACTOE_STORAGE", "sqlite").toLower();
+    if (storage == "memory") {
+        userStore = new MemoryUserStore;
+        matchStore = new MemoryMatchStore;
+    } else {
+        if (storage == "log" && db.databaseName() != ":memory:") {
+            MatchLogStore *log = new MatchLogStore(db.databaseName() + "-matchlog");
+            QString error;
+            if (log->open(&error)) {
+                matchStore = log;
+                // No matches rows for the stats trigger; the user store counts games
+                userStore = new SqliteUserStore(db, true);
+            } else {
+                qWarning() << "Match log unavailable, using SQLite:" << error;
+                delete log;
+            }
+        } else if (storage != "sqlite" && storage != "log") {
+            qWarning() << "Unknown TICTACTOE_STORAGE" << storage << "- using SQLite";
+        }
+        if (!matchStore) matchStore = new SqliteMatchStore(db, db.databaseName() == ":memory:" ? nullptr : dbWriter);
+        if (!userStore) userStore = new SqliteUserStore(db);
+    }
+
+    // Every call is timed, whichever backend serves it (see storagemetrics.h)
+    userStore = new TimedUserStore(userStore);
+    matchStore = new TimedMatchStore(matchStore);
+}
+
+// Hands a finished game to the match store; the SQLite store queues it on
+// the write-behind thread so game flow never waits on fsync.
+void TicTacToe::queueMatchRecord(const MatchRecord &record) {
+    QString error;
+    if (!matchStore || !matchStore->append(record, &error)) {
+        handleMatchWriteFailed("Failed to save game result: " + error);
         return;
     }
+    userStore->recordGame(record);
+    if (leaderboard.isLoaded()) leaderboard.recordGame(record);
+    openingTrie.addGame(decodeMoves(record.moves));
+}
 
-    moveHistory.clear();
+// Read-your-writes: screens that query matches wait for queued games first
+void TicTacToe::flushPendingWrites() {
+    if (matchStore) {
+        matchStore->flush();
+    }
+}
+
+void TicTacToe::handleMatchWriteFailed(const QString &error) {
+    qWarning() << "Database Error:" << error;
+    leaderboard.clear(); // Counted a game that never landed; reload on next view
+    openingSnapshotValid = false; // Next start catches up from the previous snapshot instead
+    if (isTestRun) return;
+
+    // Non-modal so a failing disk never blocks the game
+    QMessageBox *box = new QMessageBox(QMessageBox::Warning, "Database Error", error, QMessageBox::Ok, this);
+    box->setAttribute(Qt::WA_DeleteOnClose);
+    box->open();
 }
 
 void TicTacToe::loadMatchHistory() {
-    matchHistoryTable->clearContents();
-    matchHistoryTable->setRowCount(0);
-
-    QSqlQuery query(this->db);
-    query.prepare("SELECT player1, player2, winner, result, timestamp, series_id, game_number, series_total "
-                  "FROM matches WHERE player1 = :user OR player2 = :user ORDER BY timestamp DESC");
-    query.bindValue(":user", loggedInUser);
-    query.exec();
-
-    int row = 0;
-    while (query.next()) {
-        matchHistoryTable->insertRow(row);
-
-        // Format display to show series information
-        QString seriesInfo = QString("Game %1/%2 (Series: %3)")
-                                 .arg(query.value(6).toInt())  // game_number
-                                 .arg(query.value(7).toInt())  // series_total
-                                 .arg(query.value(5).toString().right(8)); // last 8 chars of series_id
-
-        QStringList displayData = {
-            query.value(4).toString(), // timestamp
-            query.value(0).toString(), // player1
-            query.value(1).toString(), // player2
-            query.value(2).toString(), // winner
-            query.value(3).toString() + " (" + seriesInfo + ")" // result with series info
-        };
-
-        for (int col = 0; col < displayData.size(); ++col) {
-            QTableWidgetItem *item = new QTableWidgetItem(displayData[col]);
-            item->setTextAlignment(Qt::AlignCenter);
-            matchHistoryTable->setItem(row, col, item);
+    flushPendingWrites();
+    historySearchTimer->stop();
+    HistoryFilter filter;
+    QString error;
+    const bool parsed = HistoryFilter::parse(historySearchEdit->text(), &filter, &error);
+    if (!parsed) filter = HistoryFilter(); // Unfiltered until the search is fixed
+    historySearchStatus->setText(error);
+    historySearchStatus->setVisible(!parsed);
+    // Whole local days, both ends included; narrows from:/to: in the search
+    if (historyRangeCheck->isChecked()) {
+        DateRange range;
+        range.from = historyFromEdit->date().startOfDay().toMSecsSinceEpoch();
+        range.to = historyToEdit->date().addDays(1).startOfDay().toMSecsSinceEpoch();
+        filter.range = filter.range.intersected(range);
+    }
+    matchHistoryModel->setSource(matchStore, loggedInUser, filter); // First page only; the view fetches the rest on scroll
+    stackedWidget->setCurrentIndex(6);
+}
+
+// Streams the logged-in player's matches to a .jsonl or .tttc file (see matchexport.h)
+void TicTacToe::exportMatchHistory() {
+    if (loggedInUser.isEmpty() || !matchStore) return;
+    const QString path = QFileDialog::getSaveFileName(this, "Export Match History", loggedInUser + "-matches.jsonl",
+                                                      "JSON Lines (*.jsonl);;Columnar (*.tttc)");
+    if (path.isEmpty()) return;
+    MatchExport::Format format;
+    if (!MatchExport::formatForPath(path, &format)) {
+        QMessageBox::warning(this, "Export Match History", "Choose a .jsonl or .tttc file name.");
+        return;
+    }
+
+    flushPendingWrites();
+    // File databases are exported from a pool thread with its own connection
+    // (see connectionmanager.h); the window stays responsive and shows the
+    // count so far. Other backends aren't shared across threads.
+    if (matchStore->name() != "sqlite" || !connections || db.databaseName() == ":memory:") {
+        QSaveFile out(path);
+        qint64 rows = 0;
+        QString error;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const bool ok = out.open(QIODevice::WriteOnly) &&
+                        MatchExport::write(*matchStore, loggedInUser, format, &out, &rows, &error) && out.commit();
+        QApplication::restoreOverrideCursor();
+        if (!ok) {
+            QMessageBox::critical(this, "Export Failed", error.isEmpty() ? out.errorString() : error);
+            return;
         }
+        QMessageBox::information(this, "Export Match History", QString("Exported %1 matches to %2").arg(rows).arg(path));
+        return;
+    }
+    if (matchExport.isRunning()) return;
+
+    QPointer<QProgressDialog> progress = new QProgressDialog("Exporting match history...", "Cancel", 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(500);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    connect(progress, &QProgressDialog::canceled, this, [cancelled]() { *cancelled = true; });
+
+    struct Outcome {
+        bool ok = false;
+        qint64 rows = 0;
+        QString error;
+    };
+    auto outcome = std::make_shared<Outcome>();
+    ConnectionManager *manager = connections;
+    const QString user = loggedInUser;
+    matchExport = QtConcurrent::run([manager, user, path, format, progress, cancelled, outcome]() {
+        QSqlDatabase exportDb = manager->connection(&outcome->error);
+        if (exportDb.isValid()) {
+            SqliteMatchStore store(exportDb);
+            QSaveFile out(path);
+            outcome->ok = out.open(QIODevice::WriteOnly) &&
+                          MatchExport::write(store, user, format, &out, &outcome->rows, &outcome->error,
+                                             [progress, cancelled](qint64 rows) {
+                              QMetaObject::invokeMethod(progress, [progress, rows]() {
+                                  if (progress) progress->setLabelText(QString("Exported %1 matches...").arg(rows));
+                              }, Qt::QueuedConnection);
+                              return !*cancelled;
+                          }) &&
+                          out.commit();
+            if (!outcome->ok && outcome->error.isEmpty()) outcome->error = out.errorString();
+        }
+        exportDb = QSqlDatabase();
+        manager->release();
+    });
+
+    auto *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher, progress, outcome, path]() {
+        watcher->deleteLater();
+        if (progress) progress->close();
+        if (!outcome->ok) {
+            QMessageBox::critical(this, "Export Failed", outcome->error);
+            return;
+        }
+        QMessageBox::information(this, "Export Match History",
+                                 QString("Exported %1 matches to %2").arg(outcome->rows).arg(path));
+    });
+    watcher->setFuture(matchExport);
+}
 
-        ++row;
+// Top 10 plus the logged-in user's neighbourhood, both read from the
+// in-memory rank tree (O(log n) per row, no ORDER BY over users).
+void TicTacToe::loadLeaderboard() {
+    if (!leaderboard.isLoaded()) {
+        flushPendingWrites();
+        QString error;
+        if (!leaderboard.load(*userStore, &error)) {
+            if (!isTestRun) QMessageBox::warning(this, "Database Error", "Failed to load leaderboard: " + error);
+            return;
+        }
     }
 
-    stackedWidget->setCurrentIndex(6);
+    QVector<Leaderboard::Entry> rows = leaderboard.top(10);
+    const int rank = guestMode ? 0 : leaderboard.rankOf(loggedInUser);
+    if (rank > 10) {
+        Leaderboard::Entry separator;
+        rows.append(separator); // rank 0 renders as a "..." row
+        rows += leaderboard.around(loggedInUser, 3);
+    }
+
+    leaderboardTable->setRowCount(rows.size());
+    for (int row = 0; row < rows.size(); ++row) {
+        const Leaderboard::Entry &entry = rows[row];
+        const QStringList cells = entry.rank == 0
+            ? QStringList{"...", "", "", "", ""}
+            : QStringList{QString("#%1").arg(entry.rank), entry.username, QString::number(entry.wins),
+                          QString::number(entry.losses), QString::number(entry.ties)};
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem(cells[column]);
+            if (entry.rank == rank && rank > 0) {
+                QFont font = item->font();
+                font.setBold(true);
+                item->setFont(font);
+            }
+            leaderboardTable->setItem(row, column, item);
+        }
+    }
+
+    leaderboardRankLabel->setText(rank > 0
+        ? QString("Your rank: #%1 of %2").arg(rank).arg(leaderboard.size())
+        : QString("Log in with an account to be ranked (%1 players)").arg(leaderboard.size()));
+    stackedWidget->setCurrentIndex(8);
 }
 
 void TicTacToe::registerAccount() {
@@ -753,21 +968,25 @@ void TicTacToe::registerAccount() {
         QMessageBox::warning(this, "Registration Failed", "Username and password cannot be empty!");  }
         return;
     }
+    // Names must fit every storage backend, the match log's fixed-width fields included
+    if (username.toUtf8().size() > MatchLogStore::MaxNameBytes) {
+        if (!isTestRun) {
+            QMessageBox::warning(this, "Registration Failed",
+                                 QString("Username is too long (at most %1 bytes).").arg(MatchLogStore::MaxNameBytes));
+        }
+        return;
+    }
 
     QByteArray salt = generateSalt(16);
     QString hashed = pbkdf2Hash(password, salt, 10000, 32);
 
-    QSqlQuery query(this->db);
-    // Fixed: Use 'password_hash' instead of 'password'
-    query.prepare("INSERT INTO users (username, password_hash, salt) VALUES (:username, :password_hash, :salt)");
-    query.bindValue(":username", username);
-    query.bindValue(":password_hash", hashed);  // Changed from :password to :password_hash
-    query.bindValue(":salt", QString(salt.toHex()));
-
-    if (!query.exec()) {
-        QMessageBox::warning(this, "Registration Failed", "Error: " + query.lastError().text());
+    qint64 userId = 0;
+    QString error;
+    if (!userStore->addUser(username, hashed, QString(salt.toHex()), &userId, &error)) {
+        QMessageBox::warning(this, "Registration Failed", "Error: " + error);
         return;
     }
+    if (leaderboard.isLoaded()) leaderboard.addUser(userId, username);
   if (!isTestRun) {
     QMessageBox::information(this, "Registration Success", "Account created successfully!"); }
     usernameEdit->clear();
@@ -781,6 +1000,8 @@ void TicTacToe::guestLogin() {
     stackedWidget->setCurrentIndex(1);
     usernameEdit->clear();
     passwordEdit->clear();
+    openGameJournal();
+    offerResume();
 }
 
 void TicTacToe::handleSurrender() {
@@ -851,28 +1072,14 @@ QString TicTacToe::pbkdf2Hash(const QString &password, const QByteArray &salt, i
     return derivedKey.left(dkLen).toHex();
 }
 void TicTacToe::loadRecordedMatchesScreen() {
-    recordedMatchesTable->clearContents();
-    recordedMatchesTable->setRowCount(0);
-
-    QSqlQuery query;
-    query.prepare("SELECT id, player1, player2, winner, result, timestamp FROM matches WHERE player1 = :user OR player2 = :user ORDER BY timestamp DESC");
-    query.bindValue(":user", loggedInUser);
-    query.exec();
-
-    int row = 0;
-    while (query.next()) {
-        recordedMatchesTable->insertRow(row);
-        for (int col = 0; col < 6; ++col) {
-            QTableWidgetItem *item = new QTableWidgetItem(query.value(col).toString());
-            item->setTextAlignment(Qt::AlignCenter);
-            recordedMatchesTable->setItem(row, col, item);
-        }
-        ++row;
-    }
-
+    flushPendingWrites();
+    recordedMatchesModel->setSource(matchStore, loggedInUser);
     stackedWidget->setCurrentIndex(7); // Show recorded match screen
 }
 void TicTacToe::resetGameState() {
+    // Series is over (surrender/logout): let a per-series batch commit
+    if (dbWriter) dbWriter->endSeries();
+
     // Reset game counters
     player1Wins = 0;
     player2Wins = 0;
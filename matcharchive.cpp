@@ -0,0 +1,440 @@
+#include "matcharchive.h"
+#include "matchexport.h"
+#include "schemamigrator.h"
+#include "sqlitematchstore.h"
+#include <QBuffer>
+#include <QDateTime>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+
+namespace {
+
+constexpr unsigned long PassIntervalMs = 60 * 60 * 1000;
+constexpr unsigned long BatchPauseMs = 50; // Between batches of one pass
+
+// Per-series totals of the batch, added to what earlier batches archived
+const char *const SeriesTotalsQuery =
+    "INSERT INTO archived_series (series_key, game_mode, total, target, player1, player2, "
+    "games, player1_wins, player2_wins, ties, first_played_at, last_played_at) "
+    "SELECT COALESCE(s.series_key, m.series_id), MAX(COALESCE(s.game_mode, m.game_mode)), "
+    "MAX(COALESCE(s.total, m.series_total)), MAX(COALESCE(s.target, m.series_target)), "
+    "MIN(m.player1), MIN(m.player2), COUNT(*), SUM(m.winner = m.player1), SUM(m.winner = m.player2), "
+    "SUM(m.winner = '-'), MIN(m.played_at), MAX(m.played_at) "
+    "FROM matches m LEFT JOIN series s ON s.id = m.series_ref "
+    "WHERE m.id IN (SELECT id FROM temp.archive_batch) AND COALESCE(s.series_key, m.series_id, '') <> '' "
+    "GROUP BY 1 "
+    "ON CONFLICT (series_key) DO UPDATE SET "
+    "games = games + excluded.games, "
+    "player1_wins = player1_wins + excluded.player1_wins, "
+    "player2_wins = player2_wins + excluded.player2_wins, "
+    "ties = ties + excluded.ties, "
+    "first_played_at = MIN(first_played_at, excluded.first_played_at), "
+    "last_played_at = MAX(last_played_at, excluded.last_played_at)";
+
+void timestampRange(const QVector<QPair<qint64, MatchRecord>> &rows, QString *oldest, QString *newest) {
+    qint64 first = playedAtOf(rows.first().second);
+    qint64 last = first;
+    for (const auto &row : rows) {
+        first = qMin(first, playedAtOf(row.second));
+        last = qMax(last, playedAtOf(row.second));
+    }
+    *oldest = timestampText(first);
+    *newest = timestampText(last);
+}
+
+} // namespace
+
+bool MatchArchive::ChunkReader::find(qint64 wantedChunk, qint64 matchId, MatchRecord *record, QString *error) {
+    if (wantedChunk != chunkId) {
+        QSqlQuery query(db);
+        query.prepare("SELECT payload FROM archive_chunks WHERE id = :id");
+        query.bindValue(":id", wantedChunk);
+        if (!query.exec() || !query.next()) {
+            if (error) *error = query.lastError().isValid() ? query.lastError().text()
+                                                            : QString("Archive chunk %1 not found").arg(wantedChunk);
+            return false;
+        }
+        QVector<QPair<qint64, MatchRecord>> rows;
+        if (!decodeChunk(query.value(0).toByteArray(), &rows, error)) return false;
+        records.clear();
+        for (const auto &row : std::as_const(rows)) records.insert(row.first, row.second);
+        chunkId = wantedChunk;
+    }
+    const auto it = records.constFind(matchId);
+    if (it == records.constEnd()) {
+        if (error) *error = QString("Match %1 missing from archive chunk %2").arg(matchId).arg(wantedChunk);
+        return false;
+    }
+    *record = *it;
+    return true;
+}
+
+MatchArchive::MatchArchive(ConnectionManager *connections, QObject *parent)
+    : QThread(parent), connections(connections) {}
+
+MatchArchive::~MatchArchive() {
+    stop();
+}
+
+void MatchArchive::setPolicy(int newRetentionDays, int newBatchRows) {
+    QMutexLocker locker(&mutex);
+    retentionDays = qMax(1, newRetentionDays);
+    batchRows = qMax(1, newBatchRows);
+    requested = true;
+    wake.wakeAll();
+}
+
+// Returns false for "off"; the outputs get the defaults either way
+bool MatchArchive::policyFromString(const QString &text, int *retentionDays, int *batchRows) {
+    *retentionDays = 0;
+    *batchRows = DefaultBatchRows;
+    const QString value = text.trimmed().toLower();
+    bool ok = false;
+    const int days = value.section(':', 0, 0).toInt(&ok);
+    if (!ok || days <= 0) return false; // Also "off" and unset
+
+    *retentionDays = days;
+    const int rows = value.section(':', 1).toInt(&ok);
+    if (ok && rows > 0) *batchRows = rows;
+    return true;
+}
+
+void MatchArchive::requestPass() {
+    QMutexLocker locker(&mutex);
+    requested = true;
+    wake.wakeOne();
+}
+
+void MatchArchive::stop() {
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        wake.wakeAll();
+    }
+    wait(); // A batch in progress commits or rolls back, never half-moves
+}
+
+void MatchArchive::run() {
+    // Qt SQL connections are thread-affine, so the archive's thread gets its own
+    {
+        QString openError;
+        QSqlDatabase db = connections->connection(&openError);
+        if (!db.isValid()) {
+            emit archiveFailed("Failed to open database for archiving: " + openError);
+        } else {
+            QMutexLocker locker(&mutex);
+            while (!stopping) {
+                if (!requested) wake.wait(&mutex, PassIntervalMs);
+                if (stopping) break;
+                requested = false;
+                const qint64 cutoff = cutoffFor(retentionDays);
+                const int rows = batchRows;
+                locker.unlock();
+
+                int total = 0;
+                int moved = 0;
+                QString error;
+                forever {
+                    moved = archiveBatch(db, cutoff, rows, &error);
+                    if (moved > 0) total += moved;
+                    if (moved < rows) break;
+                    QMutexLocker pause(&mutex);
+                    if (stopping || wake.wait(&mutex, BatchPauseMs)) break; // Woken: stop or a new pass
+                }
+                if (moved < 0) {
+                    qWarning() << "MatchArchive: archiving" << connections->databasePath() << "failed:" << error;
+                    emit archiveFailed(error);
+                }
+                if (total > 0) emit archived(total);
+                locker.relock();
+            }
+        }
+    }
+    connections->release();
+}
+
+qint64 MatchArchive::cutoffFor(int retentionDays) {
+    return QDateTime::currentMSecsSinceEpoch() - qint64(retentionDays) * 24 * 60 * 60 * 1000;
+}
+
+// Rows the played_at backfill hasn't reached yet wait for a later pass
+int MatchArchive::archiveBatch(QSqlDatabase &db, qint64 cutoff, int batchRows, QString *error) {
+    if (!db.transaction()) {
+        if (error) *error = db.lastError().text();
+        return -1;
+    }
+    QString problem;
+    auto fail = [&db, &problem, error](const QSqlQuery *query) {
+        if (error) *error = query ? query->lastError().text() : problem;
+        db.rollback();
+        return -1;
+    };
+
+    QSqlQuery query(db);
+    if (!SchemaMigrator::execAll(db, {
+            "CREATE TEMP TABLE IF NOT EXISTS archive_batch (id INTEGER PRIMARY KEY)",
+            "DELETE FROM temp.archive_batch"}, &problem)) {
+        return fail(nullptr);
+    }
+    query.prepare("INSERT INTO temp.archive_batch (id) "
+                  "SELECT id FROM matches WHERE played_at < :cutoff ORDER BY played_at, id LIMIT :limit");
+    query.bindValue(":cutoff", cutoff);
+    query.bindValue(":limit", batchRows);
+    if (!query.exec()) return fail(&query);
+    if (query.numRowsAffected() <= 0) {
+        db.commit();
+        return 0;
+    }
+
+    QVector<QPair<qint64, MatchRecord>> rows;
+    if (!query.exec(SqliteMatchStore::selectRecords("m.id IN (SELECT id FROM temp.archive_batch)") + " ORDER BY m.id")) {
+        return fail(&query);
+    }
+    while (query.next()) rows.append({query.value(0).toLongLong(), SqliteMatchStore::recordFromQuery(query, 1)});
+    query.finish();
+
+    QByteArray payload;
+    if (!encodeChunk(rows, &payload)) {
+        problem = "cannot encode archive chunk";
+        return fail(nullptr);
+    }
+    QString oldest;
+    QString newest;
+    timestampRange(rows, &oldest, &newest);
+    query.prepare("INSERT INTO archive_chunks (games, oldest, newest, payload) "
+                  "VALUES (:games, :oldest, :newest, :payload)");
+    query.bindValue(":games", rows.size());
+    query.bindValue(":oldest", oldest);
+    query.bindValue(":newest", newest);
+    query.bindValue(":payload", payload);
+    if (!query.exec()) return fail(&query);
+    const qint64 chunkId = query.lastInsertId().toLongLong();
+
+    query.prepare("INSERT INTO archived_matches (match_id, chunk_id) SELECT id, :chunk FROM temp.archive_batch");
+    query.bindValue(":chunk", chunkId);
+    if (!query.exec()) return fail(&query);
+
+    // Indexed by name so rows the player-id backfill hasn't linked yet are found too
+    if (!SchemaMigrator::execAll(db, {
+            "INSERT OR IGNORE INTO archived_players (username, timestamp, played_at, match_id) "
+            "SELECT u.username, COALESCE(m.timestamp, ''), m.played_at, m.id FROM matches m "
+            "JOIN users u ON u.username IN (m.player1, m.player2) "
+            "WHERE m.id IN (SELECT id FROM temp.archive_batch)",
+            SeriesTotalsQuery,
+            "DELETE FROM match_players WHERE match_id IN (SELECT id FROM temp.archive_batch)",
+            "DELETE FROM matches WHERE id IN (SELECT id FROM temp.archive_batch)"}, &problem)) {
+        return fail(nullptr);
+    }
+
+    if (!db.commit()) {
+        problem = db.lastError().text();
+        return fail(nullptr);
+    }
+    return rows.size();
+}
+
+bool MatchArchive::loadMatch(QSqlDatabase &db, qint64 id, MatchRecord *record, bool *found, QString *error) {
+    QSqlQuery query(db);
+    query.prepare("SELECT chunk_id FROM archived_matches WHERE match_id = :id");
+    query.bindValue(":id", id);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    *found = query.next();
+    if (!*found) return true;
+    ChunkReader chunks(db);
+    return chunks.find(query.value(0).toLongLong(), id, record, error);
+}
+
+// Same keyset as SqliteMatchStore::historyPage, over archived_players.
+// The index only knows dates, so facets are checked on the decoded games,
+// reading on until the page is full or the user's archive runs out.
+bool MatchArchive::historyPage(QSqlDatabase &db, const QString &user, const HistoryFilter &filter, const MatchSummary *after,
+                               int limit, QVector<MatchSummary> *page, QString *error) {
+    page->clear();
+    ChunkReader chunks(db);
+    MatchSummary cursor; // Last row read, matching or not
+    bool resume = after != nullptr;
+    if (after) cursor = *after;
+    forever {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare(QString("SELECT a.match_id, a.played_at, m.chunk_id FROM archived_players a "
+                              "JOIN archived_matches m ON m.match_id = a.match_id "
+                              "WHERE a.username = :user AND a.played_at >= :from AND %1 "
+                              "ORDER BY a.played_at DESC, a.match_id DESC LIMIT :limit")
+                          .arg(resume ? "(a.played_at, a.match_id) < (:played_at, :id)" : "a.played_at < :to"));
+        query.bindValue(":user", user);
+        query.bindValue(":from", filter.range.from);
+        query.bindValue(":limit", limit);
+        if (resume) {
+            query.bindValue(":played_at", cursor.playedAt);
+            query.bindValue(":id", cursor.id);
+        } else {
+            query.bindValue(":to", filter.range.to);
+        }
+        if (!query.exec()) {
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+
+        int read = 0;
+        while (page->size() < limit && query.next()) {
+            ++read;
+            MatchRecord record;
+            if (!chunks.find(query.value(2).toLongLong(), query.value(0).toLongLong(), &record, error)) return false;
+            cursor.id = query.value(0).toLongLong();
+            cursor.playedAt = query.value(1).toLongLong();
+            if (filter.hasFacets() && !filter.matches(user, record)) continue;
+            MatchSummary row;
+            row.id = cursor.id;
+            row.player1 = record.player1;
+            row.player2 = record.player2;
+            row.winner = record.winner;
+            row.result = record.result;
+            row.playedAt = cursor.playedAt;
+            row.seriesId = record.seriesId;
+            row.gameNumber = record.gameNumber;
+            row.seriesTotal = record.seriesTotal;
+            row.timestamp = record.timestamp;
+            page->append(row);
+        }
+        if (page->size() >= limit || read < limit) return true;
+        resume = true;
+    }
+}
+
+// A game leaves the archive with either player, as it leaves matches by cascade
+bool MatchArchive::removeUser(QSqlDatabase &db, const QString &user, QString *error) {
+    QSqlQuery query(db);
+    query.prepare("SELECT DISTINCT m.chunk_id FROM archived_players a "
+                  "JOIN archived_matches m ON m.match_id = a.match_id WHERE a.username = :user");
+    query.bindValue(":user", user);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    QVector<qint64> chunkIds;
+    while (query.next()) chunkIds.append(query.value(0).toLongLong());
+    query.finish();
+
+    if (!db.transaction()) {
+        if (error) *error = db.lastError().text();
+        return false;
+    }
+    QString problem;
+    QSqlQuery forget(db);
+    forget.prepare("DELETE FROM archived_players WHERE match_id = :id");
+    QSqlQuery unindex(db);
+    unindex.prepare("DELETE FROM archived_matches WHERE match_id = :id");
+    bool ok = true;
+    for (int i = 0; i < chunkIds.size() && ok; ++i) {
+        query.prepare("SELECT payload FROM archive_chunks WHERE id = :id");
+        query.bindValue(":id", chunkIds[i]);
+        QVector<QPair<qint64, MatchRecord>> rows;
+        ok = query.exec() && query.next() && decodeChunk(query.value(0).toByteArray(), &rows, &problem);
+        if (!ok) break;
+
+        QVector<QPair<qint64, MatchRecord>> kept;
+        for (const auto &row : std::as_const(rows)) {
+            if (row.second.player1 != user && row.second.player2 != user) {
+                kept.append(row);
+                continue;
+            }
+            forget.bindValue(":id", row.first);
+            unindex.bindValue(":id", row.first);
+            ok = ok && forget.exec() && unindex.exec();
+        }
+        if (!ok) break;
+
+        if (kept.isEmpty()) {
+            query.prepare("DELETE FROM archive_chunks WHERE id = :id");
+        } else {
+            QByteArray payload;
+            QString oldest;
+            QString newest;
+            if (!encodeChunk(kept, &payload)) {
+                problem = "cannot encode archive chunk";
+                ok = false;
+                break;
+            }
+            timestampRange(kept, &oldest, &newest);
+            query.prepare("UPDATE archive_chunks SET games = :games, oldest = :oldest, newest = :newest, "
+                          "payload = :payload WHERE id = :id");
+            query.bindValue(":games", kept.size());
+            query.bindValue(":oldest", oldest);
+            query.bindValue(":newest", newest);
+            query.bindValue(":payload", payload);
+        }
+        query.bindValue(":id", chunkIds[i]);
+        ok = query.exec();
+    }
+    if (ok) {
+        query.prepare("DELETE FROM archived_series WHERE player1 = :user OR player2 = :user");
+        query.bindValue(":user", user);
+        ok = query.exec();
+    }
+
+    if (ok && !db.commit()) {
+        problem = db.lastError().text();
+        ok = false;
+    }
+    if (!ok) {
+        if (problem.isEmpty()) {
+            for (const QSqlQuery *failed : {&query, &forget, &unindex}) {
+                if (failed->lastError().isValid()) problem = failed->lastError().text();
+            }
+        }
+        if (error) *error = problem;
+        db.rollback();
+    }
+    return ok;
+}
+
+bool MatchArchive::seriesTotals(QSqlDatabase &db, const QString &seriesKey, SeriesTotals *totals, QString *error) {
+    QSqlQuery query(db);
+    query.prepare("SELECT game_mode, total, target, player1, player2, games, player1_wins, player2_wins, ties, "
+                  "first_played_at, last_played_at FROM archived_series WHERE series_key = :key");
+    query.bindValue(":key", seriesKey);
+    if (!query.exec() || !query.next()) {
+        if (error) *error = query.lastError().isValid() ? query.lastError().text()
+                                                        : "No archived games for series " + seriesKey;
+        return false;
+    }
+    totals->gameMode = query.value(0).toString();
+    totals->total = query.value(1).toInt();
+    totals->target = query.value(2).toInt();
+    totals->player1 = query.value(3).toString();
+    totals->player2 = query.value(4).toString();
+    totals->games = query.value(5).toInt();
+    totals->player1Wins = query.value(6).toInt();
+    totals->player2Wins = query.value(7).toInt();
+    totals->ties = query.value(8).toInt();
+    totals->firstPlayedAt = query.value(9).toLongLong();
+    totals->lastPlayedAt = query.value(10).toLongLong();
+    return true;
+}
+
+bool MatchArchive::decodeChunk(const QByteArray &payload, QVector<QPair<qint64, MatchRecord>> *rows, QString *error) {
+    QByteArray raw = qUncompress(payload);
+    if (raw.isEmpty()) {
+        if (error) *error = "corrupt archive chunk";
+        return false;
+    }
+    QBuffer buffer(&raw);
+    buffer.open(QIODevice::ReadOnly);
+    return MatchExport::readColumnar(&buffer, [rows](qint64 id, const MatchRecord &record) {
+        rows->append({id, record});
+    }, error);
+}
+
+bool MatchArchive::encodeChunk(const QVector<QPair<qint64, MatchRecord>> &rows, QByteArray *payload) {
+    QByteArray raw;
+    QBuffer buffer(&raw);
+    buffer.open(QIODevice::WriteOnly);
+    if (!MatchExport::writeColumnar(rows, &buffer)) return false;
+    *payload = qCompress(raw, 9); // Written once, read rarely
+    return true;
+}
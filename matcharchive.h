@@ -0,0 +1,104 @@
+#ifndef MATCHARCHIVE_H
+#define MATCHARCHIVE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QVector>
+#include "connectionmanager.h"
+#include "matchstore.h"
+
+// Retention tiering: games older than the retention period leave the
+// matches table for compressed chunks, so the live tables and their
+// indexes only hold recent games.
+//
+// A batch takes the oldest batchRows games before the cutoff, in one
+// transaction:
+//   archive_chunks    the games as a qCompress'ed columnar file (see
+//                     matchexport.h), ids preserved
+//   archived_matches  match id -> chunk, for replays and scans
+//   archived_players  (username, played_at, match id), the history index
+//   archived_series   per-series totals, added to as later games follow
+// and deletes them from matches (match_players goes with them). user_stats
+// is only ever added to, so profiles and the leaderboard keep counting
+// archived games; a from-scratch rebuildUserStats() replays them from the
+// chunks.
+//
+// SqliteMatchStore merges the archive back into history pages, replays and
+// scans; deleting an account rewrites the chunks holding its games. The
+// background thread runs a pass at start and then hourly, one batch at a
+// time on its own connection (from the ConnectionManager) so the GUI and
+// the writer get in between.
+class MatchArchive : public QThread {
+    Q_OBJECT
+public:
+    static constexpr int DefaultBatchRows = 500;
+
+    struct SeriesTotals {
+        QString gameMode;
+        int total = 0;
+        int target = 0;
+        QString player1;
+        QString player2;
+        int games = 0;
+        int player1Wins = 0;
+        int player2Wins = 0;
+        int ties = 0;
+        qint64 firstPlayedAt = 0; // Epoch ms UTC
+        qint64 lastPlayedAt = 0;
+    };
+
+    // Decodes archive chunks on demand, keeping the last one
+    class ChunkReader {
+    public:
+        explicit ChunkReader(const QSqlDatabase &db) : db(db) {}
+        bool find(qint64 chunkId, qint64 matchId, MatchRecord *record, QString *error = nullptr);
+
+    private:
+        QSqlDatabase db;
+        qint64 chunkId = -1;
+        QHash<qint64, MatchRecord> records;
+    };
+
+    explicit MatchArchive(ConnectionManager *connections, QObject *parent = nullptr);
+    ~MatchArchive() override;
+
+    void setPolicy(int retentionDays, int batchRows);
+    // "off", "<days>" or "<days>:<batch rows>"; off by default
+    static bool policyFromString(const QString &text, int *retentionDays, int *batchRows);
+
+    void requestPass();
+    void stop();
+
+    // Synchronous building blocks, also used by SqliteMatchStore and main
+    static qint64 cutoffFor(int retentionDays); // Games played before this (epoch ms UTC) are archived
+    static int archiveBatch(QSqlDatabase &db, qint64 cutoff, int batchRows, QString *error = nullptr); // Games moved, -1 on failure
+    static bool loadMatch(QSqlDatabase &db, qint64 id, MatchRecord *record, bool *found, QString *error = nullptr);
+    static bool historyPage(QSqlDatabase &db, const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                            QVector<MatchSummary> *page, QString *error = nullptr);
+    static bool removeUser(QSqlDatabase &db, const QString &user, QString *error = nullptr);
+    static bool seriesTotals(QSqlDatabase &db, const QString &seriesKey, SeriesTotals *totals, QString *error = nullptr);
+
+signals:
+    void archived(int games);
+    void archiveFailed(const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    static bool decodeChunk(const QByteArray &payload, QVector<QPair<qint64, MatchRecord>> *rows, QString *error);
+    static bool encodeChunk(const QVector<QPair<qint64, MatchRecord>> &rows, QByteArray *payload);
+
+    ConnectionManager *connections;
+    QMutex mutex;
+    QWaitCondition wake;
+    int retentionDays = 0;
+    int batchRows = DefaultBatchRows;
+    bool requested = true; // First pass right away
+    bool stopping = false;
+};
+
+#endif // MATCHARCHIVE_H
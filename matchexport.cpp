@@ -0,0 +1,289 @@
+#include "matchexport.h"
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const char Magic[4] = {'T', 'T', 'T', 'C'};
+constexpr quint8 Version = 1;
+constexpr quint32 MaxGroupRows = 1u << 20;   // Sanity bounds for reading damaged files
+constexpr quint32 MaxEntrySize = 1u << 20;
+
+enum Column {
+    Player1, Player2, Winner, Result, Moves, Timestamp, StartingPlayer, GameMode,
+    Difficulty, SeriesId, GameNumber, SeriesTotal, SeriesTarget, ColumnCount
+};
+
+template <typename T>
+void appendLE(QByteArray &bytes, T value) {
+    const int at = bytes.size();
+    bytes.resize(at + int(sizeof(T)));
+    qToLittleEndian<T>(value, bytes.data() + at);
+}
+
+QByteArray intValue(int value) {
+    QByteArray bytes;
+    appendLE<qint32>(bytes, value);
+    return bytes;
+}
+
+QByteArray columnValue(const MatchRecord &record, int column) {
+    switch (column) {
+    case Player1: return record.player1.toUtf8();
+    case Player2: return record.player2.toUtf8();
+    case Winner: return record.winner.toUtf8();
+    case Result: return record.result.toUtf8();
+    case Moves: return record.moves;
+    case Timestamp: return record.timestamp.toUtf8();
+    case StartingPlayer: return record.startingPlayer.toUtf8();
+    case GameMode: return record.gameMode.toUtf8();
+    case Difficulty: return intValue(record.difficulty);
+    case SeriesId: return record.seriesId.toUtf8();
+    case GameNumber: return intValue(record.gameNumber);
+    case SeriesTotal: return intValue(record.seriesTotal);
+    case SeriesTarget: return intValue(record.seriesTarget);
+    }
+    return QByteArray();
+}
+
+bool setColumnValue(MatchRecord *record, int column, const QByteArray &value) {
+    const bool isInt = column == Difficulty || column == GameNumber || column == SeriesTotal || column == SeriesTarget;
+    if (isInt && value.size() != 4) return false;
+    const int number = isInt ? qFromLittleEndian<qint32>(value.constData()) : 0;
+    switch (column) {
+    case Player1: record->player1 = QString::fromUtf8(value); break;
+    case Player2: record->player2 = QString::fromUtf8(value); break;
+    case Winner: record->winner = QString::fromUtf8(value); break;
+    case Result: record->result = QString::fromUtf8(value); break;
+    case Moves: record->moves = value; break;
+    case Timestamp: record->timestamp = QString::fromUtf8(value); break;
+    case StartingPlayer: record->startingPlayer = QString::fromUtf8(value); break;
+    case GameMode: record->gameMode = QString::fromUtf8(value); break;
+    case Difficulty: record->difficulty = number; break;
+    case SeriesId: record->seriesId = QString::fromUtf8(value); break;
+    case GameNumber: record->gameNumber = number; break;
+    case SeriesTotal: record->seriesTotal = number; break;
+    case SeriesTarget: record->seriesTarget = number; break;
+    }
+    return true;
+}
+
+// Buffers one row group; each column keeps the distinct values it has seen
+// in this group and a code per row.
+class ColumnarWriter {
+public:
+    explicit ColumnarWriter(QIODevice *out) : out(out) {}
+
+    bool begin() {
+        QByteArray header(Magic, sizeof(Magic));
+        header.append(char(Version));
+        header.append(char(ColumnCount + 1));
+        return out->write(header) == header.size();
+    }
+
+    bool add(qint64 id, const MatchRecord &record) {
+        ids.append(id);
+        for (int column = 0; column < ColumnCount; ++column) {
+            Dictionary &dictionary = columns[column];
+            const QByteArray value = columnValue(record, column);
+            auto it = dictionary.codes.constFind(value);
+            if (it == dictionary.codes.constEnd()) {
+                it = dictionary.codes.insert(value, quint32(dictionary.entries.size()));
+                dictionary.entries.append(value);
+            }
+            dictionary.rows.append(*it);
+        }
+        return ids.size() < MatchExport::RowGroupRows || flushGroup();
+    }
+
+    bool finish() {
+        QByteArray end;
+        appendLE<quint32>(end, 0);
+        return flushGroup() && out->write(end) == end.size();
+    }
+
+private:
+    struct Dictionary {
+        QHash<QByteArray, quint32> codes;
+        QVector<QByteArray> entries;
+        QVector<quint32> rows;
+    };
+
+    bool flushGroup() {
+        if (ids.isEmpty()) return true;
+        QByteArray group;
+        appendLE<quint32>(group, quint32(ids.size()));
+        for (qint64 id : std::as_const(ids)) appendLE<qint64>(group, id);
+        for (Dictionary &dictionary : columns) {
+            appendLE<quint32>(group, quint32(dictionary.entries.size()));
+            for (const QByteArray &entry : std::as_const(dictionary.entries)) {
+                appendLE<quint32>(group, quint32(entry.size()));
+                group.append(entry);
+            }
+            const int width = dictionary.entries.size() <= 0x100 ? 1 : dictionary.entries.size() <= 0x10000 ? 2 : 4;
+            group.append(char(width));
+            for (quint32 code : std::as_const(dictionary.rows)) {
+                if (width == 1) group.append(char(code));
+                else if (width == 2) appendLE<quint16>(group, quint16(code));
+                else appendLE<quint32>(group, code);
+            }
+            dictionary = Dictionary();
+        }
+        ids.clear();
+        return out->write(group) == group.size();
+    }
+
+    QIODevice *out;
+    QVector<qint64> ids;
+    Dictionary columns[ColumnCount];
+};
+
+bool readExact(QIODevice *in, char *data, qint64 size) {
+    return size == 0 || in->read(data, size) == size;
+}
+
+template <typename T>
+bool readLE(QIODevice *in, T *value) {
+    char bytes[sizeof(T)];
+    if (!readExact(in, bytes, sizeof(T))) return false;
+    *value = qFromLittleEndian<T>(bytes);
+    return true;
+}
+
+} // namespace
+
+bool MatchExport::formatForPath(const QString &path, Format *format) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "jsonl") *format = Format::Jsonl;
+    else if (suffix == "tttc") *format = Format::Columnar;
+    else return false;
+    return true;
+}
+
+QByteArray MatchExport::toJsonLine(qint64 id, const MatchRecord &record) {
+    QStringList moves;
+    for (int cell : decodeMoves(record.moves)) moves << QString::number(cell);
+
+    QJsonObject object;
+    object["id"] = id;
+    object["player1"] = record.player1;
+    object["player2"] = record.player2;
+    object["winner"] = record.winner;
+    object["result"] = record.result;
+    object["moves"] = moves.join(',');
+    object["timestamp"] = record.timestamp;
+    object["starting_player"] = record.startingPlayer;
+    object["game_mode"] = record.gameMode;
+    object["difficulty"] = record.difficulty;
+    object["series_id"] = record.seriesId;
+    object["game_number"] = record.gameNumber;
+    object["series_total"] = record.seriesTotal;
+    object["series_target"] = record.seriesTarget;
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool MatchExport::write(MatchStore &store, const QString &user, Format format, QIODevice *out,
+                        qint64 *rows, QString *error, const ProgressCallback &progress) {
+    qint64 written = 0;
+    ColumnarWriter columnar(out);
+    bool ok = format != Format::Columnar || columnar.begin();
+    bool cancelled = false;
+    QString scanError;
+    const MatchStore::Visitor visit = [&](qint64 id, const MatchRecord &record) {
+        if (!ok) return; // A scan can't be cut short; the rest is skipped
+        if (format == Format::Jsonl) {
+            const QByteArray line = toJsonLine(id, record);
+            ok = out->write(line) == line.size();
+        } else {
+            ok = columnar.add(id, record);
+        }
+        if (ok) ++written;
+        if (ok && progress && written % ProgressRows == 0 && !progress(written)) {
+            ok = false;
+            cancelled = true;
+        }
+    };
+    const bool scanned = ok && (user.isEmpty() ? store.scan(0, visit, &scanError)
+                                               : store.scanUser(user, visit, &scanError));
+    if (ok && scanned && format == Format::Columnar) ok = columnar.finish();
+
+    if (rows) *rows = written;
+    if (!ok || !scanned) {
+        if (error) *error = cancelled ? "Export cancelled" : scanError.isEmpty() ? out->errorString() : scanError;
+        return false;
+    }
+    return true;
+}
+
+bool MatchExport::writeColumnar(const QVector<QPair<qint64, MatchRecord>> &rows, QIODevice *out) {
+    ColumnarWriter columnar(out);
+    bool ok = columnar.begin();
+    for (int i = 0; i < rows.size() && ok; ++i) ok = columnar.add(rows[i].first, rows[i].second);
+    return ok && columnar.finish();
+}
+
+bool MatchExport::readColumnar(QIODevice *in, const MatchStore::Visitor &visit, QString *error) {
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    char header[6];
+    if (!readExact(in, header, sizeof(header)) || memcmp(header, Magic, sizeof(Magic)) != 0) {
+        return fail("not a columnar match export");
+    }
+    if (quint8(header[4]) != Version || quint8(header[5]) != ColumnCount + 1) {
+        return fail(QString("unsupported export version %1").arg(quint8(header[4])));
+    }
+
+    forever {
+        quint32 rowCount = 0;
+        if (!readLE(in, &rowCount)) return fail("truncated export");
+        if (rowCount == 0) return true;
+        if (rowCount > MaxGroupRows) return fail("corrupt row group");
+
+        QVector<qint64> ids(rowCount);
+        for (qint64 &id : ids) {
+            if (!readLE(in, &id)) return fail("truncated export");
+        }
+        QVector<MatchRecord> records(rowCount);
+        for (int column = 0; column < ColumnCount; ++column) {
+            quint32 entryCount = 0;
+            if (!readLE(in, &entryCount) || entryCount > rowCount) return fail("corrupt dictionary");
+            QVector<QByteArray> entries(entryCount);
+            for (QByteArray &entry : entries) {
+                quint32 size = 0;
+                if (!readLE(in, &size) || size > MaxEntrySize) return fail("corrupt dictionary");
+                entry.resize(size);
+                if (!readExact(in, entry.data(), size)) return fail("truncated export");
+            }
+            quint8 width = 0;
+            if (!readLE(in, &width) || (width != 1 && width != 2 && width != 4)) return fail("corrupt column");
+            for (MatchRecord &record : records) {
+                quint32 code = 0;
+                bool read = false;
+                if (width == 1) {
+                    quint8 value = 0;
+                    read = readLE(in, &value);
+                    code = value;
+                } else if (width == 2) {
+                    quint16 value = 0;
+                    read = readLE(in, &value);
+                    code = value;
+                } else {
+                    read = readLE(in, &code);
+                }
+                if (!read || code >= entryCount || !setColumnValue(&record, column, entries[code])) {
+                    return fail("corrupt column");
+                }
+            }
+        }
+        for (quint32 row = 0; row < rowCount; ++row) visit(ids[row], records[row]);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef MATCHEXPORT_H
+#define MATCHEXPORT_H
+
+#include <QIODevice>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "matchstore.h"
+
+// Streaming export of a MatchStore, for everyone or for one player.
+//
+// Rows come straight from MatchStore::scan() (scanUser() for one player)
+// and are written as they arrive, so memory stays constant whatever the
+// history size.
+//
+// JSONL: one object per match, with the same keys as the write-behind
+// journal ("moves" as "0,4,8") plus "id".
+//
+// Columnar (.tttc), all integers little-endian:
+//   "TTTC" u8 version u8 columns
+//   row group*  u32 rows, then every column of those rows contiguously:
+//               id:     rows x i64
+//               others: u32 entries, entries x (u32 size, bytes),
+//                       u8 code width (1, 2 or 4), rows x code
+//   u32 0       end of file
+// Columns after id, in order: player1 player2 winner result moves
+// timestamp starting_player game_mode difficulty series_id game_number
+// series_total series_target. Text is UTF-8, moves are MoveCodec bytes,
+// numbers are i32. Dictionaries are per row group, which bounds the
+// memory on both sides to RowGroupRows rows.
+class MatchExport {
+public:
+    enum class Format { Jsonl, Columnar };
+    static constexpr int RowGroupRows = 4096;
+    static constexpr int ProgressRows = 1024;
+
+    // Rows written so far, every ProgressRows rows; false cancels the export
+    using ProgressCallback = std::function<bool(qint64 rows)>;
+
+    // By file suffix: .jsonl, .tttc
+    static bool formatForPath(const QString &path, Format *format);
+
+    // user empty: every match
+    static bool write(MatchStore &store, const QString &user, Format format, QIODevice *out,
+                      qint64 *rows = nullptr, QString *error = nullptr, const ProgressCallback &progress = {});
+
+    static QByteArray toJsonLine(qint64 id, const MatchRecord &record);
+    // A complete columnar file from rows already in memory (archive chunks)
+    static bool writeColumnar(const QVector<QPair<qint64, MatchRecord>> &rows, QIODevice *out);
+    static bool readColumnar(QIODevice *in, const MatchStore::Visitor &visit, QString *error = nullptr);
+};
+
+#endif // MATCHEXPORT_H
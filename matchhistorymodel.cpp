@@ -0,0 +1,109 @@
+#include "matchhistorymodel.h"
+#include <QDateTime>
+#include <QDebug>
+
+namespace {
+
+// Local time, as the history screen always showed it. Rows whose stored
+// text didn't parse have no time (0) and show the text as it was saved.
+QString playedAtText(const MatchSummary &row) {
+    if (row.playedAt == 0 && !row.timestamp.isEmpty()) return row.timestamp;
+    return QDateTime::fromMSecsSinceEpoch(row.playedAt).toString(Qt::ISODate);
+}
+
+} // namespace
+
+MatchHistoryModel::MatchHistoryModel(Layout layout, QObject *parent)
+    : QAbstractTableModel(parent), layout(layout) {}
+
+void MatchHistoryModel::setSource(MatchStore *source, const QString &user, const HistoryFilter &newFilter) {
+    beginResetModel();
+    store = source;
+    username = user;
+    filter = newFilter;
+    rows.clear();
+    exhausted = (store == nullptr);
+    endResetModel();
+
+    fetchMore(QModelIndex()); // First page only
+}
+
+qint64 MatchHistoryModel::matchId(int row) const {
+    return (row >= 0 && row < rows.size()) ? rows[row].id : -1;
+}
+
+int MatchHistoryModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int MatchHistoryModel::columnCount(const QModelIndex &parent) const {
+    if (parent.isValid()) return 0;
+    return layout == Layout::History ? 5 : 6;
+}
+
+QVariant MatchHistoryModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= rows.size()) return QVariant();
+    if (role == Qt::TextAlignmentRole) return int(Qt::AlignCenter);
+    if (role != Qt::DisplayRole) return QVariant();
+
+    const MatchSummary &row = rows[index.row()];
+    if (layout == Layout::Recorded) {
+        switch (index.column()) {
+        case 0: return row.id;
+        case 1: return row.player1;
+        case 2: return row.player2;
+        case 3: return row.winner;
+        case 4: return row.result;
+        case 5: return playedAtText(row);
+        default: return QVariant();
+        }
+    }
+
+    switch (index.column()) {
+    case 0: return playedAtText(row);
+    case 1: return row.player1;
+    case 2: return row.player2;
+    case 3: return row.winner;
+    case 4: {
+        // Format display to show series information
+        QString seriesInfo = QString("Game %1/%2 (Series: %3)")
+                                 .arg(row.gameNumber)
+                                 .arg(row.seriesTotal)
+                                 .arg(row.seriesId.right(8)); // last 8 chars of series_id
+        return row.result + " (" + seriesInfo + ")";
+    }
+    default: return QVariant();
+    }
+}
+
+QVariant MatchHistoryModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    static const QStringList historyHeaders = {"Date", "Player 1", "Player 2", "Winner", "Result"};
+    static const QStringList recordedHeaders = {"Match ID", "Player 1", "Player 2", "Winner", "Result", "Date"};
+    const QStringList &headers = (layout == Layout::History) ? historyHeaders : recordedHeaders;
+    return section < headers.size() ? headers[section] : QVariant();
+}
+
+bool MatchHistoryModel::canFetchMore(const QModelIndex &parent) const {
+    return !parent.isValid() && !exhausted;
+}
+
+void MatchHistoryModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid() || exhausted) return;
+
+    QVector<MatchSummary> page;
+    QString error;
+    if (!store->historyPage(username, filter, rows.isEmpty() ? nullptr : &rows.last(), PageSize, &page, &error)) {
+        qWarning() << "MatchHistoryModel: failed to load history:" << error;
+        exhausted = true;
+        return;
+    }
+    if (page.size() < PageSize) exhausted = true;
+    if (page.isEmpty()) return;
+
+    beginInsertRows(QModelIndex(), rows.size(), rows.size() + page.size() - 1);
+    rows += page;
+    endInsertRows();
+}
@@ -0,0 +1,47 @@
+#ifndef MATCHHISTORYMODEL_H
+#define MATCHHISTORYMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include "matchstore.h"
+
+// Read-only model over a user's matches, newest first.
+// Rows are fetched from the MatchStore a page at a time, each page resuming
+// after the last row of the previous one (keyset pagination), so opening
+// history costs PageSize rows no matter how many games the user has played;
+// the view pulls further pages through fetchMore() as it scrolls. An
+// optional filter (search terms, facets, dates) applies to every page.
+// Display strings, dates included, are only built in data(), i.e. for
+// visible cells.
+class MatchHistoryModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    enum class Layout {
+        History,  // Date, Player 1, Player 2, Winner, Result (+ series info)
+        Recorded  // Match ID, Player 1, Player 2, Winner, Result, Date
+    };
+
+    static constexpr int PageSize = 100;
+
+    explicit MatchHistoryModel(Layout layout, QObject *parent = nullptr);
+
+    void setSource(MatchStore *source, const QString &user, const HistoryFilter &filter = HistoryFilter());
+    qint64 matchId(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    Layout layout;
+    MatchStore *store = nullptr;
+    QString username;
+    HistoryFilter filter;
+    QVector<MatchSummary> rows;
+    bool exhausted = true;
+};
+
+#endif // MATCHHISTORYMODEL_H
@@ -0,0 +1,314 @@
+#include "matchimport.h"
+#include "dbwriter.h"
+#include "matchexport.h"
+#include "tictactoe.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlError>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace {
+
+int intField(const QJsonObject &object, const char *key) {
+    const QJsonValue value = object.value(QLatin1String(key));
+    return value.isString() ? value.toString().toInt() : value.toInt(); // CSV fields are text
+}
+
+// Export and journal keys -> record; returns why not on failure
+QString recordFromObject(const QJsonObject &object, MatchRecord *record) {
+    record->player1 = object.value("player1").toString();
+    record->player2 = object.value("player2").toString();
+    record->winner = object.value("winner").toString();
+    record->result = object.value("result").toString();
+    record->timestamp = object.value("timestamp").toString();
+    record->startingPlayer = object.value("starting_player").toString();
+    record->gameMode = object.value("game_mode").toString();
+    record->difficulty = intField(object, "difficulty");
+    record->seriesId = object.value("series_id").toString();
+    record->gameNumber = intField(object, "game_number");
+    record->seriesTotal = intField(object, "series_total");
+    record->seriesTarget = intField(object, "series_target");
+    if (record->player1.isEmpty() || record->player2.isEmpty()) return "missing player";
+    if (record->timestamp.isEmpty()) return "missing timestamp";
+    record->playedAt = playedAtFromText(record->timestamp);
+    if (record->playedAt == 0) return "bad timestamp '" + record->timestamp + "'";
+
+    if (object.contains("moves_blob")) {
+        record->moves = QByteArray::fromBase64(object.value("moves_blob").toString().toLatin1());
+        return QString();
+    }
+    std::vector<int> moves;
+    for (const QString &token : object.value("moves").toString().split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int cell = token.trimmed().toInt(&ok);
+        if (!ok || cell < 0 || cell >= 9) return "bad move '" + token + "'";
+        moves.push_back(cell);
+    }
+    record->moves = encodeMoves(moves);
+    return QString();
+}
+
+// One CSV line; quoted fields may hold commas and doubled quotes
+QStringList splitCsvLine(const QString &line) {
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar c = line.at(i);
+        if (quoted) {
+            if (c != '"') {
+                field += c;
+            } else if (i + 1 < line.size() && line.at(i + 1) == '"') {
+                field += c;
+                ++i;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields << field;
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields << field;
+    return fields;
+}
+
+QString chompLine(const QByteArray &line) {
+    QString text = QString::fromUtf8(line);
+    while (text.endsWith('\n') || text.endsWith('\r')) text.chop(1);
+    return text;
+}
+
+} // namespace
+
+MatchImport::MatchImport(const QSqlDatabase &db, const QString &path) : db(db), path(path) {}
+
+bool MatchImport::formatForPath(const QString &path, Format *format) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "jsonl") *format = Format::Jsonl;
+    else if (suffix == "csv") *format = Format::Csv;
+    else if (suffix == "tttc") *format = Format::Columnar;
+    else return false;
+    return true;
+}
+
+bool MatchImport::loadCheckpoint(qint64 *position) {
+    QSqlQuery query(db);
+    query.prepare("SELECT position, imported, rejected FROM import_checkpoints WHERE source = :source");
+    query.bindValue(":source", source);
+    if (!query.exec()) {
+        failure = query.lastError().text();
+        return false;
+    }
+    *position = 0;
+    if (query.next()) {
+        *position = query.value(0).toLongLong();
+        state.imported = query.value(1).toLongLong();
+        state.rejected = query.value(2).toLongLong();
+    }
+    return true;
+}
+
+bool MatchImport::run(QString *error) {
+    timer.start();
+    state = Progress();
+    reasons.clear();
+    failure.clear();
+    hasPending = false;
+
+    QFile file(path);
+    if (!formatForPath(path, &format)) {
+        failure = "unknown archive type (expected .jsonl, .csv or .tttc)";
+    } else if (!file.open(QIODevice::ReadOnly)) {
+        failure = file.errorString();
+    }
+    source = QFileInfo(path).canonicalFilePath();
+    state.size = file.size();
+
+    qint64 position = 0;
+    bool ok = failure.isEmpty() && loadCheckpoint(&position);
+    if (ok && format != Format::Columnar && position > state.size) {
+        position = 0; // The file was replaced by a shorter one: start over
+        state.imported = 0;
+        state.rejected = 0;
+    }
+    state.position = position;
+
+    if (ok) {
+        seriesInsert = QSqlQuery(db);
+        bodyInsert = QSqlQuery(db);
+        matchInsert = QSqlQuery(db);
+        checkpointUpdate = QSqlQuery(db);
+        auto prepare = [this](QSqlQuery &query, const QString &sql) {
+            if (query.prepare(sql)) return true;
+            failure = query.lastError().text();
+            return false;
+        };
+        ok = prepare(seriesInsert, DbWriter::SERIES_INSERT_QUERY)
+             && prepare(bodyInsert, DbWriter::BODY_INSERT_QUERY)
+             && prepare(matchInsert, DbWriter::MATCH_INSERT_QUERY)
+             && prepare(checkpointUpdate, "INSERT OR REPLACE INTO import_checkpoints "
+                                          "(source, position, imported, rejected, finished) "
+                                          "VALUES (:source, :position, :imported, :rejected, 0)");
+    }
+
+    QVector<Item> items;
+    items.reserve(batchRows);
+    qint64 end = position;
+    if (ok && format == Format::Columnar) {
+        qint64 index = 0;
+        QString readError;
+        const bool read = MatchExport::readColumnar(&file, [&](qint64, const MatchRecord &record) {
+            if (!ok || index++ < position) return; // Done by an earlier run
+            items.append({QByteArray(), record});
+            end = index;
+            if (items.size() >= batchRows) {
+                ok = submit(std::move(items), end);
+                items = QVector<Item>();
+                items.reserve(batchRows);
+            }
+        }, &readError);
+        if (ok && !items.isEmpty()) ok = submit(std::move(items), end);
+        if (ok && !read) {
+            commitPending(); // Keeps the complete row groups read before the damage
+            failure = readError;
+            ok = false;
+        }
+    } else if (ok) {
+        if (format == Format::Csv) {
+            csvColumns = splitCsvLine(chompLine(file.readLine()));
+            position = qMax(position, file.pos());
+        }
+        ok = file.seek(position);
+        if (!ok) failure = file.errorString();
+        while (ok && !file.atEnd()) {
+            const QByteArray line = file.readLine();
+            end = file.pos();
+            if (line.trimmed().isEmpty()) continue;
+            items.append({line, MatchRecord()});
+            if (items.size() >= batchRows) {
+                ok = submit(std::move(items), end);
+                items = QVector<Item>();
+                items.reserve(batchRows);
+            }
+        }
+        if (ok && end > state.position) ok = submit(std::move(items), end); // Also moves past trailing blank lines
+    }
+
+    if (ok) {
+        ok = commitPending();
+    } else if (hasPending) {
+        pending.waitForFinished(); // Already failing; the checkpoint keeps the last good batch
+        hasPending = false;
+    }
+    if (ok) {
+        QSqlQuery finish(db);
+        finish.prepare("UPDATE import_checkpoints SET finished = 1 WHERE source = :source");
+        finish.bindValue(":source", source);
+        finish.exec();
+    }
+    state.elapsedMs = timer.elapsed();
+
+    if (!ok && error) *error = failure;
+    return ok;
+}
+
+// Starts checking `items` on the pool, then commits the previous batch
+bool MatchImport::submit(QVector<Item> items, qint64 endPosition) {
+    const Format itemFormat = format;
+    const QStringList columns = csvColumns;
+    QFuture<Checked> checks = QtConcurrent::mapped(std::move(items), [itemFormat, columns](const Item &item) -> Checked {
+        Checked checked;
+        if (itemFormat == Format::Columnar) {
+            checked.record = item.record;
+        } else {
+            QJsonObject object;
+            if (itemFormat == Format::Jsonl) {
+                QJsonParseError parseError;
+                const QJsonDocument document = QJsonDocument::fromJson(item.line, &parseError);
+                if (!document.isObject()) {
+                    checked.reason = "not a JSON object (" + parseError.errorString() + ")";
+                    return checked;
+                }
+                object = document.object();
+            } else {
+                const QStringList fields = splitCsvLine(chompLine(item.line));
+                if (fields.size() != columns.size()) {
+                    checked.reason = QString("%1 fields where the header has %2").arg(fields.size()).arg(columns.size());
+                    return checked;
+                }
+                for (int i = 0; i < fields.size(); ++i) object.insert(columns[i], fields[i]);
+            }
+            checked.reason = recordFromObject(object, &checked.record);
+        }
+        if (checked.reason.isEmpty()) checked.reason = TicTacToe::checkRecordedGame(checked.record);
+        return checked;
+    });
+
+    const bool ok = commitPending();
+    pending = checks;
+    pendingEnd = endPosition;
+    hasPending = true;
+    return ok;
+}
+
+// One transaction: the valid games of the batch plus the checkpoint past it
+bool MatchImport::commitPending() {
+    if (!hasPending) return true;
+    hasPending = false;
+    pending.waitForFinished();
+
+    if (!db.transaction()) {
+        failure = db.lastError().text();
+        return false;
+    }
+    qint64 imported = 0;
+    qint64 rejected = 0;
+    QString error;
+    bool ok = true;
+    const int count = pending.resultCount();
+    for (int i = 0; i < count && ok; ++i) {
+        const Checked checked = pending.resultAt(i);
+        if (!checked.reason.isEmpty()) {
+            if (reasons.size() < MaxRejectionReasons) {
+                reasons << QString("game %1: %2").arg(state.imported + state.rejected + i + 1).arg(checked.reason);
+            }
+            ++rejected;
+            continue;
+        }
+        ok = DbWriter::insertRecord(seriesInsert, bodyInsert, matchInsert, checked.record, &error);
+        if (ok) ++imported;
+    }
+
+    if (ok) {
+        checkpointUpdate.bindValue(":source", source);
+        checkpointUpdate.bindValue(":position", pendingEnd);
+        checkpointUpdate.bindValue(":imported", state.imported + imported);
+        checkpointUpdate.bindValue(":rejected", state.rejected + rejected);
+        ok = checkpointUpdate.exec();
+        if (!ok) error = checkpointUpdate.lastError().text();
+    }
+    if (ok && !db.commit()) {
+        error = db.lastError().text();
+        ok = false;
+    }
+    if (!ok) {
+        db.rollback();
+        failure = error;
+        return false;
+    }
+
+    state.imported += imported;
+    state.rejected += rejected;
+    state.importedThisRun += imported;
+    state.position = pendingEnd;
+    state.elapsedMs = timer.elapsed();
+    if (onProgress) onProgress(state);
+    return true;
+}
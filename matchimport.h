@@ -0,0 +1,95 @@
+#ifndef MATCHIMPORT_H
+#define MATCHIMPORT_H
+
+#include <QFuture>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <functional>
+#include "matchrecord.h"
+
+// Bulk import of game archives into matches.
+//
+// Inputs, by suffix:
+//   .jsonl  one object per line with MatchExport's keys ("moves" as
+//           "0,4,8", or the journal's base64 "moves_blob")
+//   .csv    a header line naming the same keys, then one game per line
+//   .tttc   MatchExport's columnar format
+//
+// The file is read in batches of batchRows games. Each batch is parsed and
+// checked against the game rules (TicTacToe::checkRecordedGame) on the
+// global thread pool while the previous batch is inserted, so reading,
+// validation and SQLite work overlap. A batch is one transaction with
+// statements prepared once per import. It also records how far into the
+// file it got in import_checkpoints, so an interrupted import resumes
+// after the last committed batch, and importing a finished file again adds
+// nothing. Games that fail the check are counted and skipped; the first
+// few reasons are kept for the report.
+class MatchImport {
+public:
+    enum class Format { Jsonl, Csv, Columnar };
+
+    struct Progress {
+        qint64 imported = 0;  // Including earlier runs of a resumed import
+        qint64 rejected = 0;
+        qint64 position = 0;  // Bytes (text) or games (columnar) done
+        qint64 size = 0;      // File size in bytes
+        qint64 elapsedMs = 0; // This run
+        qint64 importedThisRun = 0;
+    };
+    using ProgressCallback = std::function<void(const Progress &)>;
+
+    static constexpr int DefaultBatchRows = 20000;
+    static constexpr int MaxRejectionReasons = 20;
+
+    MatchImport(const QSqlDatabase &db, const QString &path);
+
+    static bool formatForPath(const QString &path, Format *format);
+
+    void setBatchRows(int rows) { batchRows = qMax(1, rows); }
+    void setProgressCallback(ProgressCallback callback) { onProgress = std::move(callback); }
+
+    bool run(QString *error = nullptr);
+    const Progress &progress() const { return state; }
+    const QStringList &rejections() const { return reasons; }
+
+private:
+    struct Item {
+        QByteArray line;    // Text formats: parsed on the pool
+        MatchRecord record; // Columnar: already decoded
+    };
+    struct Checked {
+        MatchRecord record;
+        QString reason; // Empty if the game is imported
+    };
+
+    bool submit(QVector<Item> items, qint64 endPosition);
+    bool commitPending();
+    bool loadCheckpoint(qint64 *position);
+
+    QSqlDatabase db;
+    QString path;
+    QString source; // Canonical path, the checkpoint key
+    Format format = Format::Jsonl;
+    QStringList csvColumns;
+    int batchRows = DefaultBatchRows;
+    ProgressCallback onProgress;
+
+    QSqlQuery seriesInsert;
+    QSqlQuery bodyInsert;
+    QSqlQuery matchInsert;
+    QSqlQuery checkpointUpdate;
+
+    QFuture<Checked> pending; // Batch being validated
+    qint64 pendingEnd = 0;
+    bool hasPending = false;
+
+    Progress state;
+    QStringList reasons;
+    QString failure;
+    QElapsedTimer timer;
+};
+
+#endif // MATCHIMPORT_H
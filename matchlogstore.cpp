@@ -0,0 +1,493 @@
+#include "matchlogstore.h"
+#include <QDebug>
+#include <QDir>
+#include <QHash>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+constexpr quint8 RecordVersion = 1;
+constexpr quint8 FlagDeleted = 0x01;
+constexpr int EntrySize = 8; // One i64 ordinal per index entry
+
+// Slot of a length-prefixed field: offset and size, length byte included
+struct Field {
+    int offset;
+    int size;
+};
+constexpr Field GameModeField{20, 8};
+constexpr Field MovesField{28, 16};
+constexpr Field Player1Field{44, 40};
+constexpr Field Player2Field{84, 40};
+constexpr Field WinnerField{124, 40};
+constexpr Field ResultField{164, 40};
+constexpr Field TimestampField{204, 24};
+constexpr Field SeriesIdField{228, 28};
+static_assert(SeriesIdField.offset + SeriesIdField.size == MatchLogStore::RecordSize, "record layout");
+static_assert(Player1Field.size - 1 == MatchLogStore::MaxNameBytes && Player2Field.size == Player1Field.size
+              && WinnerField.size == Player1Field.size, "name slots");
+
+bool putBytes(uchar *record, Field field, const QByteArray &bytes, const char *name, QString *error) {
+    if (bytes.size() >= field.size) {
+        if (error) {
+            *error = QString("%1 is too long for the match log (%2 bytes, at most %3)")
+                         .arg(name).arg(bytes.size()).arg(field.size - 1);
+        }
+        return false;
+    }
+    record[field.offset] = static_cast<uchar>(bytes.size());
+    std::memcpy(record + field.offset + 1, bytes.constData(), bytes.size());
+    return true;
+}
+
+bool putNumber(uchar *record, int offset, int value, const char *name, QString *error) {
+    if (value < 0 || value > 0xFFFF) {
+        if (error) *error = QString("%1 is out of range for the match log: %2").arg(name).arg(value);
+        return false;
+    }
+    qToLittleEndian<quint16>(static_cast<quint16>(value), record + offset);
+    return true;
+}
+
+QByteArray getBytes(const uchar *record, Field field) {
+    const int size = qMin<int>(record[field.offset], field.size - 1);
+    return QByteArray(reinterpret_cast<const char *>(record + field.offset + 1), size);
+}
+
+QString getText(const uchar *record, Field field) {
+    return QString::fromUtf8(getBytes(record, field));
+}
+
+quint16 checksumOf(const uchar *record) {
+    return qChecksum(QByteArrayView(reinterpret_cast<const char *>(record + 4), MatchLogStore::RecordSize - 4));
+}
+
+bool isValid(const uchar *record) {
+    return record[3] == RecordVersion && qFromLittleEndian<quint16>(record) == checksumOf(record);
+}
+
+bool isDeleted(const uchar *record) {
+    return record[2] & FlagDeleted;
+}
+
+qint64 idOf(const uchar *record) {
+    return qFromLittleEndian<qint64>(record + 4);
+}
+
+bool encodeRecord(const MatchRecord &match, qint64 id, uchar *record, QString *error) {
+    std::memset(record, 0, MatchLogStore::RecordSize);
+    record[3] = RecordVersion;
+    qToLittleEndian<qint64>(id, record + 4);
+    record[12] = match.startingPlayer.isEmpty() ? 0 : static_cast<uchar>(match.startingPlayer.at(0).toLatin1());
+    record[13] = static_cast<uchar>(qBound(0, match.difficulty, 255));
+    if (!putNumber(record, 14, match.gameNumber, "Game number", error)
+        || !putNumber(record, 16, match.seriesTotal, "Series length", error)
+        || !putNumber(record, 18, match.seriesTarget, "Series target", error)
+        || !putBytes(record, GameModeField, match.gameMode.toUtf8(), "Game mode", error)
+        || !putBytes(record, MovesField, match.moves, "Move list", error)
+        || !putBytes(record, Player1Field, match.player1.toUtf8(), "Player 1 name", error)
+        || !putBytes(record, Player2Field, match.player2.toUtf8(), "Player 2 name", error)
+        || !putBytes(record, WinnerField, match.winner.toUtf8(), "Winner", error)
+        || !putBytes(record, ResultField, match.result.toUtf8(), "Result", error)
+        || !putBytes(record, TimestampField, match.timestamp.toUtf8(), "Timestamp", error)
+        || !putBytes(record, SeriesIdField, match.seriesId.toUtf8(), "Series id", error)) {
+        return false;
+    }
+    qToLittleEndian<quint16>(checksumOf(record), record);
+    return true;
+}
+
+MatchRecord decodeRecord(const uchar *record) {
+    MatchRecord match;
+    if (record[12] != 0) match.startingPlayer = QString(QChar::fromLatin1(static_cast<char>(record[12])));
+    match.difficulty = record[13];
+    match.gameNumber = qFromLittleEndian<quint16>(record + 14);
+    match.seriesTotal = qFromLittleEndian<quint16>(record + 16);
+    match.seriesTarget = qFromLittleEndian<quint16>(record + 18);
+    match.gameMode = getText(record, GameModeField);
+    match.moves = getBytes(record, MovesField);
+    match.player1 = getText(record, Player1Field);
+    match.player2 = getText(record, Player2Field);
+    match.winner = getText(record, WinnerField);
+    match.result = getText(record, ResultField);
+    match.timestamp = getText(record, TimestampField);
+    match.seriesId = getText(record, SeriesIdField);
+    return match;
+}
+
+MatchSummary summaryOf(const uchar *record) {
+    MatchSummary row;
+    row.id = idOf(record);
+    row.player1 = getText(record, Player1Field);
+    row.player2 = getText(record, Player2Field);
+    row.winner = getText(record, WinnerField);
+    row.result = getText(record, ResultField);
+    row.timestamp = getText(record, TimestampField);
+    row.playedAt = playedAtFromText(row.timestamp);
+    row.seriesId = getText(record, SeriesIdField);
+    row.gameNumber = qFromLittleEndian<quint16>(record + 14);
+    row.seriesTotal = qFromLittleEndian<quint16>(record + 16);
+    return row;
+}
+
+// The players a record is listed under (a PvP game against oneself once)
+QStringList playersOf(const uchar *record) {
+    QStringList players;
+    const QString player1 = getText(record, Player1Field);
+    const QString player2 = getText(record, Player2Field);
+    if (!player1.isEmpty()) players << player1;
+    if (!player2.isEmpty() && player2 != player1) players << player2;
+    return players;
+}
+
+QByteArray entryBytes(qint64 ordinal) {
+    QByteArray bytes(EntrySize, Qt::Uninitialized);
+    qToLittleEndian<qint64>(ordinal, bytes.data());
+    return bytes;
+}
+
+} // namespace
+
+MatchLogStore::MatchLogStore(const QString &path) : path(path), indexDir(path + ".idx") {}
+
+MatchLogStore::~MatchLogStore() {
+    unmap();
+    file.close();
+}
+
+bool MatchLogStore::open(QString *error) {
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    bool truncated = false;
+    if (!repairTail(&truncated, error)) return false;
+    count = file.size() / RecordSize;
+    if (!remap()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    nextId = count > 0 ? idAt(count - 1) + 1 : 1;
+
+    QFile meta(indexDir + "/meta");
+    const bool metaValid = meta.open(QIODevice::ReadOnly) && meta.size() == 2 * EntrySize;
+    if (metaValid) {
+        const QByteArray fields = meta.readAll();
+        tombstones = qFromLittleEndian<qint64>(fields.constData());
+        // Ids of matches deleted from the end of the log are never reused
+        nextId = qMax(nextId, qFromLittleEndian<qint64>(fields.constData() + EntrySize));
+    }
+    meta.close();
+
+    // Without fsync the indexes may have outlived a torn log tail: rebuild
+    if (truncated || !metaValid) {
+        if (!rebuildIndexes(error)) return false;
+    } else {
+        // Indexes are written after the log, so a crash can only have lost
+        // the last record's entries
+        const uchar *last = count > 0 ? recordAt(count - 1) : nullptr;
+        if (last && !isDeleted(last)) {
+            for (const QString &player : playersOf(last)) {
+                QFile index(indexPath(player));
+                qint64 lastEntry = -1;
+                if (index.open(QIODevice::ReadWrite)) {
+                    index.resize(index.size() - index.size() % EntrySize); // Torn entry
+                    if (index.size() >= EntrySize && index.seek(index.size() - EntrySize)) {
+                        lastEntry = qFromLittleEndian<qint64>(index.read(EntrySize).constData());
+                    }
+                    index.close();
+                }
+                if (lastEntry < count - 1 && !appendIndex(player, count - 1, error)) return false;
+            }
+        }
+    }
+
+    if (tombstones * 4 > count) return compact(error);
+    return true;
+}
+
+// Drops a partial or corrupt tail left by a torn write
+bool MatchLogStore::repairTail(bool *truncated, QString *error) {
+    qint64 size = file.size() - file.size() % RecordSize;
+    QByteArray record;
+    while (size > 0) {
+        if (!file.seek(size - RecordSize)) break;
+        record = file.read(RecordSize);
+        if (record.size() == RecordSize && isValid(reinterpret_cast<const uchar *>(record.constData()))) break;
+        qWarning() << "MatchLogStore: dropping corrupt record at" << size - RecordSize;
+        size -= RecordSize;
+    }
+    *truncated = size != file.size();
+    if (*truncated && !file.resize(size)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool MatchLogStore::remap() {
+    unmap();
+    if (count == 0) return true;
+    file.flush();
+    mapped = file.map(0, count * RecordSize);
+    if (!mapped) return false;
+    mappedRecords = count;
+    return true;
+}
+
+void MatchLogStore::unmap() {
+    if (mapped) file.unmap(mapped);
+    mapped = nullptr;
+    mappedRecords = 0;
+}
+
+// Appends since the last mapping are picked up by remapping the whole file
+const uchar *MatchLogStore::recordAt(qint64 ordinal) {
+    if (ordinal < 0 || ordinal >= count) return nullptr;
+    if (ordinal >= mappedRecords && !remap()) return nullptr;
+    return mapped + ordinal * RecordSize;
+}
+
+qint64 MatchLogStore::idAt(qint64 ordinal) {
+    const uchar *record = recordAt(ordinal);
+    return record ? idOf(record) : -1;
+}
+
+// Ids only grow and compaction keeps the order, so the log is sorted by id
+qint64 MatchLogStore::lowerBound(qint64 id) {
+    qint64 low = 0, high = count;
+    while (low < high) {
+        const qint64 mid = low + (high - low) / 2;
+        if (idAt(mid) < id) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+QString MatchLogStore::indexPath(const QString &user) const {
+    return indexDir + "/" + QString::fromLatin1(user.toUtf8().toHex()); // Safe file name for any player name
+}
+
+bool MatchLogStore::appendIndex(const QString &user, qint64 ordinal, QString *error) {
+    QFile index(indexPath(user));
+    if (!index.open(QIODevice::WriteOnly | QIODevice::Append) || index.write(entryBytes(ordinal)) != EntrySize) {
+        if (error) *error = index.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool MatchLogStore::writeMeta(QString *error) {
+    QSaveFile meta(indexDir + "/meta");
+    const QByteArray fields = entryBytes(tombstones) + entryBytes(nextId);
+    if (!meta.open(QIODevice::WriteOnly) || meta.write(fields) != fields.size() || !meta.commit()) {
+        if (error) *error = meta.errorString();
+        return false;
+    }
+    return true;
+}
+
+// One pass over the log; corrupt records are left out like tombstones
+bool MatchLogStore::rebuildIndexes(QString *error) {
+    QDir(indexDir).removeRecursively();
+    if (!QDir().mkpath(indexDir)) {
+        if (error) *error = "Cannot create " + indexDir;
+        return false;
+    }
+
+    QHash<QString, QByteArray> entries;
+    tombstones = 0;
+    for (qint64 ordinal = 0; ordinal < count; ++ordinal) {
+        const uchar *record = recordAt(ordinal);
+        if (!record) {
+            if (error) *error = file.errorString();
+            return false;
+        }
+        if (isDeleted(record) || !isValid(record)) {
+            ++tombstones;
+            continue;
+        }
+        for (const QString &player : playersOf(record)) entries[player] += entryBytes(ordinal);
+    }
+
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        QFile index(indexPath(it.key()));
+        if (!index.open(QIODevice::WriteOnly) || index.write(it.value()) != it.value().size()) {
+            if (error) *error = index.errorString();
+            return false;
+        }
+    }
+    return writeMeta(error);
+}
+
+bool MatchLogStore::append(const MatchRecord &record, QString *error) {
+    QByteArray buffer(RecordSize, Qt::Uninitialized);
+    uchar *bytes = reinterpret_cast<uchar *>(buffer.data());
+    if (!encodeRecord(record, nextId, bytes, error)) return false;
+
+    const qint64 ordinal = count;
+    if (!file.seek(ordinal * RecordSize) || file.write(buffer) != RecordSize || !file.flush()) {
+        if (error) *error = file.errorString();
+        file.resize(ordinal * RecordSize);
+        return false;
+    }
+    ++count;
+    ++nextId;
+
+    for (const QString &player : playersOf(bytes)) {
+        if (!appendIndex(player, ordinal, error)) return false;
+    }
+    return true;
+}
+
+bool MatchLogStore::historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                                QVector<MatchSummary> *page, QString *error) {
+    page->clear();
+    QFile index(indexPath(user));
+    if (!index.exists()) return true; // No games yet
+    const qint64 entries = index.size() / EntrySize;
+    if (entries == 0) return true;
+    const uchar *ordinals = index.open(QIODevice::ReadOnly) ? index.map(0, entries * EntrySize) : nullptr;
+    if (!ordinals) {
+        if (error) *error = index.errorString();
+        return false;
+    }
+    auto ordinalAt = [ordinals](qint64 i) { return qFromLittleEndian<qint64>(ordinals + i * EntrySize); };
+
+    // Entries are in log order, hence in id order: resume just below the cursor
+    qint64 end = entries;
+    if (after) {
+        qint64 low = 0;
+        while (low < end) {
+            const qint64 mid = low + (end - low) / 2;
+            if (idAt(ordinalAt(mid)) < after->id) low = mid + 1;
+            else end = mid;
+        }
+    }
+
+    for (qint64 i = end - 1; i >= 0 && page->size() < limit; --i) {
+        const uchar *record = recordAt(ordinalAt(i));
+        if (!record || !isValid(record)) {
+            if (error) *error = "Match log index is out of date: " + index.fileName();
+            return false;
+        }
+        if (isDeleted(record)) continue;
+        // No time or facet indexes here: the filter walks the list
+        const MatchSummary row = summaryOf(record);
+        if (!filter.range.contains(row.playedAt)) continue;
+        if (!filter.hasFacets() || filter.matches(user, decodeRecord(record))) page->append(row);
+    }
+    return true;
+}
+
+bool MatchLogStore::loadMatch(qint64 id, MatchRecord *record, QString *error) {
+    const qint64 ordinal = lowerBound(id);
+    const uchar *bytes = recordAt(ordinal);
+    if (!bytes || idOf(bytes) != id || isDeleted(bytes)) {
+        if (error) *error = QString("Match %1 not found").arg(id);
+        return false;
+    }
+    if (!isValid(bytes)) {
+        if (error) *error = QString("Match %1 is corrupt").arg(id);
+        return false;
+    }
+    *record = decodeRecord(bytes);
+    return true;
+}
+
+// Tombstones the user's records; their opponents' indexes keep pointing at
+// them until the next compaction and skip them meanwhile.
+bool MatchLogStore::removeUserMatches(const QString &user, QString *error) {
+    QFile index(indexPath(user));
+    if (!index.exists()) return true;
+    if (!index.open(QIODevice::ReadOnly)) {
+        if (error) *error = index.errorString();
+        return false;
+    }
+    const QByteArray entries = index.readAll();
+    index.close();
+
+    for (qint64 i = 0; i + EntrySize <= entries.size(); i += EntrySize) {
+        const qint64 ordinal = qFromLittleEndian<qint64>(entries.constData() + i);
+        const uchar *record = recordAt(ordinal);
+        if (!record || isDeleted(record)) continue;
+        const char flags = static_cast<char>(record[2] | FlagDeleted); // Outside the checksum
+        if (!file.seek(ordinal * RecordSize + 2) || file.write(&flags, 1) != 1) {
+            if (error) *error = file.errorString();
+            return false;
+        }
+        ++tombstones;
+    }
+    if (!file.flush()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    QFile::remove(index.fileName());
+    if (!writeMeta(error)) return false;
+
+    if (tombstones * 4 > count) return compact(error);
+    return true;
+}
+
+bool MatchLogStore::scan(qint64 afterId, const Visitor &visit, QString *error) {
+    const qint64 total = count;
+    for (qint64 ordinal = lowerBound(afterId + 1); ordinal < total; ++ordinal) {
+        const uchar *record = recordAt(ordinal);
+        if (!record) {
+            if (error) *error = file.errorString();
+            return false;
+        }
+        if (isDeleted(record) || !isValid(record)) continue;
+        visit(idOf(record), decodeRecord(record));
+    }
+    return true;
+}
+
+// Rewrites the log without tombstones (ids are kept) and rebuilds the
+// indexes. The index directory is removed before the new log replaces the
+// old one, so a crash in between leaves open() to rebuild it.
+bool MatchLogStore::compact(QString *error) {
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        if (error) *error = out.errorString();
+        return false;
+    }
+    for (qint64 ordinal = 0; ordinal < count; ++ordinal) {
+        const uchar *record = recordAt(ordinal);
+        if (!record) {
+            if (error) *error = file.errorString();
+            return false;
+        }
+        if (isDeleted(record) || !isValid(record)) continue;
+        if (out.write(reinterpret_cast<const char *>(record), RecordSize) != RecordSize) {
+            if (error) *error = out.errorString();
+            return false;
+        }
+    }
+
+    unmap();
+    file.close();
+    QDir(indexDir).removeRecursively();
+    const bool committed = out.commit();
+    if (!committed && error) *error = out.errorString();
+
+    // Either way the indexes are rebuilt from whichever log is now in place
+    if (!file.open(QIODevice::ReadWrite)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    count = file.size() / RecordSize;
+    if (!remap()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    QString rebuildError;
+    if (!rebuildIndexes(&rebuildError)) {
+        if (error) *error = rebuildError;
+        return false;
+    }
+    return committed;
+}
@@ -0,0 +1,79 @@
+#ifndef MATCHLOGSTORE_H
+#define MATCHLOGSTORE_H
+
+#include <QFile>
+#include <QString>
+#include "matchstore.h"
+
+// Append-only match log: fixed-size records in one file, read through a
+// memory mapping, plus one index file per player listing the ordinals of
+// their records. Saving a game is two sequential appends (log, then the
+// players' indexes); a history page reads PageSize index entries from the
+// end of one file; loading a match is a binary search by id over the
+// mapping.
+//
+// Deletion writes a tombstone flag in place. Once more than a quarter of
+// the records are tombstones the log is rewritten without them and the
+// indexes are rebuilt. The indexes are derived data: a missing index
+// directory is rebuilt from the log on open.
+//
+// Record layout (little-endian, RecordSize bytes):
+//   0 u16 checksum of bytes 4..end   2 u8 flags   3 u8 version
+//   4 i64 id   12 u8 starting player   13 u8 difficulty
+//   14 u16 game number   16 u16 series total   18 u16 series target
+//   20.. length-prefixed fields: game mode, moves, player 1, player 2,
+//        winner, result, timestamp, series id
+// Fields that don't fit their slot are rejected by append().
+//
+// Every append reaches the OS before append() returns but isn't fsynced:
+// an application crash loses nothing, a power loss may tear the last
+// records, which the checksums detect (the torn tail is dropped on open).
+// Only one process may have a log open at a time.
+class MatchLogStore : public MatchStore {
+public:
+    static constexpr int RecordSize = 256;
+    static constexpr int MaxNameBytes = 39; // UTF-8; the player and winner slots, enforced at registration
+
+    explicit MatchLogStore(const QString &path); // Indexes live in <path>.idx/
+    ~MatchLogStore() override;
+
+    bool open(QString *error = nullptr);
+
+    QString name() const override { return "log"; }
+    bool append(const MatchRecord &record, QString *error = nullptr) override;
+    using MatchStore::historyPage;
+    bool historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                     QVector<MatchSummary> *page, QString *error = nullptr) override;
+    bool loadMatch(qint64 id, MatchRecord *record, QString *error = nullptr) override;
+    bool removeUserMatches(const QString &user, QString *error = nullptr) override;
+    bool scan(qint64 afterId, const Visitor &visit, QString *error = nullptr) override;
+    qint64 lastMatchId() override { return nextId - 1; }
+
+    bool compact(QString *error = nullptr);
+    qint64 recordCount() const { return count; }
+    qint64 tombstoneCount() const { return tombstones; }
+
+private:
+    const uchar *recordAt(qint64 ordinal);
+    qint64 idAt(qint64 ordinal);
+    qint64 lowerBound(qint64 id); // First ordinal whose id is >= id
+    bool remap();
+    void unmap();
+
+    QString indexPath(const QString &user) const;
+    bool appendIndex(const QString &user, qint64 ordinal, QString *error);
+    bool rebuildIndexes(QString *error);
+    bool repairTail(bool *truncated, QString *error);
+    bool writeMeta(QString *error);
+
+    QString path;
+    QString indexDir;
+    QFile file;
+    uchar *mapped = nullptr;
+    qint64 mappedRecords = 0;
+    qint64 count = 0;
+    qint64 tombstones = 0;
+    qint64 nextId = 1;
+};
+
+#endif // MATCHLOGSTORE_H
@@ -0,0 +1,85 @@
+#ifndef MATCHRECORD_H
+#define MATCHRECORD_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QDateTime>
+#include <QTimeZone>
+#include <vector>
+#include "movecodec.h"
+
+// One row of the matches table, captured on the GUI thread so it can be
+// written later (possibly from another thread) without touching game state.
+struct MatchRecord {
+    QString player1;
+    QString player2;
+    QString winner;
+    QString result;
+    QByteArray moves; // MoveCodec-encoded; stored via game_bodies
+    QString timestamp; // ISO 8601 text for files and journals; see playedAtOf()
+    qint64 playedAt = 0; // Epoch milliseconds UTC, the stored form; 0 if only the text is known
+    QString startingPlayer;
+    QString gameMode;
+    int difficulty = 0; // AI difficulty 1-3; 0 for PvP
+    QString seriesId;
+    int gameNumber = 0;
+    int seriesTotal = 0;
+    int seriesTarget = 0;
+    QString clientId; // Set by DbWriter::enqueue(), stored in matches.client_id; empty elsewhere
+};
+
+// Text without an offset is local time, as saved before played_at existed; 0 if unparseable
+inline qint64 playedAtFromText(const QString &timestamp) {
+    const QDateTime time = QDateTime::fromString(timestamp, Qt::ISODate);
+    return time.isValid() ? time.toMSecsSinceEpoch() : 0;
+}
+
+// Exact round trip with playedAtFromText(): UTC with milliseconds
+inline QString timestampText(qint64 playedAt) {
+    return QDateTime::fromMSecsSinceEpoch(playedAt, QTimeZone::UTC).toString(Qt::ISODateWithMs);
+}
+
+inline qint64 playedAtOf(const MatchRecord &record) {
+    return record.playedAt != 0 ? record.playedAt : playedAtFromText(record.timestamp);
+}
+
+inline QByteArray encodeMoves(const int *moves, int count, int side = MoveCodec::ClassicSide) {
+    QByteArray blob(MoveCodec::maxEncodedSize(count, side), Qt::Uninitialized);
+    int size = MoveCodec::encode(moves, count, side, reinterpret_cast<unsigned char *>(blob.data()), blob.size());
+    blob.truncate(qMax(0, size));
+    return blob;
+}
+
+inline QByteArray encodeMoves(const std::vector<int> &moves, int side = MoveCodec::ClassicSide) {
+    return encodeMoves(moves.data(), static_cast<int>(moves.size()), side);
+}
+
+inline std::vector<int> decodeMoves(const QByteArray &blob) {
+    std::vector<int> moves(qMax(0, (blob.size() - 1) * 2));
+    int count = MoveCodec::decode(reinterpret_cast<const unsigned char *>(blob.constData()), blob.size(),
+                                  moves.data(), static_cast<int>(moves.size()));
+    moves.resize(qMax(0, count));
+    return moves;
+}
+
+// Legacy TEXT format ("0,3,1,4,2") used before moves_blob existed. Text
+// with anything but cells 0-8 gives an empty result and *ok false.
+inline QByteArray encodeMovesText(const QString &text, bool *ok = nullptr) {
+    const QStringList tokens = text.split(',', Qt::SkipEmptyParts);
+    std::vector<int> moves;
+    moves.reserve(tokens.size());
+    for (const QString &token : tokens) {
+        bool valid = false;
+        const int cell = token.trimmed().toInt(&valid);
+        if (!valid || cell < 0 || cell > 8) {
+            if (ok) *ok = false;
+            return QByteArray();
+        }
+        moves.push_back(cell);
+    }
+    if (ok) *ok = true;
+    return encodeMoves(moves);
+}
+
+#endif // MATCHRECORD_H
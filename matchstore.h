@@ -0,0 +1,59 @@
+#ifndef MATCHSTORE_H
+#define MATCHSTORE_H
+
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "historyfilter.h"
+#include "matchrecord.h"
+
+// One row of a user's match history, newest first.
+struct MatchSummary {
+    qint64 id = 0;
+    QString player1;
+    QString player2;
+    QString winner;
+    QString result;
+    qint64 playedAt = 0; // Epoch ms UTC; keyset cursor together with id, formatted only for display
+    QString seriesId;
+    int gameNumber = 0;
+    int seriesTotal = 0;
+    QString timestamp; // As stored; shown when playedAt is unknown (0)
+};
+
+// Where finished games live. The game saves, lists history and loads
+// replays only through this interface; the backend is picked at startup
+// (TICTACTOE_STORAGE, see TicTacToe::openStores()).
+class MatchStore {
+public:
+    virtual ~MatchStore() = default;
+
+    virtual QString name() const = 0;
+    virtual bool append(const MatchRecord &record, QString *error = nullptr) = 0;
+    virtual void flush() {} // Read-your-writes barrier for asynchronous backends
+
+    // Newest first, only rows the filter matches; `after` is the last row
+    // of the previous page (nullptr for the first page)
+    virtual bool historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                             QVector<MatchSummary> *page, QString *error = nullptr) = 0;
+    bool historyPage(const QString &user, const MatchSummary *after, int limit,
+                     QVector<MatchSummary> *page, QString *error = nullptr) {
+        return historyPage(user, HistoryFilter(), after, limit, page, error);
+    }
+    virtual bool loadMatch(qint64 id, MatchRecord *record, QString *error = nullptr) = 0;
+    virtual bool removeUserMatches(const QString &user, QString *error = nullptr) = 0;
+
+    // Visits every match with id > afterId in id order (analytics catch-up)
+    using Visitor = std::function<void(qint64 id, const MatchRecord &record)>;
+    virtual bool scan(qint64 afterId, const Visitor &visit, QString *error = nullptr) = 0;
+    // Every match one player took part in, in id order (exports). Filters a
+    // full scan unless the backend can look the player's games up directly.
+    virtual bool scanUser(const QString &user, const Visitor &visit, QString *error = nullptr) {
+        return scan(0, [&user, &visit](qint64 id, const MatchRecord &record) {
+            if (record.player1 == user || record.player2 == user) visit(id, record);
+        }, error);
+    }
+    virtual qint64 lastMatchId() = 0;
+};
+
+#endif // MATCHSTORE_H
@@ -0,0 +1,56 @@
+#include "memorymatchstore.h"
+#include <algorithm>
+#include <utility>
+
+bool MemoryMatchStore::append(const MatchRecord &record, QString *) {
+    const qint64 id = nextId++;
+    matches.insert(id, record);
+    byPlayer[record.player1].append(id);
+    if (record.player2 != record.player1) byPlayer[record.player2].append(id);
+    return true;
+}
+
+bool MemoryMatchStore::historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                                   QVector<MatchSummary> *page, QString *) {
+    page->clear();
+    const QVector<qint64> ids = byPlayer.value(user);
+    auto end = after ? std::lower_bound(ids.cbegin(), ids.cend(), after->id) : ids.cend();
+    for (auto it = end; it != ids.cbegin() && page->size() < limit;) {
+        --it;
+        auto match = matches.constFind(*it);
+        if (match == matches.constEnd() || !filter.matches(user, *match)) continue;
+        MatchSummary row;
+        row.id = *it;
+        row.player1 = match->player1;
+        row.player2 = match->player2;
+        row.winner = match->winner;
+        row.result = match->result;
+        row.playedAt = playedAtOf(*match);
+        row.seriesId = match->seriesId;
+        row.gameNumber = match->gameNumber;
+        row.seriesTotal = match->seriesTotal;
+        row.timestamp = match->timestamp;
+        page->append(row);
+    }
+    return true;
+}
+
+bool MemoryMatchStore::loadMatch(qint64 id, MatchRecord *record, QString *error) {
+    auto it = matches.constFind(id);
+    if (it == matches.constEnd()) {
+        if (error) *error = QString("Match %1 not found").arg(id);
+        return false;
+    }
+    *record = *it;
+    return true;
+}
+
+bool MemoryMatchStore::removeUserMatches(const QString &user, QString *) {
+    for (qint64 id : byPlayer.take(user)) matches.remove(id);
+    return true;
+}
+
+bool MemoryMatchStore::scan(qint64 afterId, const Visitor &visit, QString *) {
+    for (auto it = std::as_const(matches).upperBound(afterId); it != matches.cend(); ++it) visit(it.key(), it.value());
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef MEMORYMATCHSTORE_H
+#define MEMORYMATCHSTORE_H
+
+#include <QHash>
+#include <QMap>
+#include "matchstore.h"
+
+// Matches in memory, gone when the process exits: an id-ordered map plus
+// each player's match ids in save order. For tests and for benchmarking
+// game flow without any I/O.
+class MemoryMatchStore : public MatchStore {
+public:
+    QString name() const override { return "memory"; }
+    bool append(const MatchRecord &record, QString *error = nullptr) override;
+    using MatchStore::historyPage;
+    bool historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                     QVector<MatchSummary> *page, QString *error = nullptr) override;
+    bool loadMatch(qint64 id, MatchRecord *record, QString *error = nullptr) override;
+    bool removeUserMatches(const QString &user, QString *error = nullptr) override;
+    bool scan(qint64 afterId, const Visitor &visit, QString *error = nullptr) override;
+    qint64 lastMatchId() override { return nextId - 1; }
+
+private:
+    QMap<qint64, MatchRecord> matches;
+    QHash<QString, QVector<qint64>> byPlayer; // Ascending; may list removed ids, skipped on read
+    qint64 nextId = 1;
+};
+
+#endif // MEMORYMATCHSTORE_H
@@ -0,0 +1,49 @@
+#include "memoryuserstore.h"
+
+bool MemoryUserStore::findUser(const QString &username, UserAccount *account, bool *found, QString *) {
+    auto it = users.constFind(username);
+    *found = it != users.constEnd();
+    if (*found) *account = it->account;
+    return true;
+}
+
+bool MemoryUserStore::addUser(const QString &username, const QString &passwordHash, const QString &salt,
+                              qint64 *id, QString *error) {
+    if (users.contains(username)) {
+        if (error) *error = "Username already exists";
+        return false;
+    }
+    User user;
+    user.account = {nextId, username, passwordHash, salt};
+    user.standing.id = nextId;
+    user.standing.username = username;
+    users.insert(username, user);
+    if (id) *id = nextId;
+    ++nextId;
+    return true;
+}
+
+bool MemoryUserStore::removeUser(const QString &username, QString *) {
+    users.remove(username);
+    return true;
+}
+
+bool MemoryUserStore::standings(QVector<UserStanding> *result, QString *) {
+    result->clear();
+    result->reserve(users.size());
+    for (const User &user : users) result->append(user.standing);
+    return true;
+}
+
+void MemoryUserStore::recordGame(const MatchRecord &record) {
+    applyOutcome(record.player1, record.winner);
+    if (record.player2 != record.player1) applyOutcome(record.player2, record.winner);
+}
+
+void MemoryUserStore::applyOutcome(const QString &username, const QString &winner) {
+    auto it = users.find(username);
+    if (it == users.end()) return; // AI and guest names have no account
+    if (winner == username) ++it->standing.wins;
+    else if (winner == "-") ++it->standing.ties;
+    else ++it->standing.losses;
+}
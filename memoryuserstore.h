@@ -0,0 +1,33 @@
+#ifndef MEMORYUSERSTORE_H
+#define MEMORYUSERSTORE_H
+
+#include <QHash>
+#include "userstore.h"
+
+// Accounts in a hash map, gone when the process exits. Counts games the
+// way the user_stats trigger does: winner == name is a win, "-" a tie,
+// anything else a loss. For tests and for benchmarking game flow without
+// any I/O.
+class MemoryUserStore : public UserStore {
+public:
+    QString name() const override { return "memory"; }
+    bool findUser(const QString &username, UserAccount *account, bool *found, QString *error = nullptr) override;
+    bool addUser(const QString &username, const QString &passwordHash, const QString &salt,
+                 qint64 *id, QString *error = nullptr) override;
+    bool removeUser(const QString &username, QString *error = nullptr) override;
+    bool standings(QVector<UserStanding> *users, QString *error = nullptr) override;
+    void recordGame(const MatchRecord &record) override;
+
+private:
+    struct User {
+        UserAccount account;
+        UserStanding standing;
+    };
+
+    void applyOutcome(const QString &username, const QString &winner);
+
+    QHash<QString, User> users;
+    qint64 nextId = 1;
+};
+
+#endif // MEMORYUSERSTORE_H
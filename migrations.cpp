@@ -0,0 +1,716 @@
+#include "tictactoe.h"
+#include "schemamigrator.h"
+
+namespace {
+
+// ISO 8601 text -> epoch ms UTC, NULL if unparseable. Text without an offset
+// was written in local time, which the 'utc' modifier converts from; text
+// with an offset is already absolute and passes through unchanged.
+QString epochMsOf(const QString &column) {
+    return QString("CAST(ROUND((julianday(%1, 'utc') - 2440587.5) * 86400000) AS INTEGER)").arg(column);
+}
+
+// match_players facets of the row being updated, from its game and user
+// (see HistoryFilter). Outcome: 1 win, 0 tie, -1 loss.
+const char *const FacetColumns =
+    "opponent = CASE WHEN m.player1_id IS match_players.user_id THEN m.player2 ELSE m.player1 END, "
+    "outcome = CASE WHEN m.winner = u.username THEN 1 WHEN m.winner = '-' THEN 0 ELSE -1 END, "
+    "game_mode = m.game_mode";
+
+bool hasFullText(QSqlDatabase &db) {
+    QSqlQuery query(db);
+    return query.exec("SELECT sqlite_compileoption_used('ENABLE_FTS5')") && query.next() && query.value(0).toBool();
+}
+
+bool hasTable(QSqlDatabase &db, const QString &table) {
+    QSqlQuery query(db);
+    query.prepare("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = :name");
+    query.bindValue(":name", table);
+    return query.exec() && query.next();
+}
+
+// Converts a legacy row in place. Unparseable text is kept for display and
+// the game sorts as the oldest (played_at 0) instead of leaving history.
+QString convertPlayedAt(const QString &timestamp) {
+    return QString("played_at = COALESCE(%1, 0), timestamp = CASE WHEN %1 IS NULL THEN %2 END")
+        .arg(epochMsOf(timestamp), timestamp);
+}
+
+} // namespace
+// ==================== Schema Migrations ====================
+// (registerSchemaMigrations()) - ordered list of schema versions.
+// Never edit a released migration; append a new version instead.
+// Databases created before versioning report user_version 0 with any
+// subset of the version 1 schema, so version 1 only adds what's missing.
+void TicTacToe::registerSchemaMigrations(SchemaMigrator &migrator) {
+    migrator.addMigration(1, "Baseline users/matches schema", [](QSqlDatabase &db, QString *error) {
+        if (!SchemaMigrator::execAll(db, {
+                "CREATE TABLE IF NOT EXISTS users ("
+                "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                "username TEXT UNIQUE NOT NULL,"
+                "password_hash TEXT NOT NULL,"
+                "salt TEXT NOT NULL"
+                ")",
+                "CREATE TABLE IF NOT EXISTS matches ("
+                "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                "player1 TEXT NOT NULL,"
+                "player2 TEXT NOT NULL,"
+                "winner TEXT,"
+                "result TEXT,"
+                "moves TEXT,"
+                "timestamp TEXT,"
+                "starting_player TEXT,"
+                "game_mode TEXT,"
+                "series_id TEXT,"           // Unique identifier for the series
+                "game_number INTEGER,"      // Game number within the series
+                "series_total INTEGER,"     // Total games in the series
+                "series_target INTEGER"     // Games needed to win series
+                ")"}, error)) {
+            return false;
+        }
+        // Columns added after the first release
+        return SchemaMigrator::addColumnIfMissing(db, "matches", "starting_player", "TEXT", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "game_mode", "TEXT", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "series_id", "TEXT", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "game_number", "INTEGER", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "series_total", "INTEGER", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "series_target", "INTEGER", error);
+    });
+
+    // Per-participant index for history screens and account deletion.
+    // Maintained by triggers so every writer (GUI, DbWriter, imports) keeps it in sync.
+    migrator.addMigration(2, "match_participants history index", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::execAll(db, {
+            "CREATE TABLE IF NOT EXISTS match_participants ("
+            "username TEXT NOT NULL,"
+            "timestamp TEXT NOT NULL DEFAULT '',"
+            "match_id INTEGER NOT NULL,"
+            "PRIMARY KEY (username, timestamp, match_id)"
+            ") WITHOUT ROWID",
+            "CREATE TRIGGER IF NOT EXISTS matches_participants_insert AFTER INSERT ON matches BEGIN "
+            "INSERT OR IGNORE INTO match_participants (username, timestamp, match_id) "
+            "VALUES (NEW.player1, COALESCE(NEW.timestamp, ''), NEW.id); "
+            "INSERT OR IGNORE INTO match_participants (username, timestamp, match_id) "
+            "VALUES (NEW.player2, COALESCE(NEW.timestamp, ''), NEW.id); "
+            "END",
+            "CREATE TRIGGER IF NOT EXISTS matches_participants_delete AFTER DELETE ON matches BEGIN "
+            "DELETE FROM match_participants WHERE username = OLD.player1 "
+            "AND timestamp = COALESCE(OLD.timestamp, '') AND match_id = OLD.id; "
+            "DELETE FROM match_participants WHERE username = OLD.player2 "
+            "AND timestamp = COALESCE(OLD.timestamp, '') AND match_id = OLD.id; "
+            "END",
+            "CREATE INDEX IF NOT EXISTS idx_matches_series ON matches (series_id, game_number)"}, error);
+    });
+
+    migrator.addMigration(3, "Binary moves_blob column", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::addColumnIfMissing(db, "matches", "moves_blob", "BLOB", error);
+    });
+
+    // Normalized schema: matches reference users and series by integer id.
+    // Deleting a user cascades to their matches, and from there to
+    // match_players; a series row goes away with its last game.
+    // (Requires PRAGMA foreign_keys = ON on the connection.)
+    migrator.addMigration(4, "Integer user ids, series table and match_players", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::execAll(db, {
+                   "CREATE TABLE IF NOT EXISTS series ("
+                   "id INTEGER PRIMARY KEY,"
+                   "series_key TEXT UNIQUE NOT NULL,"
+                   "total INTEGER,"
+                   "target INTEGER,"
+                   "game_mode TEXT"
+                   ")"}, error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "player1_id",
+                                                     "INTEGER REFERENCES users(id) ON DELETE CASCADE", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "player2_id",
+                                                     "INTEGER REFERENCES users(id) ON DELETE CASCADE", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "series_ref",
+                                                     "INTEGER REFERENCES series(id) ON DELETE CASCADE", error)
+               && SchemaMigrator::execAll(db, {
+                   "CREATE INDEX IF NOT EXISTS idx_matches_player1_id ON matches (player1_id)",
+                   "CREATE INDEX IF NOT EXISTS idx_matches_player2_id ON matches (player2_id)",
+                   "DROP INDEX IF EXISTS idx_matches_series",
+                   "CREATE INDEX IF NOT EXISTS idx_matches_series_ref ON matches (series_ref, game_number)",
+                   "CREATE TABLE IF NOT EXISTS match_players ("
+                   "user_id INTEGER NOT NULL REFERENCES users(id) ON DELETE CASCADE,"
+                   "timestamp TEXT NOT NULL DEFAULT '',"
+                   "match_id INTEGER NOT NULL REFERENCES matches(id) ON DELETE CASCADE,"
+                   "PRIMARY KEY (user_id, timestamp, match_id)"
+                   ") WITHOUT ROWID",
+                   "CREATE INDEX IF NOT EXISTS idx_match_players_match ON match_players (match_id)",
+                   "DROP TRIGGER IF EXISTS matches_participants_insert",
+                   "DROP TRIGGER IF EXISTS matches_participants_delete",
+                   "DROP TABLE IF EXISTS match_participants",
+                   "CREATE TRIGGER IF NOT EXISTS matches_players_insert AFTER INSERT ON matches BEGIN "
+                   "INSERT OR IGNORE INTO match_players (user_id, timestamp, match_id) "
+                   "SELECT NEW.player1_id, COALESCE(NEW.timestamp, ''), NEW.id WHERE NEW.player1_id IS NOT NULL; "
+                   "INSERT OR IGNORE INTO match_players (user_id, timestamp, match_id) "
+                   "SELECT NEW.player2_id, COALESCE(NEW.timestamp, ''), NEW.id WHERE NEW.player2_id IS NOT NULL; "
+                   "END",
+                   "CREATE TRIGGER IF NOT EXISTS matches_series_cleanup AFTER DELETE ON matches "
+                   "WHEN OLD.series_ref IS NOT NULL BEGIN "
+                   "DELETE FROM series WHERE id = OLD.series_ref "
+                   "AND NOT EXISTS (SELECT 1 FROM matches WHERE series_ref = OLD.series_ref); "
+                   "END"}, error);
+    });
+
+    // Per-user aggregates so profile and leaderboard screens read one row
+    // instead of scanning history. Kept current by a trigger on match_players,
+    // which fires once per registered participant of every new match,
+    // whichever writer inserted it. current_streak is signed: +n wins, -n losses.
+    migrator.addMigration(5, "user_stats aggregates", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::addColumnIfMissing(db, "matches", "difficulty", "INTEGER", error) // NULL for PvP
+               && SchemaMigrator::execAll(db, {
+                   "CREATE TABLE IF NOT EXISTS user_stats ("
+                   "user_id INTEGER PRIMARY KEY REFERENCES users(id) ON DELETE CASCADE,"
+                   "games INTEGER NOT NULL DEFAULT 0,"
+                   "wins INTEGER NOT NULL DEFAULT 0,"
+                   "losses INTEGER NOT NULL DEFAULT 0,"
+                   "ties INTEGER NOT NULL DEFAULT 0,"
+                   "surrenders INTEGER NOT NULL DEFAULT 0,"
+                   "current_streak INTEGER NOT NULL DEFAULT 0,"
+                   "best_streak INTEGER NOT NULL DEFAULT 0,"
+                   "easy_wins INTEGER NOT NULL DEFAULT 0,"
+                   "easy_losses INTEGER NOT NULL DEFAULT 0,"
+                   "easy_ties INTEGER NOT NULL DEFAULT 0,"
+                   "medium_wins INTEGER NOT NULL DEFAULT 0,"
+                   "medium_losses INTEGER NOT NULL DEFAULT 0,"
+                   "medium_ties INTEGER NOT NULL DEFAULT 0,"
+                   "hard_wins INTEGER NOT NULL DEFAULT 0,"
+                   "hard_losses INTEGER NOT NULL DEFAULT 0,"
+                   "hard_ties INTEGER NOT NULL DEFAULT 0,"
+                   "first_wins INTEGER NOT NULL DEFAULT 0,"   // User made the first move
+                   "first_losses INTEGER NOT NULL DEFAULT 0,"
+                   "first_ties INTEGER NOT NULL DEFAULT 0,"
+                   "second_wins INTEGER NOT NULL DEFAULT 0,"
+                   "second_losses INTEGER NOT NULL DEFAULT 0,"
+                   "second_ties INTEGER NOT NULL DEFAULT 0"
+                   ")",
+                   "CREATE TRIGGER IF NOT EXISTS users_stats_insert AFTER INSERT ON users BEGIN "
+                   "INSERT OR IGNORE INTO user_stats (user_id) VALUES (NEW.id); "
+                   "END",
+                   QString("CREATE TRIGGER IF NOT EXISTS match_players_stats AFTER INSERT ON match_players BEGIN "
+                           "INSERT OR IGNORE INTO user_stats (user_id) VALUES (NEW.user_id); ")
+                   + SqliteUserStore::STATS_UPDATE
+                   + "FROM (SELECT "
+                   "CASE WHEN m.winner = u.username THEN 1 WHEN m.winner = '-' THEN 0 ELSE -1 END AS outcome, "
+                   "COALESCE(m.result LIKE '%Surrender%', 0) AS surrender, "
+                   "m.difficulty AS difficulty, "
+                   // Player 1 plays X; legacy rows without starting_player count in neither split
+                   "CASE WHEN m.starting_player IS NULL THEN NULL "
+                   "ELSE (m.player1_id IS NEW.user_id) = (m.starting_player = 'X') END AS first "
+                   "FROM matches m, users u WHERE m.id = NEW.match_id AND u.id = NEW.user_id) AS o "
+                   "WHERE user_stats.user_id = NEW.user_id; "
+                   "END",
+                   "INSERT OR IGNORE INTO user_stats (user_id) SELECT id FROM users",
+                   // match_players rows written before the trigger are counted
+                   // by the "user_stats" backfill, up to this bound
+                   "CREATE TABLE IF NOT EXISTS user_stats_seed (max_match_id INTEGER NOT NULL)",
+                   "INSERT INTO user_stats_seed SELECT COALESCE(MAX(match_id), 0) FROM match_players"}, error);
+    });
+
+    // Content-addressed game bodies (see gamebody.h). refcount follows the
+    // matches rows pointing at a body, including cascaded deletes; a body
+    // goes away with its last reference.
+    migrator.addMigration(6, "Deduplicated game_bodies", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::execAll(db, {
+                   "CREATE TABLE IF NOT EXISTS game_bodies ("
+                   "id INTEGER PRIMARY KEY,"
+                   "hash BLOB UNIQUE NOT NULL,"
+                   "moves_blob BLOB NOT NULL,"   // Canonical sequence, MoveCodec-encoded
+                   "refcount INTEGER NOT NULL DEFAULT 0"
+                   ")"}, error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "body_id", "INTEGER REFERENCES game_bodies(id)", error)
+               && SchemaMigrator::addColumnIfMissing(db, "matches", "body_symmetry", "INTEGER", error)
+               && SchemaMigrator::execAll(db, {
+                   "CREATE INDEX IF NOT EXISTS idx_matches_body ON matches (body_id)",
+                   "CREATE TRIGGER IF NOT EXISTS matches_body_insert AFTER INSERT ON matches "
+                   "WHEN NEW.body_id IS NOT NULL BEGIN "
+                   "UPDATE game_bodies SET refcount = refcount + 1 WHERE id = NEW.body_id; "
+                   "END",
+                   "CREATE TRIGGER IF NOT EXISTS matches_body_update AFTER UPDATE OF body_id ON matches "
+                   "WHEN OLD.body_id IS NOT NEW.body_id BEGIN "
+                   "UPDATE game_bodies SET refcount = refcount + 1 WHERE id = NEW.body_id; "
+                   "UPDATE game_bodies SET refcount = refcount - 1 WHERE id = OLD.body_id; "
+                   "DELETE FROM game_bodies WHERE id = OLD.body_id AND refcount <= 0; "
+                   "END",
+                   "CREATE TRIGGER IF NOT EXISTS matches_body_delete AFTER DELETE ON matches "
+                   "WHEN OLD.body_id IS NOT NULL BEGIN "
+                   "UPDATE game_bodies SET refcount = refcount - 1 WHERE id = OLD.body_id; "
+                   "DELETE FROM game_bodies WHERE id = OLD.body_id AND refcount <= 0; "
+                   "END"}, error);
+    });
+
+    // Where each bulk import stopped (see matchimport.h). Updated in the same
+    // transaction as the rows it covers, so a resumed import neither skips
+    // nor duplicates games.
+    migrator.addMigration(7, "import_checkpoints", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::execAll(db, {
+            "CREATE TABLE IF NOT EXISTS import_checkpoints ("
+            "source TEXT PRIMARY KEY,"         // Canonical path of the imported file
+            "position INTEGER NOT NULL,"       // Byte offset (text) or record count (columnar) done
+            "imported INTEGER NOT NULL DEFAULT 0,"
+            "rejected INTEGER NOT NULL DEFAULT 0,"
+            "finished INTEGER NOT NULL DEFAULT 0"
+            ")"}, error);
+    });
+
+    // Retention tier for old games (see matcharchive.h). Chunks are only
+    // reached through archived_matches, which goes with its chunk.
+    migrator.addMigration(8, "Compressed match archive", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::execAll(db, {
+            "CREATE TABLE IF NOT EXISTS archive_chunks ("
+            "id INTEGER PRIMARY KEY,"
+            "games INTEGER NOT NULL,"
+            "oldest TEXT,"
+            "newest TEXT,"
+            "payload BLOB NOT NULL"        // qCompress'ed columnar export of the games
+            ")",
+            "CREATE TABLE IF NOT EXISTS archived_matches ("
+            "match_id INTEGER PRIMARY KEY,"
+            "chunk_id INTEGER NOT NULL REFERENCES archive_chunks(id) ON DELETE CASCADE"
+            ")",
+            "CREATE INDEX IF NOT EXISTS idx_archived_matches_chunk ON archived_matches (chunk_id)",
+            "CREATE TABLE IF NOT EXISTS archived_players ("
+            "username TEXT NOT NULL,"
+            "timestamp TEXT NOT NULL DEFAULT '',"
+            "match_id INTEGER NOT NULL,"
+            "PRIMARY KEY (username, timestamp, match_id)"
+            ") WITHOUT ROWID",
+            "CREATE TABLE IF NOT EXISTS archived_series ("
+            "series_key TEXT PRIMARY KEY,"
+            "game_mode TEXT,"
+            "total INTEGER,"
+            "target INTEGER,"
+            "player1 TEXT,"
+            "player2 TEXT,"
+            "games INTEGER NOT NULL DEFAULT 0,"
+            "player1_wins INTEGER NOT NULL DEFAULT 0,"
+            "player2_wins INTEGER NOT NULL DEFAULT 0,"
+            "ties INTEGER NOT NULL DEFAULT 0,"
+            "first_played TEXT,"
+            "last_played TEXT"
+            ")",
+            // Archive batches take the oldest games first
+            "CREATE INDEX IF NOT EXISTS idx_matches_timestamp ON matches (timestamp)"}, error);
+    });
+
+    // Play times as integer epoch milliseconds (UTC), so history ranges and
+    // archive cutoffs are index range scans and sort without parsing text.
+    // The text timestamp stays for rows the backfill hasn't converted yet
+    // (they're missing from history until then, as with match_players); the
+    // insert trigger converts rows from writers that still only send text.
+    migrator.addMigration(9, "played_at epoch milliseconds", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::addColumnIfMissing(db, "matches", "played_at", "INTEGER", error)
+               && SchemaMigrator::addColumnIfMissing(db, "match_players", "played_at", "INTEGER", error)
+               && SchemaMigrator::addColumnIfMissing(db, "archived_players", "played_at", "INTEGER", error)
+               && SchemaMigrator::addColumnIfMissing(db, "archived_series", "first_played_at", "INTEGER", error)
+               && SchemaMigrator::addColumnIfMissing(db, "archived_series", "last_played_at", "INTEGER", error)
+               && SchemaMigrator::execAll(db, {
+                   "DROP TRIGGER IF EXISTS matches_players_insert",
+                   QString("CREATE TRIGGER matches_players_insert AFTER INSERT ON matches BEGIN "
+                           "UPDATE matches SET %1 WHERE id = NEW.id AND NEW.played_at IS NULL; "
+                           "INSERT OR IGNORE INTO match_players (user_id, timestamp, played_at, match_id) "
+                           "SELECT NEW.player1_id, '', COALESCE(NEW.played_at, %2, 0), NEW.id "
+                           "WHERE NEW.player1_id IS NOT NULL; "
+                           "INSERT OR IGNORE INTO match_players (user_id, timestamp, played_at, match_id) "
+                           "SELECT NEW.player2_id, '', COALESCE(NEW.played_at, %2, 0), NEW.id "
+                           "WHERE NEW.player2_id IS NOT NULL; "
+                           "END").arg(convertPlayedAt("NEW.timestamp"), epochMsOf("NEW.timestamp")),
+                   "CREATE INDEX IF NOT EXISTS idx_match_players_played ON match_players (user_id, played_at, match_id)",
+                   "DROP INDEX IF EXISTS idx_matches_timestamp",
+                   "CREATE INDEX IF NOT EXISTS idx_matches_played_at ON matches (played_at)",
+                   "CREATE INDEX IF NOT EXISTS idx_archived_players_played "
+                   "ON archived_players (username, played_at, match_id)",
+                   "CREATE INDEX IF NOT EXISTS idx_archived_players_match ON archived_players (match_id)",
+                   QString("UPDATE archived_series SET first_played_at = COALESCE(%1, 0), last_played_at = COALESCE(%2, 0) "
+                           "WHERE first_played_at IS NULL")
+                       .arg(epochMsOf("first_played"), epochMsOf("last_played"))}, error);
+    });
+
+    // History search (see historyfilter.h). The facets are filled by a
+    // trigger on match_players, like user_stats, whichever writer linked the
+    // row; each index ends in the history order so a faceted page is one
+    // range scan. match_search is an FTS5 index of names, results, series
+    // and mode keyed by match id; SQLite builds without FTS5 search by LIKE.
+    migrator.addMigration(10, "History search facets and match_search", [](QSqlDatabase &db, QString *error) {
+        if (!SchemaMigrator::addColumnIfMissing(db, "match_players", "opponent", "TEXT", error)
+            || !SchemaMigrator::addColumnIfMissing(db, "match_players", "outcome", "INTEGER", error)
+            || !SchemaMigrator::addColumnIfMissing(db, "match_players", "game_mode", "TEXT", error)
+            || !SchemaMigrator::execAll(db, {
+                   QString("CREATE TRIGGER IF NOT EXISTS match_players_facets AFTER INSERT ON match_players BEGIN "
+                           "UPDATE match_players SET %1 FROM matches m, users u "
+                           "WHERE m.id = NEW.match_id AND u.id = NEW.user_id AND match_players.user_id = NEW.user_id "
+                           "AND match_players.timestamp = NEW.timestamp AND match_players.match_id = NEW.match_id; "
+                           "END").arg(FacetColumns),
+                   "CREATE INDEX IF NOT EXISTS idx_match_players_opponent "
+                   "ON match_players (user_id, opponent, played_at, match_id)",
+                   "CREATE INDEX IF NOT EXISTS idx_match_players_outcome "
+                   "ON match_players (user_id, outcome, played_at, match_id)",
+                   "CREATE INDEX IF NOT EXISTS idx_match_players_mode "
+                   "ON match_players (user_id, game_mode, played_at, match_id)"}, error)) {
+            return false;
+        }
+        if (!hasFullText(db)) return true;
+        return SchemaMigrator::execAll(db, {
+            "CREATE VIRTUAL TABLE IF NOT EXISTS match_search USING fts5(player1, player2, result, series, game_mode)",
+            "CREATE TRIGGER IF NOT EXISTS matches_search_insert AFTER INSERT ON matches BEGIN "
+            "INSERT INTO match_search (rowid, player1, player2, result, series, game_mode) "
+            "VALUES (NEW.id, NEW.player1, NEW.player2, NEW.result, "
+            "COALESCE((SELECT series_key FROM series WHERE id = NEW.series_ref), NEW.series_id), NEW.game_mode); "
+            "END",
+            "CREATE TRIGGER IF NOT EXISTS matches_search_delete AFTER DELETE ON matches BEGIN "
+            "DELETE FROM match_search WHERE rowid = OLD.id; "
+            "END"}, error);
+    });
+
+    // Write-behind rows carry the id DbWriter gave them when queued, so a
+    // pending tail replayed after its commit is recognised (see dbwriter.h).
+    // Rows from other writers have none.
+    migrator.addMigration(11, "matches.client_id for write-behind replays", [](QSqlDatabase &db, QString *error) {
+        return SchemaMigrator::addColumnIfMissing(db, "matches", "client_id", "TEXT", error)
+               && SchemaMigrator::execAll(db, {
+                   "CREATE UNIQUE INDEX IF NOT EXISTS idx_matches_client_id ON matches (client_id) "
+                   "WHERE client_id IS NOT NULL"}, error);
+    });
+
+    // Counts match_players rows that predate the version 5 stats trigger, by
+    // re-inserting them in match id ranges so the trigger replays them.
+    // Runs before "match_players", whose inserts the trigger already counts;
+    // newer rows lie above the recorded bound. Games played meanwhile are
+    // counted first, so streaks are recomputed afterwards ("user_streaks").
+    // A no-op for databases that had user_stats rebuilt in full (see
+    // rebuildUserStats()).
+    migrator.addBackfill("user_stats", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        if (!hasTable(db, "user_stats_seed")) return cursor;
+        QSqlQuery query(db);
+        if (!query.exec("SELECT COALESCE(MAX(max_match_id), 0) FROM user_stats_seed") || !query.next()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        const qint64 maxId = query.value(0).toLongLong();
+        if (cursor >= maxId) return cursor;
+
+        const qint64 end = qMin(maxId, cursor + batchSize);
+        const QStringList statements = {
+            "CREATE TEMP TABLE user_stats_batch AS SELECT * FROM match_players "
+            "WHERE match_id > :from AND match_id <= :to",
+            "DELETE FROM match_players WHERE match_id > :from AND match_id <= :to",
+            "INSERT INTO match_players SELECT * FROM temp.user_stats_batch ORDER BY match_id",
+            "DROP TABLE temp.user_stats_batch"
+        };
+        for (const QString &statement : statements) {
+            query.prepare(statement);
+            if (statement.contains(":from")) {
+                query.bindValue(":from", cursor);
+                query.bindValue(":to", end);
+            }
+            if (!query.exec()) {
+                *error = query.lastError().text();
+                return -1;
+            }
+        }
+        return end;
+    });
+
+    // Links rows written before version 4 to user ids and series rows, walked
+    // in id ranges. (Supersedes the version 2 match_participants backfill.)
+    migrator.addBackfill("match_players", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        QSqlQuery query(db);
+        if (!query.exec("SELECT COALESCE(MAX(id), 0) FROM matches") || !query.next()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        const qint64 maxId = query.value(0).toLongLong();
+        if (cursor >= maxId) return cursor;
+
+        const qint64 end = qMin(maxId, cursor + batchSize);
+        const QStringList statements = {
+            "INSERT OR IGNORE INTO series (series_key, total, target, game_mode) "
+            "SELECT series_id, series_total, series_target, game_mode FROM matches "
+            "WHERE id > :from AND id <= :to AND series_id IS NOT NULL AND series_id <> ''",
+            "UPDATE matches SET "
+            "player1_id = COALESCE(player1_id, (SELECT id FROM users WHERE username = matches.player1)), "
+            "player2_id = COALESCE(player2_id, (SELECT id FROM users WHERE username = matches.player2)), "
+            "series_ref = COALESCE(series_ref, (SELECT id FROM series WHERE series_key = matches.series_id)), "
+            "series_id = NULL, series_total = NULL, series_target = NULL "
+            "WHERE id > :from AND id <= :to",
+            "INSERT OR IGNORE INTO match_players (user_id, timestamp, match_id) "
+            "SELECT player1_id, COALESCE(timestamp, ''), id FROM matches "
+            "WHERE id > :from AND id <= :to AND player1_id IS NOT NULL "
+            "UNION ALL "
+            "SELECT player2_id, COALESCE(timestamp, ''), id FROM matches "
+            "WHERE id > :from AND id <= :to AND player2_id IS NOT NULL"
+        };
+        for (const QString &statement : statements) {
+            query.prepare(statement);
+            query.bindValue(":from", cursor);
+            query.bindValue(":to", end);
+            if (!query.exec()) {
+                *error = query.lastError().text();
+                return -1;
+            }
+        }
+        return end;
+    });
+
+    // current_streak and best_streak of every user, from their games in play
+    // order, in user id ranges. Follows "user_stats" and "match_players",
+    // which both count older games after newer ones; games played meanwhile
+    // are applied by the trigger on top. Legacy games can't be archived
+    // before the played_at backfill, so they are all still in matches.
+    migrator.addBackfill("user_streaks", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        if (!hasTable(db, "user_stats_seed")) return cursor;
+        QSqlQuery query(db);
+        if (!query.exec("SELECT COALESCE(MAX(id), 0) FROM users") || !query.next()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        const qint64 maxId = query.value(0).toLongLong();
+        if (cursor >= maxId) {
+            if (!query.exec("DROP TABLE user_stats_seed")) {
+                *error = query.lastError().text();
+                return -1;
+            }
+            return cursor;
+        }
+
+        // A run is a stretch of equal outcomes: the difference of the two row
+        // numbers stays constant along it
+        const qint64 end = qMin(maxId, cursor + batchSize);
+        query.prepare(QString(
+            "WITH games AS ("
+            "SELECT p.user_id, m.id AS match_id, COALESCE(m.played_at, %1, 0) AS at, "
+            "CASE WHEN m.winner = u.username THEN 1 WHEN m.winner = '-' THEN 0 ELSE -1 END AS outcome "
+            "FROM match_players p JOIN matches m ON m.id = p.match_id JOIN users u ON u.id = p.user_id "
+            "WHERE p.user_id > :from AND p.user_id <= :to), "
+            "numbered AS (SELECT user_id, outcome, "
+            "ROW_NUMBER() OVER (PARTITION BY user_id ORDER BY at, match_id) AS n, "
+            "ROW_NUMBER() OVER (PARTITION BY user_id ORDER BY at, match_id) "
+            "- ROW_NUMBER() OVER (PARTITION BY user_id, outcome ORDER BY at, match_id) AS run "
+            "FROM games), "
+            "runs AS (SELECT user_id, outcome, COUNT(*) AS length, MAX(n) AS last "
+            "FROM numbered GROUP BY user_id, outcome, run), "
+            "streaks AS (SELECT user_id, MAX(CASE WHEN outcome = 1 THEN length ELSE 0 END) AS best, "
+            "(SELECT r.outcome * r.length FROM runs r WHERE r.user_id = runs.user_id ORDER BY r.last DESC LIMIT 1) "
+            "AS current FROM runs GROUP BY user_id) "
+            "UPDATE user_stats SET current_streak = streaks.current, best_streak = streaks.best "
+            "FROM streaks WHERE user_stats.user_id = streaks.user_id").arg(epochMsOf("m.timestamp")));
+        query.bindValue(":from", cursor);
+        query.bindValue(":to", end);
+        if (!query.exec()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        return end;
+    });
+
+    // Legacy comma-separated TEXT moves -> moves_blob
+    migrator.addBackfill("moves_blob", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        QSqlQuery select(db);
+        select.prepare("SELECT id, moves FROM matches "
+                       "WHERE id > :cursor AND moves_blob IS NULL AND moves IS NOT NULL ORDER BY id LIMIT :limit");
+        select.bindValue(":cursor", cursor);
+        select.bindValue(":limit", batchSize);
+        if (!select.exec()) {
+            *error = select.lastError().text();
+            return -1;
+        }
+
+        // Text that doesn't parse stays in place, as the played_at backfill
+        // leaves timestamps; readers show such games without moves
+        QVector<QPair<qint64, QByteArray>> batch;
+        qint64 lastId = cursor;
+        while (select.next()) {
+            lastId = select.value(0).toLongLong();
+            bool parsed = false;
+            const QByteArray blob = encodeMovesText(select.value(1).toString(), &parsed);
+            if (parsed) batch.append({lastId, blob});
+        }
+        select.finish();
+
+        QSqlQuery update(db);
+        update.prepare("UPDATE matches SET moves_blob = :blob, moves = NULL WHERE id = :id");
+        for (const auto &row : batch) {
+            update.bindValue(":blob", row.second);
+            update.bindValue(":id", row.first);
+            if (!update.exec()) {
+                *error = update.lastError().text();
+                return -1;
+            }
+        }
+        return lastId;
+    });
+
+    // Per-row moves_blob -> shared game_bodies (runs after the TEXT -> BLOB backfill)
+    migrator.addBackfill("game_bodies", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        QSqlQuery select(db);
+        select.prepare("SELECT id, moves_blob FROM matches "
+                       "WHERE id > :cursor AND body_id IS NULL AND moves_blob IS NOT NULL ORDER BY id LIMIT :limit");
+        select.bindValue(":cursor", cursor);
+        select.bindValue(":limit", batchSize);
+        if (!select.exec()) {
+            *error = select.lastError().text();
+            return -1;
+        }
+
+        QVector<QPair<qint64, GameBody::Canonical>> batch;
+        while (select.next()) {
+            batch.append({select.value(0).toLongLong(), GameBody::canonicalize(select.value(1).toByteArray())});
+        }
+        select.finish();
+
+        QSqlQuery body(db);
+        body.prepare("INSERT OR IGNORE INTO game_bodies (hash, moves_blob) VALUES (:hash, :body)");
+        QSqlQuery update(db);
+        update.prepare("UPDATE matches SET body_id = (SELECT id FROM game_bodies WHERE hash = :hash), "
+                       "body_symmetry = :symmetry, moves_blob = NULL WHERE id = :id");
+        for (const auto &row : batch) {
+            body.bindValue(":hash", row.second.hash);
+            body.bindValue(":body", row.second.body);
+            update.bindValue(":hash", row.second.hash);
+            update.bindValue(":symmetry", row.second.symmetry);
+            update.bindValue(":id", row.first);
+            if (!body.exec() || !update.exec()) {
+                *error = body.lastError().isValid() ? body.lastError().text() : update.lastError().text();
+                return -1;
+            }
+        }
+        return batch.isEmpty() ? cursor : batch.last().first;
+    });
+
+    // Text timestamps -> played_at, in id ranges (runs after match_players,
+    // whose backfill links rows without a play time)
+    migrator.addBackfill("played_at", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        QSqlQuery query(db);
+        if (!query.exec("SELECT COALESCE(MAX(id), 0) FROM matches") || !query.next()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        const qint64 maxId = query.value(0).toLongLong();
+        if (cursor >= maxId) return cursor;
+
+        const qint64 end = qMin(maxId, cursor + batchSize);
+        const QStringList statements = {
+            QString("UPDATE matches SET %1 WHERE id > :from AND id <= :to AND played_at IS NULL")
+                .arg(convertPlayedAt("timestamp")),
+            "UPDATE match_players SET played_at = (SELECT played_at FROM matches WHERE id = match_players.match_id) "
+            "WHERE match_id > :from AND match_id <= :to AND played_at IS NULL"
+        };
+        for (const QString &statement : statements) {
+            query.prepare(statement);
+            query.bindValue(":from", cursor);
+            query.bindValue(":to", end);
+            if (!query.exec()) {
+                *error = query.lastError().text();
+                return -1;
+            }
+        }
+        return end;
+    });
+
+    // Same for the history index of games archived before version 9
+    migrator.addBackfill("archived_played_at", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        QSqlQuery query(db);
+        if (!query.exec("SELECT COALESCE(MAX(match_id), 0) FROM archived_players") || !query.next()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        const qint64 maxId = query.value(0).toLongLong();
+        if (cursor >= maxId) return cursor;
+
+        const qint64 end = qMin(maxId, cursor + batchSize);
+        query.prepare(QString("UPDATE archived_players SET played_at = COALESCE(%1, 0) "
+                              "WHERE match_id > :from AND match_id <= :to AND played_at IS NULL").arg(epochMsOf("timestamp")));
+        query.bindValue(":from", cursor);
+        query.bindValue(":to", end);
+        if (!query.exec()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        return end;
+    });
+
+    // Search facets and match_search entries for games saved before version 10
+    migrator.addBackfill("history_search", [](QSqlDatabase &db, qint64 cursor, int batchSize, QString *error) -> qint64 {
+        QSqlQuery query(db);
+        if (!query.exec("SELECT COALESCE(MAX(id), 0) FROM matches") || !query.next()) {
+            *error = query.lastError().text();
+            return -1;
+        }
+        const qint64 maxId = query.value(0).toLongLong();
+        if (cursor >= maxId) return cursor;
+
+        const qint64 end = qMin(maxId, cursor + batchSize);
+        QStringList statements = {
+            QString("UPDATE match_players SET %1 FROM matches m, users u "
+                    "WHERE match_players.match_id > :from AND match_players.match_id <= :to "
+                    "AND match_players.outcome IS NULL AND m.id = match_players.match_id "
+                    "AND u.id = match_players.user_id").arg(FacetColumns)
+        };
+        if (hasTable(db, "match_search")) {
+            statements << "INSERT INTO match_search (rowid, player1, player2, result, series, game_mode) "
+                          "SELECT m.id, m.player1, m.player2, m.result, COALESCE(s.series_key, m.series_id), m.game_mode "
+                          "FROM matches m LEFT JOIN series s ON s.id = m.series_ref "
+                          "WHERE m.id > :from AND m.id <= :to AND NOT EXISTS (SELECT 1 FROM match_search WHERE rowid = m.id)";
+        }
+        for (const QString &statement : statements) {
+            query.prepare(statement);
+            query.bindValue(":from", cursor);
+            query.bindValue(":to", end);
+            if (!query.exec()) {
+                *error = query.lastError().text();
+                return -1;
+            }
+        }
+        return end;
+    });
+}
+
+// Recomputes user_stats from scratch in chronological order (streaks depend
+// on it). Archived games (see matcharchive.h) come first: they are older
+// than anything left in matches, and are decoded from their chunks and
+// counted like the match log's. Then match_players is emptied and refilled
+// from matches, so the stats trigger replays the live games. Runs inside the
+// caller's transaction.
+// Only for "--rebuild-stats": version 5 seeds user_stats in batches instead.
+bool TicTacToe::rebuildUserStats(QSqlDatabase &db, QString *error) {
+    if (!SchemaMigrator::execAll(db, {
+            "DROP TABLE IF EXISTS user_stats_seed",
+            "DELETE FROM user_stats",
+            "INSERT INTO user_stats (user_id) SELECT id FROM users"}, error)) {
+        return false;
+    }
+    if (hasTable(db, "archived_players")) {
+        // archived_players only lists accounts, so games between unregistered names are skipped like the trigger skips them
+        QSqlQuery archived(db);
+        archived.setForwardOnly(true);
+        if (!archived.exec("SELECT a.match_id, m.chunk_id FROM archived_players a "
+                           "JOIN archived_matches m ON m.match_id = a.match_id "
+                           "GROUP BY a.match_id ORDER BY MIN(COALESCE(a.played_at, 0)), a.match_id")) {
+            *error = archived.lastError().text();
+            return false;
+        }
+        SqliteUserStore users(db);
+        MatchArchive::ChunkReader chunks(db);
+        while (archived.next()) {
+            MatchRecord record;
+            if (!chunks.find(archived.value(1).toLongLong(), archived.value(0).toLongLong(), &record, error)
+                || !users.applyGame(record.player1, record, error)
+                || (record.player2 != record.player1 && !users.applyGame(record.player2, record, error))) {
+                return false;
+            }
+        }
+    }
+    const bool hasPlayedAt = SchemaMigrator::columnExists(db, "match_players", "played_at");
+    const QString playedAt = hasPlayedAt ? QString("COALESCE(played_at, %1, 0)").arg(epochMsOf("timestamp")) : "NULL";
+    return SchemaMigrator::execAll(db, {
+        "DELETE FROM match_players",
+        QString("INSERT OR IGNORE INTO match_players (user_id, timestamp, %1match_id) "
+                "SELECT user_id, timestamp, %1match_id FROM ("
+                "SELECT player1_id AS user_id, COALESCE(timestamp, '') AS timestamp, %2 AS played_at, id AS match_id "
+                "FROM matches WHERE player1_id IS NOT NULL "
+                "UNION ALL "
+                "SELECT player2_id, COALESCE(timestamp, ''), %2, id FROM matches WHERE player2_id IS NOT NULL"
+                ") ORDER BY %3, match_id")
+            .arg(hasPlayedAt ? "played_at, " : "", playedAt, hasPlayedAt ? "played_at" : "timestamp")}, error);
+}
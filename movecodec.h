@@ -0,0 +1,102 @@
+#ifndef MOVECODEC_H
+#define MOVECODEC_H
+
+// Compact binary encoding for move sequences (game_bodies.moves_blob).
+//
+//   byte 0     board side (3 for the classic board)
+//   3x3        one 4-bit nibble per move, low nibble first; an odd move
+//              count is padded with 0xF in the last high nibble
+//   larger     one LEB128 varint cell index per move
+//
+// A 5-move 3x3 game takes 4 bytes instead of the 9 of "0,3,1,4,2".
+// encode()/decode() work on caller-provided buffers and never allocate.
+namespace MoveCodec {
+
+constexpr int ClassicSide = 3;
+constexpr unsigned char NibblePad = 0x0F;
+
+// Upper bound on the encoded size of `count` moves on a board of side `side`
+constexpr int maxEncodedSize(int count, int side) {
+    return side == ClassicSide ? 1 + (count + 1) / 2 : 1 + count * 5;
+}
+
+// Returns the number of bytes written, or -1 if a move is off the board
+// or `capacity` is too small.
+inline int encode(const int *moves, int count, int side, unsigned char *out, int capacity) {
+    if (side < 1 || side > 255 || count < 0 || capacity < 1) return -1;
+    const int cells = side * side;
+    int size = 0;
+    out[size++] = static_cast<unsigned char>(side);
+
+    if (side == ClassicSide) {
+        if (capacity < maxEncodedSize(count, side)) return -1;
+        for (int i = 0; i < count; i += 2) {
+            if (moves[i] < 0 || moves[i] >= cells) return -1;
+            unsigned char high = NibblePad;
+            if (i + 1 < count) {
+                if (moves[i + 1] < 0 || moves[i + 1] >= cells) return -1;
+                high = static_cast<unsigned char>(moves[i + 1]);
+            }
+            out[size++] = static_cast<unsigned char>(moves[i] | (high << 4));
+        }
+        return size;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (moves[i] < 0 || moves[i] >= cells) return -1;
+        unsigned int value = static_cast<unsigned int>(moves[i]);
+        do {
+            if (size >= capacity) return -1;
+            unsigned char byte = value & 0x7F;
+            value >>= 7;
+            out[size++] = value ? (byte | 0x80) : byte;
+        } while (value);
+    }
+    return size;
+}
+
+// Returns the number of moves written to `moves`, or -1 if the data is
+// malformed or holds more than `capacity` moves. `side` receives the board side.
+inline int decode(const unsigned char *data, int size, int *moves, int capacity, int *side = nullptr) {
+    if (size < 1 || data[0] == 0) return -1;
+    const int boardSide = data[0];
+    const int cells = boardSide * boardSide;
+    if (side) *side = boardSide;
+    int count = 0;
+
+    if (boardSide == ClassicSide) {
+        for (int i = 1; i < size; ++i) {
+            const int low = data[i] & 0x0F;
+            const int high = data[i] >> 4;
+            if (low >= cells || count >= capacity) return -1;
+            moves[count++] = low;
+            if (high == NibblePad) {
+                if (i != size - 1) return -1; // Padding only allowed in the last byte
+                break;
+            }
+            if (high >= cells || count >= capacity) return -1;
+            moves[count++] = high;
+        }
+        return count;
+    }
+
+    unsigned int value = 0;
+    int shift = 0;
+    for (int i = 1; i < size; ++i) {
+        if (shift > 28) return -1;
+        value |= static_cast<unsigned int>(data[i] & 0x7F) << shift;
+        if (data[i] & 0x80) {
+            shift += 7;
+            continue;
+        }
+        if (value >= static_cast<unsigned int>(cells) || count >= capacity) return -1;
+        moves[count++] = static_cast<int>(value);
+        value = 0;
+        shift = 0;
+    }
+    return shift == 0 ? count : -1; // Truncated varint
+}
+
+} // namespace MoveCodec
+
+#endif // MOVECODEC_H
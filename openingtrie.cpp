@@ -0,0 +1,237 @@
+#include "openingtrie.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace {
+
+constexpr quint32 SnapshotMagic = 0x54544F54; // "TTOT"
+constexpr quint16 SnapshotVersion = 1;
+
+// symmetry[t][i]: where cell i lands under the t-th rotation/reflection
+constexpr int symmetry[8][9] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8}, // identity
+    {2, 5, 8, 1, 4, 7, 0, 3, 6}, // rotate 90
+    {8, 7, 6, 5, 4, 3, 2, 1, 0}, // rotate 180
+    {6, 3, 0, 7, 4, 1, 8, 5, 2}, // rotate 270
+    {2, 1, 0, 5, 4, 3, 8, 7, 6}, // mirror left-right
+    {6, 7, 8, 3, 4, 5, 0, 1, 2}, // mirror top-bottom
+    {0, 3, 6, 1, 4, 7, 2, 5, 8}, // main diagonal
+    {8, 5, 2, 7, 4, 1, 6, 3, 0}  // anti-diagonal
+};
+
+constexpr int powersOf3[9] = {1, 3, 9, 27, 81, 243, 729, 2187, 6561};
+
+constexpr int lines[8][3] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8}, {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, {0, 4, 8}, {2, 4, 6}
+};
+
+bool hasLine(const std::array<quint8, 9> &cells, quint8 mark) {
+    for (const auto &line : lines) {
+        if (cells[line[0]] == mark && cells[line[1]] == mark && cells[line[2]] == mark) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+OpeningTrie::OpeningTrie() {
+    clear();
+}
+
+void OpeningTrie::clear() {
+    nodes.clear();
+    nodes.append(Node());
+    lastMatchId = 0;
+}
+
+// Replays the moves: only a game that ends exactly when a line is completed
+// or the board fills up has an outcome.
+OpeningTrie::Outcome OpeningTrie::outcomeOf(const std::vector<int> &moves) {
+    std::array<quint8, 9> cells{};
+    for (size_t i = 0; i < moves.size(); ++i) {
+        const int cell = moves[i];
+        if (cell < 0 || cell >= 9 || cells[cell] != 0) return Outcome::Unfinished;
+        const quint8 mark = (i % 2 == 0) ? 1 : 2;
+        cells[cell] = mark;
+        if (hasLine(cells, mark)) {
+            if (i + 1 != moves.size()) return Outcome::Unfinished; // Moves after the game ended
+            return mark == 1 ? Outcome::FirstMoverWin : Outcome::SecondMoverWin;
+        }
+    }
+    return moves.size() == 9 ? Outcome::Draw : Outcome::Unfinished;
+}
+
+// cells: 0 empty, 1 first mover, 2 second mover
+quint16 OpeningTrie::canonicalKey(const std::array<quint8, 9> &cells) {
+    int best = powersOf3[8] * 3;
+    for (const auto &map : symmetry) {
+        int key = 0;
+        for (int i = 0; i < 9; ++i) key += cells[i] * powersOf3[map[i]];
+        best = std::min(best, key);
+    }
+    return static_cast<quint16>(best);
+}
+
+int OpeningTrie::child(int node, quint16 key) const {
+    for (int c = nodes[node].firstChild; c != -1; c = nodes[c].nextSibling) {
+        if (nodes[c].key == key) return c;
+    }
+    return -1;
+}
+
+int OpeningTrie::addChild(int node, quint16 key) {
+    Node created;
+    created.key = key;
+    created.nextSibling = nodes[node].firstChild;
+    nodes.append(created);
+    nodes[node].firstChild = nodes.size() - 1;
+    return nodes.size() - 1;
+}
+
+bool OpeningTrie::addGame(const std::vector<int> &moves) {
+    const Outcome outcome = outcomeOf(moves);
+    if (outcome == Outcome::Unfinished) return false;
+
+    auto count = [outcome](Stats &stats) {
+        if (outcome == Outcome::FirstMoverWin) ++stats.firstWins;
+        else if (outcome == Outcome::SecondMoverWin) ++stats.secondWins;
+        else ++stats.draws;
+    };
+
+    std::array<quint8, 9> cells{};
+    int node = 0;
+    count(nodes[0].stats);
+    for (size_t i = 0; i < moves.size(); ++i) {
+        cells[moves[i]] = (i % 2 == 0) ? 1 : 2;
+        const quint16 key = canonicalKey(cells);
+        int next = child(node, key);
+        if (next == -1) next = addChild(node, key);
+        node = next;
+        count(nodes[node].stats);
+    }
+    return true;
+}
+
+int OpeningTrie::walk(const std::vector<int> &prefix, std::array<quint8, 9> *cells) const {
+    cells->fill(0);
+    int node = 0;
+    for (size_t i = 0; i < prefix.size() && node != -1; ++i) {
+        const int cell = prefix[i];
+        if (cell < 0 || cell >= 9 || (*cells)[cell] != 0) return -1;
+        (*cells)[cell] = (i % 2 == 0) ? 1 : 2;
+        node = child(node, canonicalKey(*cells));
+    }
+    return node;
+}
+
+OpeningTrie::Stats OpeningTrie::statsAt(const std::vector<int> &prefix) const {
+    std::array<quint8, 9> cells;
+    const int node = walk(prefix, &cells);
+    return node == -1 ? Stats() : nodes[node].stats;
+}
+
+// One entry per empty cell that recorded games continued with; symmetric
+// cells share a child node and so report the same counts.
+QVector<OpeningTrie::Continuation> OpeningTrie::continuations(const std::vector<int> &prefix) const {
+    QVector<Continuation> result;
+    std::array<quint8, 9> cells;
+    const int node = walk(prefix, &cells);
+    if (node == -1) return result;
+
+    const quint8 mark = (prefix.size() % 2 == 0) ? 1 : 2;
+    for (int cell = 0; cell < 9; ++cell) {
+        if (cells[cell] != 0) continue;
+        cells[cell] = mark;
+        const int next = child(node, canonicalKey(cells));
+        cells[cell] = 0;
+        if (next != -1) result.append({cell, nodes[next].stats});
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Continuation &a, const Continuation &b) {
+        return a.stats.games() > b.stats.games();
+    });
+    return result;
+}
+
+// Streams the matches added since the last snapshot (all of them on first run)
+bool OpeningTrie::catchUp(MatchStore &store, QString *error) {
+    return store.scan(lastMatchId, [this](qint64 id, const MatchRecord &record) {
+        addGame(decodeMoves(record.moves));
+        lastMatchId = id;
+    }, error);
+}
+
+// Preorder: key, child count, then the three counters for each node
+bool OpeningTrie::saveSnapshot(const QString &path, qint64 coveredMatchId, QString *error) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    out << SnapshotMagic << SnapshotVersion << coveredMatchId << quint32(nodes.size());
+
+    std::vector<int> stack = {0};
+    while (!stack.empty()) {
+        const int node = stack.back();
+        stack.pop_back();
+        quint8 children = 0;
+        for (int c = nodes[node].firstChild; c != -1; c = nodes[c].nextSibling) ++children;
+        out << nodes[node].key << children
+            << nodes[node].stats.firstWins << nodes[node].stats.secondWins << nodes[node].stats.draws;
+
+        // Push in reverse so children are written in sibling order
+        const size_t first = stack.size();
+        for (int c = nodes[node].firstChild; c != -1; c = nodes[c].nextSibling) stack.push_back(c);
+        std::reverse(stack.begin() + first, stack.end());
+    }
+
+    if (!file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool OpeningTrie::loadSnapshot(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream in(&file);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint64 covered = 0;
+    quint32 count = 0;
+    in >> magic >> version >> covered >> count;
+    if (in.status() != QDataStream::Ok || magic != SnapshotMagic || version != SnapshotVersion) return false;
+
+    QVector<Node> loaded;
+    loaded.reserve(count);
+    // (parent index, children still to read) for each open node
+    std::vector<std::pair<int, int>> open;
+    for (quint32 i = 0; i < count; ++i) {
+        Node node;
+        quint8 children = 0;
+        in >> node.key >> children >> node.stats.firstWins >> node.stats.secondWins >> node.stats.draws;
+        if (in.status() != QDataStream::Ok) return false;
+
+        const int index = loaded.size();
+        if (!open.empty()) {
+            // Prepending reverses sibling order, which lookups don't depend on
+            const int parent = open.back().first;
+            node.nextSibling = loaded[parent].firstChild;
+            loaded[parent].firstChild = index;
+            if (--open.back().second == 0) open.pop_back();
+        } else if (index != 0) {
+            return false; // A second root: corrupt file
+        }
+        loaded.append(node);
+        if (children > 0) open.push_back({index, children});
+    }
+    if (!open.empty() || loaded.isEmpty()) return false;
+
+    nodes = loaded;
+    lastMatchId = covered;
+    return true;
+}
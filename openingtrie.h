@@ -0,0 +1,73 @@
+#ifndef OPENINGTRIE_H
+#define OPENINGTRIE_H
+
+#include <QString>
+#include <QVector>
+#include <array>
+#include <vector>
+#include "matchstore.h"
+
+// Opening statistics over recorded 3x3 games: a prefix trie whose edges are
+// keyed by the canonical form of the position they lead to (minimum base-3
+// code over the 8 board symmetries), so mirrored and rotated openings share
+// a node. Marks are stored as first/second mover rather than X/O, so games
+// started by either side share the tree too.
+//
+// Every node counts the finished games that passed through it. Only games
+// decided on the board are counted (surrenders and abandoned games have no
+// board outcome). Deleting matches doesn't decrement the counts.
+//
+// The tree lives in memory, grows by addGame() as games are saved and is
+// snapshotted to a file together with the last match id it covers, so a
+// restart only streams the rows added since (catchUp()).
+class OpeningTrie {
+public:
+    enum class Outcome { FirstMoverWin, SecondMoverWin, Draw, Unfinished };
+
+    struct Stats {
+        quint32 firstWins = 0;
+        quint32 secondWins = 0;
+        quint32 draws = 0;
+        quint32 games() const { return firstWins + secondWins + draws; }
+    };
+
+    struct Continuation {
+        int cell = 0;
+        Stats stats;
+    };
+
+    OpeningTrie();
+
+    static Outcome outcomeOf(const std::vector<int> &moves);
+    static quint16 canonicalKey(const std::array<quint8, 9> &cells);
+
+    void clear();
+    bool addGame(const std::vector<int> &moves); // false if the game isn't counted
+    Stats statsAt(const std::vector<int> &prefix) const;
+    QVector<Continuation> continuations(const std::vector<int> &prefix) const; // busiest first
+
+    int nodeCount() const { return nodes.size(); }
+    quint32 gameCount() const { return nodes[0].stats.games(); }
+    qint64 watermark() const { return lastMatchId; }
+
+    bool catchUp(MatchStore &store, QString *error = nullptr);
+    bool saveSnapshot(const QString &path, qint64 coveredMatchId, QString *error = nullptr) const;
+    bool loadSnapshot(const QString &path);
+
+private:
+    struct Node {
+        quint16 key = 0;
+        int firstChild = -1;
+        int nextSibling = -1;
+        Stats stats;
+    };
+
+    int child(int node, quint16 key) const;
+    int addChild(int node, quint16 key);
+    int walk(const std::vector<int> &prefix, std::array<quint8, 9> *cells) const; // -1 if off the tree
+
+    QVector<Node> nodes; // nodes[0] is the empty board
+    qint64 lastMatchId = 0;
+};
+
+#endif // OPENINGTRIE_H
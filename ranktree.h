@@ -0,0 +1,182 @@
+#ifndef RANKTREE_H
+#define RANKTREE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Order-statistic tree: a treap whose nodes also store their subtree size,
+// so besides insert/erase it answers "how many keys sort before k" (rank)
+// and "which key is k-th" (select) in O(log n) expected time.
+//
+// Nodes live in one vector and link by index; erased slots are reused.
+// Keys must be unique under Compare (append a tie-breaking id if needed).
+template <typename Key, typename Compare = std::less<Key>>
+class RankTree {
+public:
+    explicit RankTree(Compare compare = Compare()) : less(compare) {}
+
+    int size() const { return nodeSize(root); }
+    bool empty() const { return root == Nil; }
+
+    void clear() {
+        nodes.clear();
+        freeList.clear();
+        root = Nil;
+    }
+
+    // Returns false if an equal key is already present
+    bool insert(const Key &key) {
+        if (contains(key)) return false;
+        root = insertAt(root, newNode(key));
+        return true;
+    }
+
+    bool erase(const Key &key) {
+        bool erased = false;
+        root = eraseAt(root, key, erased);
+        return erased;
+    }
+
+    bool contains(const Key &key) const {
+        int node = root;
+        while (node != Nil) {
+            if (less(key, nodes[node].key)) node = nodes[node].left;
+            else if (less(nodes[node].key, key)) node = nodes[node].right;
+            else return true;
+        }
+        return false;
+    }
+
+    // Number of keys ordered before `key` (its 0-based position if present)
+    int rank(const Key &key) const {
+        int before = 0;
+        int node = root;
+        while (node != Nil) {
+            if (less(nodes[node].key, key)) {
+                before += nodeSize(nodes[node].left) + 1;
+                node = nodes[node].right;
+            } else {
+                node = nodes[node].left;
+            }
+        }
+        return before;
+    }
+
+    // The key at 0-based position `index`; index must be in [0, size())
+    const Key &at(int index) const {
+        int node = root;
+        for (;;) {
+            const int leftSize = nodeSize(nodes[node].left);
+            if (index < leftSize) {
+                node = nodes[node].left;
+            } else if (index == leftSize) {
+                return nodes[node].key;
+            } else {
+                index -= leftSize + 1;
+                node = nodes[node].right;
+            }
+        }
+    }
+
+private:
+    static constexpr int Nil = -1;
+
+    struct Node {
+        Key key;
+        std::uint32_t priority;
+        int left;
+        int right;
+        int size;
+    };
+
+    int nodeSize(int node) const { return node == Nil ? 0 : nodes[node].size; }
+
+    void update(int node) {
+        nodes[node].size = 1 + nodeSize(nodes[node].left) + nodeSize(nodes[node].right);
+    }
+
+    std::uint32_t nextPriority() {
+        // xorshift32: deterministic, cheap, good enough to balance a treap
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    int newNode(const Key &key) {
+        Node node{key, nextPriority(), Nil, Nil, 1};
+        if (!freeList.empty()) {
+            int index = freeList.back();
+            freeList.pop_back();
+            nodes[index] = node;
+            return index;
+        }
+        nodes.push_back(node);
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    // Splits `node` into keys ordered before `key` and the rest
+    void split(int node, const Key &key, int &left, int &right) {
+        if (node == Nil) {
+            left = right = Nil;
+        } else if (less(nodes[node].key, key)) {
+            split(nodes[node].right, key, nodes[node].right, right);
+            left = node;
+            update(node);
+        } else {
+            split(nodes[node].left, key, left, nodes[node].left);
+            right = node;
+            update(node);
+        }
+    }
+
+    int merge(int left, int right) {
+        if (left == Nil) return right;
+        if (right == Nil) return left;
+        if (nodes[left].priority > nodes[right].priority) {
+            nodes[left].right = merge(nodes[left].right, right);
+            update(left);
+            return left;
+        }
+        nodes[right].left = merge(left, nodes[right].left);
+        update(right);
+        return right;
+    }
+
+    int insertAt(int node, int item) {
+        if (node == Nil) return item;
+        if (nodes[item].priority > nodes[node].priority) {
+            split(node, nodes[item].key, nodes[item].left, nodes[item].right);
+            update(item);
+            return item;
+        }
+        if (less(nodes[item].key, nodes[node].key)) nodes[node].left = insertAt(nodes[node].left, item);
+        else nodes[node].right = insertAt(nodes[node].right, item);
+        update(node);
+        return node;
+    }
+
+    int eraseAt(int node, const Key &key, bool &erased) {
+        if (node == Nil) return Nil;
+        if (less(key, nodes[node].key)) {
+            nodes[node].left = eraseAt(nodes[node].left, key, erased);
+        } else if (less(nodes[node].key, key)) {
+            nodes[node].right = eraseAt(nodes[node].right, key, erased);
+        } else {
+            erased = true;
+            freeList.push_back(node);
+            return merge(nodes[node].left, nodes[node].right);
+        }
+        update(node);
+        return node;
+    }
+
+    Compare less;
+    std::vector<Node> nodes;
+    std::vector<int> freeList;
+    int root = Nil;
+    std::uint32_t seed = 2463534242u;
+};
+
+#endif // RANKTREE_H
@@ -0,0 +1,162 @@
+#include "schemamigrator.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+
+SchemaMigrator::SchemaMigrator(const QSqlDatabase &database, QObject *parent)
+    : QObject(parent), db(database) {
+    backfillTimer.setInterval(0); // One batch per event-loop turn
+    connect(&backfillTimer, &QTimer::timeout, this, [this]() {
+        if (!runBackfillBatch(backfillBatchSize)) {
+            backfillTimer.stop();
+            emit backfillsFinished();
+        }
+    });
+}
+
+void SchemaMigrator::addMigration(int version, const QString &description, MigrationStep step) {
+    migrations.append({version, description, step});
+    std::sort(migrations.begin(), migrations.end(),
+              [](const Migration &a, const Migration &b) { return a.version < b.version; });
+}
+
+void SchemaMigrator::addBackfill(const QString &name, BackfillStep step) {
+    Backfill backfill;
+    backfill.name = name;
+    backfill.step = step;
+    backfills.append(backfill);
+}
+
+int SchemaMigrator::schemaVersion() const {
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA user_version") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+int SchemaMigrator::latestVersion() const {
+    return migrations.isEmpty() ? 0 : migrations.last().version;
+}
+
+bool SchemaMigrator::migrate(QString *error) {
+    QString localError;
+    if (!error) error = &localError;
+
+    if (!execAll(db, {"CREATE TABLE IF NOT EXISTS schema_backfills ("
+                      "name TEXT PRIMARY KEY,"
+                      "cursor INTEGER NOT NULL DEFAULT 0,"
+                      "done INTEGER NOT NULL DEFAULT 0"
+                      ")"}, error)) {
+        return false;
+    }
+
+    const int current = schemaVersion();
+    for (const Migration &migration : migrations) {
+        if (migration.version <= current) continue;
+
+        if (!db.transaction()) {
+            *error = db.lastError().text();
+            return false;
+        }
+        QSqlQuery bump(db);
+        if (!migration.step(db, error)
+            || !bump.exec(QString("PRAGMA user_version = %1").arg(migration.version))) {
+            if (error->isEmpty()) *error = bump.lastError().text();
+            *error = QString("Migration %1 (%2) failed: %3").arg(migration.version).arg(migration.description, *error);
+            db.rollback();
+            return false;
+        }
+        if (!db.commit()) {
+            *error = db.lastError().text();
+            db.rollback();
+            return false;
+        }
+        qDebug() << "Schema migrated to version" << migration.version << "-" << migration.description;
+    }
+
+    loadBackfillState();
+    return true;
+}
+
+void SchemaMigrator::loadBackfillState() {
+    QSqlQuery query(db);
+    for (Backfill &backfill : backfills) {
+        query.prepare("SELECT cursor, done FROM schema_backfills WHERE name = :name");
+        query.bindValue(":name", backfill.name);
+        if (query.exec() && query.next()) {
+            backfill.cursor = query.value(0).toLongLong();
+            backfill.done = query.value(1).toBool();
+        }
+    }
+}
+
+bool SchemaMigrator::backfillsPending() const {
+    return std::any_of(backfills.begin(), backfills.end(), [](const Backfill &b) { return !b.done; });
+}
+
+void SchemaMigrator::startBackfills(int batchSize) {
+    backfillBatchSize = qMax(1, batchSize);
+    if (backfillsPending()) backfillTimer.start();
+}
+
+bool SchemaMigrator::runBackfillBatch(int batchSize) {
+    auto it = std::find_if(backfills.begin(), backfills.end(), [](const Backfill &b) { return !b.done; });
+    if (it == backfills.end()) return false;
+
+    QString error;
+    if (!db.transaction()) {
+        // Another connection holds the lock; nothing ran, so try again later
+        // rather than reporting the backfills finished
+        qWarning() << "Backfill" << it->name << "waiting for the database:" << db.lastError().text();
+        backfillTimer.setInterval(BusyRetryMs);
+        return true;
+    }
+    backfillTimer.setInterval(0);
+    qint64 cursor = it->step(db, it->cursor, batchSize, &error);
+    bool done = (cursor == it->cursor);
+
+    QSqlQuery state(db);
+    state.prepare("INSERT OR REPLACE INTO schema_backfills (name, cursor, done) VALUES (:name, :cursor, :done)");
+    state.bindValue(":name", it->name);
+    state.bindValue(":cursor", cursor);
+    state.bindValue(":done", done ? 1 : 0);
+    if (cursor < 0 || !state.exec() || !db.commit()) {
+        db.rollback();
+        qWarning() << "Backfill" << it->name << "failed:" << (error.isEmpty() ? db.lastError().text() : error);
+        it->done = true; // Don't spin on a failing batch; it resumes on next start
+        return backfillsPending();
+    }
+
+    it->cursor = cursor;
+    it->done = done;
+    if (done) qDebug() << "Backfill" << it->name << "finished";
+    return backfillsPending();
+}
+
+bool SchemaMigrator::columnExists(QSqlDatabase &db, const QString &table, const QString &column) {
+    QSqlQuery query(db);
+    if (!query.exec(QString("PRAGMA table_info(%1)").arg(table))) return false;
+    while (query.next()) {
+        if (query.value(1).toString() == column) return true;
+    }
+    return false;
+}
+
+bool SchemaMigrator::addColumnIfMissing(QSqlDatabase &db, const QString &table, const QString &column,
+                                        const QString &definition, QString *error) {
+    if (columnExists(db, table, column)) return true;
+    return execAll(db, {QString("ALTER TABLE %1 ADD COLUMN %2 %3").arg(table, column, definition)}, error);
+}
+
+bool SchemaMigrator::execAll(QSqlDatabase &db, const QStringList &statements, QString *error) {
+    QSqlQuery query(db);
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVector>
+#include <QTimer>
+#include <functional>
+
+// PRAGMA user_version based schema migrations.
+// Migrations run in version order, each in its own transaction together
+// with the user_version bump, so a crash leaves the database at the last
+// fully applied version. Work that is proportional to table size (rewriting
+// columns, filling new tables) is registered as a backfill instead: it runs
+// after startup in small batches from the event loop, with its cursor kept
+// in schema_backfills so it resumes where it stopped.
+class SchemaMigrator : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int BusyRetryMs = 1000; // Timer interval while BEGIN fails
+    using MigrationStep = std::function<bool(QSqlDatabase &db, QString *error)>;
+    // Processes rows after `cursor` (at most batchSize of them) and returns
+    // the new cursor; returning `cursor` unchanged marks the backfill done,
+    // -1 reports an error.
+    using BackfillStep = std::function<qint64(QSqlDatabase &db, qint64 cursor, int batchSize, QString *error)>;
+
+    explicit SchemaMigrator(const QSqlDatabase &database, QObject *parent = nullptr);
+
+    void addMigration(int version, const QString &description, MigrationStep step);
+    void addBackfill(const QString &name, BackfillStep step);
+
+    bool migrate(QString *error = nullptr);
+    int schemaVersion() const;
+    int latestVersion() const;
+
+    void startBackfills(int batchSize = 500);
+    // true while work remains, including when the batch couldn't start (the
+    // database is busy) and is retried on the next tick
+    bool runBackfillBatch(int batchSize = 500);
+    bool backfillsPending() const;
+
+    static bool columnExists(QSqlDatabase &db, const QString &table, const QString &column);
+    static bool addColumnIfMissing(QSqlDatabase &db, const QString &table, const QString &column,
+                                   const QString &definition, QString *error);
+    static bool execAll(QSqlDatabase &db, const QStringList &statements, QString *error);
+
+signals:
+    void backfillsFinished();
+
+private:
+    struct Migration {
+        int version;
+        QString description;
+        MigrationStep step;
+    };
+    struct Backfill {
+        QString name;
+        BackfillStep step;
+        qint64 cursor = 0;
+        bool done = false;
+    };
+
+    void loadBackfillState();
+
+    QSqlDatabase db;
+    QVector<Migration> migrations;
+    QVector<Backfill> backfills;
+    QTimer backfillTimer;
+    int backfillBatchSize = 500;
+};
+
+#endif // SCHEMAMIGRATOR_H
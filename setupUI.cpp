@@ -79,6 +79,10 @@ void TicTacToe::setupUI() {
     historyButton->setObjectName("View Match History");
     historyButton->setMinimumHeight(40);
     connect(historyButton, &QPushButton::clicked, this, &TicTacToe::loadMatchHistory);
+    QPushButton *leaderboardButton = new QPushButton("Leaderboard", this);
+    leaderboardButton->setObjectName("leaderboardButton");
+    leaderboardButton->setMinimumHeight(40);
+    connect(leaderboardButton, &QPushButton::clicked, this, &TicTacToe::loadLeaderboard);
     QPushButton *logoutButtonMode = new QPushButton("Logout", this);
     logoutButtonMode->setMaximumWidth(100);
     connect(logoutButtonMode, &QPushButton::clicked, this, &TicTacToe::logout);
@@ -96,6 +100,7 @@ void TicTacToe::setupUI() {
     modeSelectionLayout->addWidget(pveButton);
     modeSelectionLayout->addSpacing(20);
     modeSelectionLayout->addWidget(historyButton);
+    modeSelectionLayout->addWidget(leaderboardButton);
     modeSelectionLayout->addStretch();
 
     QHBoxLayout *modeBtnsLayout = new QHBoxLayout();
@@ -117,6 +122,9 @@ void TicTacToe::setupUI() {
     scoreboardToggleButton = new QPushButton("Show Scoreboard", this);
     scoreboardToggleButton->setMaximumWidth(150);
     connect(scoreboardToggleButton, &QPushButton::clicked, this, &TicTacToe::toggleScoreboard);
+    explorerToggleButton = new QPushButton("Show Explorer", this);
+    explorerToggleButton->setMaximumWidth(150);
+    connect(explorerToggleButton, &QPushButton::clicked, this, &TicTacToe::toggleOpeningExplorer);
     QPushButton *surrenderButton = new QPushButton("🏳️ Surrender", this);
     surrenderButton->setObjectName("SurrenderButton");
     surrenderButton->setMaximumWidth(130);
@@ -126,6 +134,7 @@ void TicTacToe::setupUI() {
     connect(logoutButton, &QPushButton::clicked, this, &TicTacToe::logout);
     headerLayout->addWidget(backButton);
     headerLayout->addWidget(scoreboardToggleButton);
+    headerLayout->addWidget(explorerToggleButton);
     headerLayout->addStretch();
     headerLayout->addWidget(surrenderButton);
     headerLayout->addWidget(logoutButton);
@@ -160,6 +169,12 @@ void TicTacToe::setupUI() {
     statusLabel->setAlignment(Qt::AlignCenter);
     statusLabel->setFont(QFont("Arial", 16));
     mainLayout->addWidget(statusLabel);
+    openingExplorerLabel = new QLabel(this);
+    openingExplorerLabel->setObjectName("openingExplorerLabel");
+    openingExplorerLabel->setAlignment(Qt::AlignCenter);
+    openingExplorerLabel->setStyleSheet("QLabel { border: 1px solid #ccc; padding: 6px; }");
+    openingExplorerLabel->setVisible(explorerVisible);
+    mainLayout->addWidget(openingExplorerLabel);
     // === Difficulty Selection (Index 3) ===
     QWidget *difficultyWidget = new QWidget();
     QVBoxLayout *difficultyLayout = new QVBoxLayout(difficultyWidget);
@@ -267,15 +282,56 @@ void TicTacToe::setupUI() {
     QLabel *historyTitle = new QLabel("Match History", this);
     historyTitle->setAlignment(Qt::AlignCenter);
     historyTitle->setFont(QFont("Arial", 24, QFont::Bold));
-    matchHistoryTable = new QTableWidget(this);
+    matchHistoryModel = new MatchHistoryModel(MatchHistoryModel::Layout::History, this);
+    matchHistoryTable = new QTableView(this);
     matchHistoryTable->setObjectName("matchHistoryTable"); // <-- ADD THIS LINE
-    matchHistoryTable->setColumnCount(5);
-    matchHistoryTable->setHorizontalHeaderLabels({"Date", "Player 1", "Player 2", "Winner", "Result"});
+    matchHistoryTable->setModel(matchHistoryModel);
+    matchHistoryTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed); // Uniform rows keep scrolling O(visible)
     matchHistoryTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     matchHistoryTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    // Search bar: free text plus facets, see HistoryFilter::parse()
+    historySearchEdit = new QLineEdit(this);
+    historySearchEdit->setObjectName("historySearchEdit");
+    historySearchEdit->setPlaceholderText("Search names, results, series... or opponent: result:win mode:pvai series: from: to:");
+    historySearchEdit->setClearButtonEnabled(true);
+    historySearchEdit->setMinimumHeight(32);
+    historySearchStatus = new QLabel(this);
+    historySearchStatus->setObjectName("historySearchStatus");
+    historySearchStatus->hide();
+    historySearchTimer = new QTimer(this);
+    historySearchTimer->setSingleShot(true);
+    historySearchTimer->setInterval(250); // Search once typing pauses
+    connect(historySearchTimer, &QTimer::timeout, this, &TicTacToe::loadMatchHistory);
+    connect(historySearchEdit, &QLineEdit::textChanged, historySearchTimer, qOverload<>(&QTimer::start));
+    connect(historySearchEdit, &QLineEdit::returnPressed, this, &TicTacToe::loadMatchHistory);
+    // Date range filter, served by the played_at index
+    QHBoxLayout *historyRangeLayout = new QHBoxLayout();
+    historyRangeCheck = new QCheckBox("Only games from", this);
+    historyRangeCheck->setObjectName("historyRangeCheck");
+    historyFromEdit = new QDateEdit(QDate::currentDate().addMonths(-1), this);
+    historyFromEdit->setObjectName("historyFromEdit");
+    historyFromEdit->setCalendarPopup(true);
+    historyToEdit = new QDateEdit(QDate::currentDate(), this);
+    historyToEdit->setObjectName("historyToEdit");
+    historyToEdit->setCalendarPopup(true);
+    historyRangeLayout->addWidget(historyRangeCheck);
+    historyRangeLayout->addWidget(historyFromEdit);
+    historyRangeLayout->addWidget(new QLabel("to", this));
+    historyRangeLayout->addWidget(historyToEdit);
+    historyRangeLayout->addStretch();
+    connect(historyRangeCheck, &QCheckBox::toggled, this, &TicTacToe::loadMatchHistory);
+    connect(historyFromEdit, &QDateEdit::dateChanged, this, [this]() {
+        if (historyRangeCheck->isChecked()) loadMatchHistory();
+    });
+    connect(historyToEdit, &QDateEdit::dateChanged, this, [this]() {
+        if (historyRangeCheck->isChecked()) loadMatchHistory();
+    });
     QPushButton *openRecordedMatchesButton = new QPushButton("Replay Recorded Matches", this);
     openRecordedMatchesButton->setMinimumHeight(40);
     connect(openRecordedMatchesButton, &QPushButton::clicked, this, &TicTacToe::loadRecordedMatchesScreen);
+    QPushButton *exportHistoryButton = new QPushButton("Export History", this);
+    exportHistoryButton->setMinimumHeight(40);
+    connect(exportHistoryButton, &QPushButton::clicked, this, &TicTacToe::exportMatchHistory);
     QPushButton *backFromHistoryButton = new QPushButton("Back", this);
     backFromHistoryButton->setMaximumWidth(100);
     connect(backFromHistoryButton, &QPushButton::clicked, this, [this]() {
@@ -285,8 +341,12 @@ void TicTacToe::setupUI() {
     historyLayout->addWidget(matchHistoryTable);
     historyLayout->addWidget(backFromHistoryButton);
     historyLayout->addWidget(historyTitle);
+    historyLayout->addWidget(historySearchEdit);
+    historyLayout->addWidget(historySearchStatus);
+    historyLayout->addLayout(historyRangeLayout);
     historyLayout->addWidget(matchHistoryTable);
     historyLayout->addWidget(openRecordedMatchesButton);  // Add button here
+    historyLayout->addWidget(exportHistoryButton);
     historyLayout->addWidget(backFromHistoryButton);
     // === Recorded Matches Screen (Index 7) ===
     QWidget *recordedMatchesWidget = new QWidget();
@@ -296,9 +356,12 @@ void TicTacToe::setupUI() {
     recordedTitle->setAlignment(Qt::AlignCenter);
     recordedTitle->setFont(QFont("Arial", 24, QFont::Bold));
 
-    QTableWidget *recordedTable = new QTableWidget(this);
-    recordedTable->setColumnCount(6);
-    recordedTable->setHorizontalHeaderLabels({"Match ID", "Player 1", "Player 2", "Winner", "Result", "Date"});
+    recordedMatchesModel = new MatchHistoryModel(MatchHistoryModel::Layout::Recorded, this);
+    QTableView *recordedTable = new QTableView(this);
+    recordedTable->setModel(recordedMatchesModel);
+    recordedTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    recordedTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    recordedTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     recordedTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     recordedTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
 
@@ -318,6 +381,30 @@ void TicTacToe::setupUI() {
     // Store pointer for later use
     this->recordedMatchesTable = recordedTable;
 
+    // === Leaderboard Screen (Index 8) ===
+    QWidget *leaderboardWidget = new QWidget();
+    QVBoxLayout *leaderboardLayout = new QVBoxLayout(leaderboardWidget);
+    QLabel *leaderboardTitle = new QLabel("Leaderboard", this);
+    leaderboardTitle->setAlignment(Qt::AlignCenter);
+    leaderboardTitle->setFont(QFont("Arial", 24, QFont::Bold));
+    leaderboardRankLabel = new QLabel(this);
+    leaderboardRankLabel->setAlignment(Qt::AlignCenter);
+    leaderboardTable = new QTableWidget(0, 5, this);
+    leaderboardTable->setObjectName("leaderboardTable");
+    leaderboardTable->setHorizontalHeaderLabels({"Rank", "Player", "Wins", "Losses", "Ties"});
+    leaderboardTable->verticalHeader()->hide();
+    leaderboardTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    leaderboardTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    QPushButton *backFromLeaderboardButton = new QPushButton("Back", this);
+    backFromLeaderboardButton->setMaximumWidth(100);
+    connect(backFromLeaderboardButton, &QPushButton::clicked, this, [this]() {
+        stackedWidget->setCurrentIndex(1);
+    });
+    leaderboardLayout->addWidget(leaderboardTitle);
+    leaderboardLayout->addWidget(leaderboardRankLabel);
+    leaderboardLayout->addWidget(leaderboardTable);
+    leaderboardLayout->addWidget(backFromLeaderboardButton);
+
     // === Add Widgets to Stacked Widget ===
     stackedWidget->addWidget(loginWidget);           // 0
     stackedWidget->addWidget(modeSelectionWidget);   // 1
@@ -327,6 +414,7 @@ void TicTacToe::setupUI() {
     stackedWidget->addWidget(settingsWidget);        // 5
     stackedWidget->addWidget(historyWidget);         // 6
     stackedWidget->addWidget(recordedMatchesWidget); // Index 7
+    stackedWidget->addWidget(leaderboardWidget);     // 8
     setCentralWidget(stackedWidget);
     setWindowTitle("Tic Tac Toe");
 }
@@ -0,0 +1,307 @@
+#include "sqlitematchstore.h"
+#include "dbwriter.h"
+#include "gamebody.h"
+#include "matcharchive.h"
+#include <QSqlError>
+#include <QSqlQuery>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Every column of a MatchRecord; read back by recordFromQuery() starting at `first`.
+// Rows the series backfill hasn't reached yet still carry the legacy series columns.
+const QString RecordColumns = QString(
+    "m.player1, m.player2, m.winner, m.result, m.played_at, m.timestamp, m.starting_player, m.game_mode, "
+    "m.difficulty, COALESCE(s.series_key, m.series_id), m.game_number, COALESCE(s.total, m.series_total), "
+    "COALESCE(s.target, m.series_target), %1").arg(GameBody::MovesColumns);
+const QString RecordJoins = QString(
+    "LEFT JOIN series s ON s.id = m.series_ref %1").arg(GameBody::BodyJoin);
+
+// Each term a word prefix, all required: "alice" bob -> "alice"* "bob"*
+QString fullTextQuery(const QStringList &terms) {
+    QStringList phrases;
+    for (QString term : terms) phrases << '"' + term.replace('"', "\"\"") + "\"*";
+    return phrases.join(' ');
+}
+
+// Without FTS5: a word prefix, with words taken to follow a space (the
+// columns are matched with one prepended)
+QString likePattern(QString term) {
+    term.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+    return "% " + term + '%';
+}
+
+bool newerFirst(const MatchSummary &a, const MatchSummary &b) {
+    return a.playedAt != b.playedAt ? a.playedAt > b.playedAt : a.id > b.id;
+}
+
+} // namespace
+
+QString SqliteMatchStore::selectRecords(const QString &where) {
+    return QString("SELECT m.id, %1 FROM matches m %2 WHERE %3").arg(RecordColumns, RecordJoins, where);
+}
+
+MatchRecord SqliteMatchStore::recordFromQuery(const QSqlQuery &query, int first) {
+    MatchRecord record;
+    record.player1 = query.value(first).toString();
+    record.player2 = query.value(first + 1).toString();
+    record.winner = query.value(first + 2).toString();
+    record.result = query.value(first + 3).toString();
+    // Text is left on rows the played_at backfill hasn't reached yet and on
+    // ones whose text didn't parse
+    const QVariant playedAt = query.value(first + 4);
+    const QString text = query.value(first + 5).toString();
+    record.timestamp = text.isEmpty() && !playedAt.isNull() ? timestampText(playedAt.toLongLong()) : text;
+    record.playedAt = playedAt.isNull() ? playedAtFromText(text) : playedAt.toLongLong();
+    record.startingPlayer = query.value(first + 6).toString();
+    record.gameMode = query.value(first + 7).toString();
+    record.difficulty = query.value(first + 8).toInt();
+    record.seriesId = query.value(first + 9).toString();
+    record.gameNumber = query.value(first + 10).toInt();
+    record.seriesTotal = query.value(first + 11).toInt();
+    record.seriesTarget = query.value(first + 12).toInt();
+    record.moves = GameBody::movesFromColumns(query.value(first + 13), query.value(first + 14),
+                                              query.value(first + 15), query.value(first + 16));
+    return record;
+}
+
+// Both are one range scan of idx_match_players_played, the date range
+// bounding it from below and the keyset (or the range) from above.
+const char *const SqliteMatchStore::FIRST_PAGE_QUERY =
+    "SELECT m.id, m.player1, m.player2, m.winner, m.result, p.played_at, "
+    "COALESCE(s.series_key, m.series_id), m.game_number, COALESCE(s.total, m.series_total), m.timestamp "
+    "FROM match_players p CROSS JOIN matches m ON m.id = p.match_id "
+    "LEFT JOIN series s ON s.id = m.series_ref "
+    "WHERE p.user_id = (SELECT id FROM users WHERE username = :user) "
+    "AND p.played_at >= :from AND p.played_at < :to "
+    "ORDER BY p.played_at DESC, p.match_id DESC LIMIT :limit";
+
+const char *const SqliteMatchStore::NEXT_PAGE_QUERY =
+    "SELECT m.id, m.player1, m.player2, m.winner, m.result, p.played_at, "
+    "COALESCE(s.series_key, m.series_id), m.game_number, COALESCE(s.total, m.series_total), m.timestamp "
+    "FROM match_players p CROSS JOIN matches m ON m.id = p.match_id "
+    "LEFT JOIN series s ON s.id = m.series_ref "
+    "WHERE p.user_id = (SELECT id FROM users WHERE username = :user) "
+    "AND p.played_at >= :from AND (p.played_at, p.match_id) < (:played_at, :id) "
+    "ORDER BY p.played_at DESC, p.match_id DESC LIMIT :limit";
+
+// The history page queries plus the filter's facets. Opponent, outcome and
+// mode each have a (user_id, facet, played_at, match_id) index, so the page
+// stays one range scan; a series is read from its own few games and sorted.
+// Terms go through match_search, or LIKE where SQLite lacks FTS5.
+QString SqliteMatchStore::searchPageQuery(const HistoryFilter &filter, bool firstPage, bool fullText) {
+    QStringList where = {
+        "p.user_id = (SELECT id FROM users WHERE username = :user)",
+        "p.played_at >= :from",
+        firstPage ? "p.played_at < :to" : "(p.played_at, p.match_id) < (:played_at, :id)"
+    };
+    if (!filter.opponent.isEmpty()) where << "p.opponent = :opponent";
+    if (filter.outcome != HistoryFilter::Outcome::Any) where << "p.outcome = :outcome";
+    if (!filter.gameMode.isEmpty()) where << "p.game_mode = :mode";
+    if (!filter.seriesId.isEmpty()) where << "m.series_ref = (SELECT id FROM series WHERE series_key = :series)";
+    if (!filter.terms.isEmpty() && fullText) {
+        where << "p.match_id IN (SELECT rowid FROM match_search WHERE match_search MATCH :text)";
+    } else {
+        for (int i = 0; i < filter.terms.size(); ++i) {
+            where << QString("((' ' || m.player1) LIKE :term%1 ESCAPE '\\' OR (' ' || m.player2) LIKE :term%1 ESCAPE '\\' "
+                             "OR (' ' || m.result) LIKE :term%1 ESCAPE '\\' OR (' ' || m.game_mode) LIKE :term%1 ESCAPE '\\' "
+                             "OR (' ' || COALESCE(s.series_key, m.series_id)) LIKE :term%1 ESCAPE '\\')").arg(i);
+        }
+    }
+    return QString("SELECT m.id, m.player1, m.player2, m.winner, m.result, p.played_at, "
+                   "COALESCE(s.series_key, m.series_id), m.game_number, COALESCE(s.total, m.series_total), m.timestamp "
+                   "FROM %1 LEFT JOIN series s ON s.id = m.series_ref WHERE %2 "
+                   "ORDER BY p.played_at DESC, p.match_id DESC LIMIT :limit")
+        .arg(filter.seriesId.isEmpty() ? "match_players p CROSS JOIN matches m ON m.id = p.match_id"
+                                       : "matches m CROSS JOIN match_players p ON p.match_id = m.id",
+             where.join(" AND "));
+}
+
+SqliteMatchStore::SqliteMatchStore(const QSqlDatabase &db, DbWriter *writer)
+    : db(db), writer(writer), statements(db) {}
+
+bool SqliteMatchStore::append(const MatchRecord &record, QString *error) {
+    if (writer) {
+        writer->enqueue(record); // Failures surface later through DbWriter::writeFailed
+        return true;
+    }
+    StatementCache::Statement series = statements.statement(DbWriter::SERIES_INSERT_QUERY);
+    StatementCache::Statement body = statements.statement(DbWriter::BODY_INSERT_QUERY);
+    StatementCache::Statement match = statements.statement(DbWriter::MATCH_INSERT_QUERY);
+    return DbWriter::insertRecord(*series, *body, *match, record, error);
+}
+
+void SqliteMatchStore::flush() {
+    if (writer) writer->flush();
+}
+
+bool SqliteMatchStore::historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                                   QVector<MatchSummary> *page, QString *error) {
+    if (filter.hasFacets() && fullText < 0) {
+        QSqlQuery probe(db);
+        fullText = probe.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'match_search'") && probe.next();
+    }
+    {
+        // Search SQL varies with the facets given; each variant is cached on its own
+        StatementCache::Statement statement = statements.statement(
+            !filter.hasFacets() ? QString(after ? NEXT_PAGE_QUERY : FIRST_PAGE_QUERY)
+                                : searchPageQuery(filter, after == nullptr, fullText));
+        QSqlQuery &query = *statement;
+        if (filter.hasFacets()) {
+            query.bindValue(":opponent", filter.opponent);
+            query.bindValue(":outcome", filter.outcome == HistoryFilter::Outcome::Win ? 1
+                                        : filter.outcome == HistoryFilter::Outcome::Tie ? 0 : -1);
+            query.bindValue(":mode", filter.gameMode);
+            query.bindValue(":series", filter.seriesId);
+            if (fullText) {
+                query.bindValue(":text", fullTextQuery(filter.terms));
+            } else {
+                for (int i = 0; i < filter.terms.size(); ++i) query.bindValue(QString(":term%1").arg(i), likePattern(filter.terms[i]));
+            }
+        }
+        if (!after) {
+            query.bindValue(":to", filter.range.to);
+        } else {
+            // The cursor is already inside the range
+            query.bindValue(":played_at", after->playedAt);
+            query.bindValue(":id", after->id);
+        }
+        query.bindValue(":from", filter.range.from);
+        query.bindValue(":user", user);
+        query.bindValue(":limit", limit);
+        if (!query.exec()) {
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+
+        page->clear();
+        while (query.next()) {
+            MatchSummary row;
+            row.id = query.value(0).toLongLong();
+            row.player1 = query.value(1).toString();
+            row.player2 = query.value(2).toString();
+            row.winner = query.value(3).toString();
+            row.result = query.value(4).toString();
+            row.playedAt = query.value(5).toLongLong();
+            row.seriesId = query.value(6).toString();
+            row.gameNumber = query.value(7).toInt();
+            row.seriesTotal = query.value(8).toInt();
+            row.timestamp = query.value(9).toString();
+            page->append(row);
+        }
+    } // Releases the statement before the archive is read
+
+    // Older games may have moved to the archive; both sides are in keyset order
+    QVector<MatchSummary> archived;
+    if (!MatchArchive::historyPage(db, user, filter, after, limit, &archived, error)) return false;
+    if (!archived.isEmpty()) {
+        QVector<MatchSummary> merged;
+        std::merge(page->cbegin(), page->cend(), archived.cbegin(), archived.cend(), std::back_inserter(merged), newerFirst);
+        merged.resize(qMin<qsizetype>(merged.size(), limit));
+        *page = merged;
+    }
+    return true;
+}
+
+bool SqliteMatchStore::loadMatch(qint64 id, MatchRecord *record, QString *error) {
+    static const QString LoadQuery = selectRecords("m.id = :id");
+    {
+        StatementCache::Statement query = statements.statement(LoadQuery);
+        query->bindValue(":id", id);
+        if (!query->exec()) {
+            if (error) *error = query->lastError().text();
+            return false;
+        }
+        if (query->next()) {
+            *record = recordFromQuery(*query, 1);
+            return true;
+        }
+    }
+
+    bool found = false;
+    if (!MatchArchive::loadMatch(db, id, record, &found, error)) return false;
+    if (!found && error) *error = QString("Match %1 not found").arg(id);
+    return found;
+}
+
+// The user's live matches go with their users row (ON DELETE CASCADE, see
+// SqliteUserStore::DELETE_USER_QUERY); legacy rows the "match_players"
+// backfill has not linked yet, and archived ones, are dropped here by name.
+bool SqliteMatchStore::removeUserMatches(const QString &user, QString *error) {
+    {
+        StatementCache::Statement query = statements.statement(
+            "DELETE FROM matches WHERE (player1 = :user AND player1_id IS NULL) "
+            "OR (player2 = :user AND player2_id IS NULL)");
+        query->bindValue(":user", user);
+        if (!query->exec()) {
+            if (error) *error = query->lastError().text();
+            return false;
+        }
+    }
+    return MatchArchive::removeUser(db, user, error);
+}
+
+bool SqliteMatchStore::scan(qint64 afterId, const Visitor &visit, QString *error) {
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(selectRecords("m.id > :after") + " ORDER BY m.id");
+    query.bindValue(":after", afterId);
+    QSqlQuery archived(db);
+    archived.setForwardOnly(true);
+    archived.prepare("SELECT match_id, chunk_id FROM archived_matches WHERE match_id > :after ORDER BY match_id");
+    archived.bindValue(":after", afterId);
+    return visitMerged(query, archived, visit, error);
+}
+
+// Through the player's match_players and archived_players rows instead of
+// the whole table. Like history, legacy rows the "match_players" backfill
+// hasn't linked yet are left out.
+bool SqliteMatchStore::scanUser(const QString &user, const Visitor &visit, QString *error) {
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(selectRecords("m.id IN (SELECT match_id FROM match_players "
+                                "WHERE user_id = (SELECT id FROM users WHERE username = :user))") + " ORDER BY m.id");
+    query.bindValue(":user", user);
+    QSqlQuery archived(db);
+    archived.setForwardOnly(true);
+    archived.prepare("SELECT a.match_id, m.chunk_id FROM archived_players a "
+                     "JOIN archived_matches m ON m.match_id = a.match_id WHERE a.username = :user ORDER BY a.match_id");
+    archived.bindValue(":user", user);
+    return visitMerged(query, archived, visit, error);
+}
+
+bool SqliteMatchStore::visitMerged(QSqlQuery &live, QSqlQuery &archived, const Visitor &visit, QString *error) {
+    if (!live.exec() || !archived.exec()) {
+        if (error) *error = (live.lastError().isValid() ? live : archived).lastError().text();
+        return false;
+    }
+
+    // Live and archived ids interleave; archived chunks are decoded one at a time
+    MatchArchive::ChunkReader chunks(db);
+    bool hasLive = live.next();
+    bool hasArchived = archived.next();
+    while (hasLive || hasArchived) {
+        const qint64 liveId = hasLive ? live.value(0).toLongLong() : 0;
+        const qint64 archivedId = hasArchived ? archived.value(0).toLongLong() : 0;
+        if (hasArchived && (!hasLive || archivedId < liveId)) {
+            MatchRecord record;
+            if (!chunks.find(archived.value(1).toLongLong(), archivedId, &record, error)) return false;
+            visit(archivedId, record);
+            hasArchived = archived.next();
+        } else {
+            visit(liveId, recordFromQuery(live, 1));
+            hasLive = live.next();
+        }
+    }
+    return true;
+}
+
+// Archived ids count too: AUTOINCREMENT never hands them out again
+qint64 SqliteMatchStore::lastMatchId() {
+    StatementCache::Statement query = statements.statement(
+        "SELECT MAX(COALESCE((SELECT MAX(id) FROM matches), 0), "
+        "COALESCE((SELECT MAX(match_id) FROM archived_matches), 0))");
+    if (!query->exec() || !query->next()) return 0;
+    return query->value(0).toLongLong();
+}
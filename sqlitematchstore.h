@@ -0,0 +1,53 @@
+#ifndef SQLITEMATCHSTORE_H
+#define SQLITEMATCHSTORE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include "matchstore.h"
+#include "statementcache.h"
+
+class DbWriter;
+
+// The default backend: the matches table. Writes go through the DbWriter
+// write-behind queue when one is given (file databases), inline otherwise.
+// History pages use keyset pagination on (played_at, match id) over
+// match_players, so a page costs one index range scan whatever the
+// history size; searches add facet and full-text conditions on top (see
+// searchPageQuery()). Games moved to the archive (see matcharchive.h) are
+// merged back into history pages, replays and scans. Inline inserts, page
+// queries and replay loads reuse their prepared statements.
+class SqliteMatchStore : public MatchStore {
+public:
+    static const char *const FIRST_PAGE_QUERY;
+    static const char *const NEXT_PAGE_QUERY;
+    static QString searchPageQuery(const HistoryFilter &filter, bool firstPage, bool fullText);
+
+    // "SELECT m.id, <every MatchRecord column> FROM matches m ... WHERE <where>"
+    static QString selectRecords(const QString &where);
+    static MatchRecord recordFromQuery(const QSqlQuery &query, int first);
+
+    SqliteMatchStore(const QSqlDatabase &db, DbWriter *writer = nullptr);
+
+    QString name() const override { return "sqlite"; }
+    bool append(const MatchRecord &record, QString *error = nullptr) override;
+    void flush() override;
+    using MatchStore::historyPage;
+    bool historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                     QVector<MatchSummary> *page, QString *error = nullptr) override;
+    bool loadMatch(qint64 id, MatchRecord *record, QString *error = nullptr) override;
+    bool removeUserMatches(const QString &user, QString *error = nullptr) override;
+    bool scan(qint64 afterId, const Visitor &visit, QString *error = nullptr) override;
+    bool scanUser(const QString &user, const Visitor &visit, QString *error = nullptr) override;
+    qint64 lastMatchId() override;
+
+private:
+    // Merges live rows (m.id first) with archived ones (match_id, chunk_id), both in id order
+    bool visitMerged(QSqlQuery &live, QSqlQuery &archived, const Visitor &visit, QString *error);
+
+    QSqlDatabase db;
+    DbWriter *writer;
+    StatementCache statements;
+    int fullText = -1; // match_search exists; looked up on the first search
+};
+
+#endif // SQLITEMATCHSTORE_H
@@ -0,0 +1,133 @@
+#include "sqliteuserstore.h"
+#include <QSqlError>
+#include <QDebug>
+
+// Deleting the user row cascades (ON DELETE CASCADE) to their matches through
+// the indexed player1_id/player2_id columns, and from there to match_players.
+const char *const SqliteUserStore::DELETE_USER_QUERY =
+    "DELETE FROM users WHERE username = :username";
+
+// One game applied to its player's user_stats row. Followed by a FROM
+// clause naming the game's outcome (1 win, 0 tie, -1 loss), surrender,
+// difficulty and first (moved first; NULL if unknown) columns as "o".
+const char *const SqliteUserStore::STATS_UPDATE =
+    "UPDATE user_stats SET "
+    "games = games + 1, "
+    "wins = wins + (o.outcome = 1), "
+    "losses = losses + (o.outcome = -1), "
+    "ties = ties + (o.outcome = 0), "
+    "surrenders = surrenders + (o.outcome = -1 AND o.surrender), "
+    "current_streak = CASE o.outcome WHEN 1 THEN MAX(current_streak, 0) + 1 "
+    "WHEN -1 THEN MIN(current_streak, 0) - 1 ELSE 0 END, "
+    "best_streak = MAX(best_streak, CASE o.outcome WHEN 1 THEN MAX(current_streak, 0) + 1 ELSE 0 END), "
+    "easy_wins = easy_wins + (o.difficulty IS 1 AND o.outcome = 1), "
+    "easy_losses = easy_losses + (o.difficulty IS 1 AND o.outcome = -1), "
+    "easy_ties = easy_ties + (o.difficulty IS 1 AND o.outcome = 0), "
+    "medium_wins = medium_wins + (o.difficulty IS 2 AND o.outcome = 1), "
+    "medium_losses = medium_losses + (o.difficulty IS 2 AND o.outcome = -1), "
+    "medium_ties = medium_ties + (o.difficulty IS 2 AND o.outcome = 0), "
+    "hard_wins = hard_wins + (o.difficulty IS 3 AND o.outcome = 1), "
+    "hard_losses = hard_losses + (o.difficulty IS 3 AND o.outcome = -1), "
+    "hard_ties = hard_ties + (o.difficulty IS 3 AND o.outcome = 0), "
+    "first_wins = first_wins + (o.first IS 1 AND o.outcome = 1), "
+    "first_losses = first_losses + (o.first IS 1 AND o.outcome = -1), "
+    "first_ties = first_ties + (o.first IS 1 AND o.outcome = 0), "
+    "second_wins = second_wins + (o.first IS 0 AND o.outcome = 1), "
+    "second_losses = second_losses + (o.first IS 0 AND o.outcome = -1), "
+    "second_ties = second_ties + (o.first IS 0 AND o.outcome = 0) ";
+
+SqliteUserStore::SqliteUserStore(const QSqlDatabase &db, bool countsGames)
+    : db(db), statements(db), countsGames(countsGames) {}
+
+bool SqliteUserStore::findUser(const QString &username, UserAccount *account, bool *found, QString *error) {
+    StatementCache::Statement query = statements.statement("SELECT id, password_hash, salt FROM users WHERE username = :username");
+    query->bindValue(":username", username);
+    if (!query->exec()) {
+        if (error) *error = query->lastError().text();
+        return false;
+    }
+    *found = query->next();
+    if (*found) {
+        account->id = query->value(0).toLongLong();
+        account->username = username;
+        account->passwordHash = query->value(1).toString();
+        account->salt = query->value(2).toString();
+    }
+    return true;
+}
+
+bool SqliteUserStore::addUser(const QString &username, const QString &passwordHash, const QString &salt,
+                              qint64 *id, QString *error) {
+    StatementCache::Statement query = statements.statement(
+        "INSERT INTO users (username, password_hash, salt) VALUES (:username, :password_hash, :salt)");
+    query->bindValue(":username", username);
+    query->bindValue(":password_hash", passwordHash);
+    query->bindValue(":salt", salt);
+    if (!query->exec()) {
+        if (error) *error = query->lastError().text();
+        return false;
+    }
+    if (id) *id = query->lastInsertId().toLongLong();
+    return true;
+}
+
+bool SqliteUserStore::removeUser(const QString &username, QString *error) {
+    StatementCache::Statement query = statements.statement(DELETE_USER_QUERY);
+    query->bindValue(":username", username);
+    if (!query->exec()) {
+        if (error) *error = query->lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool SqliteUserStore::standings(QVector<UserStanding> *users, QString *error) {
+    StatementCache::Statement query = statements.statement(
+        "SELECT u.id, u.username, COALESCE(s.wins, 0), COALESCE(s.losses, 0), COALESCE(s.ties, 0) "
+        "FROM users u LEFT JOIN user_stats s ON s.user_id = u.id");
+    if (!query->exec()) {
+        if (error) *error = query->lastError().text();
+        return false;
+    }
+    users->clear();
+    while (query->next()) {
+        UserStanding user;
+        user.id = query->value(0).toLongLong();
+        user.username = query->value(1).toString();
+        user.wins = query->value(2).toInt();
+        user.losses = query->value(3).toInt();
+        user.ties = query->value(4).toInt();
+        users->append(user);
+    }
+    return true;
+}
+
+void SqliteUserStore::recordGame(const MatchRecord &record) {
+    if (!countsGames) return;
+    applyGame(record.player1, record);
+    if (record.player2 != record.player1) applyGame(record.player2, record);
+}
+
+// The match_players_stats trigger (see migrations.cpp) for a game that has
+// no matches row; names without an account update nothing.
+bool SqliteUserStore::applyGame(const QString &username, const MatchRecord &record, QString *error) {
+    StatementCache::Statement query = statements.statement(
+        QString(STATS_UPDATE) +
+        "FROM (SELECT :outcome AS outcome, :surrender AS surrender, :difficulty AS difficulty, :first AS first) AS o "
+        "WHERE user_stats.user_id = (SELECT id FROM users WHERE username = :username)");
+    const int outcome = record.winner == username ? 1 : record.winner == "-" ? 0 : -1;
+    query->bindValue(":outcome", outcome);
+    query->bindValue(":surrender", record.result.contains("Surrender"));
+    query->bindValue(":difficulty", record.difficulty > 0 ? QVariant(record.difficulty) : QVariant());
+    // Player 1 plays X
+    query->bindValue(":first", record.startingPlayer.isEmpty()
+                                   ? QVariant()
+                                   : QVariant((username == record.player1) == (record.startingPlayer == "X")));
+    query->bindValue(":username", username);
+    if (!query->exec()) {
+        qWarning() << "Failed to update stats for" << username << ":" << query->lastError().text();
+        if (error) *error = query->lastError().text();
+        return false;
+    }
+    return true;
+}
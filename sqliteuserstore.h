@@ -0,0 +1,38 @@
+#ifndef SQLITEUSERSTORE_H
+#define SQLITEUSERSTORE_H
+
+#include <QSqlDatabase>
+#include "statementcache.h"
+#include "userstore.h"
+
+// The users table. Win/loss counts come from user_stats, which triggers
+// keep current as matches are inserted, so recordGame() has nothing to do
+// unless the matches are stored elsewhere (countsGames, e.g. the match log).
+// Lookups and inserts reuse their prepared statements (see statementcache.h).
+class SqliteUserStore : public UserStore {
+public:
+    // Account deletion (shared with the EXPLAIN QUERY PLAN regression test)
+    static const char *const DELETE_USER_QUERY;
+    // The stats rules, shared with the match_players_stats trigger
+    static const char *const STATS_UPDATE;
+
+    explicit SqliteUserStore(const QSqlDatabase &db, bool countsGames = false);
+
+    QString name() const override { return "sqlite"; }
+    bool findUser(const QString &username, UserAccount *account, bool *found, QString *error = nullptr) override;
+    bool addUser(const QString &username, const QString &passwordHash, const QString &salt,
+                 qint64 *id, QString *error = nullptr) override;
+    bool removeUser(const QString &username, QString *error = nullptr) override;
+    bool standings(QVector<UserStanding> *users, QString *error = nullptr) override;
+    void recordGame(const MatchRecord &record) override;
+    // One player's side of a game without a matches row (the match log, archived games)
+    bool applyGame(const QString &username, const MatchRecord &record, QString *error = nullptr);
+
+private:
+
+    QSqlDatabase db;
+    StatementCache statements;
+    bool countsGames;
+};
+
+#endif // SQLITEUSERSTORE_H
@@ -0,0 +1,74 @@
+#include "statementcache.h"
+#include "storagemetrics.h"
+#include <QtAlgorithms>
+#include <utility>
+
+StatementCache::Statement::Statement(const StatementCache *cache, const QString &sql, QSqlQuery *query, bool *inUse)
+    : cache(cache), sql(sql), query(query), inUse(inUse) {
+    held.start();
+}
+
+StatementCache::Statement::Statement(Statement &&other) noexcept
+    : cache(other.cache), sql(std::move(other.sql)), query(other.query), inUse(other.inUse), held(other.held) {
+    other.query = nullptr;
+    other.inUse = nullptr;
+}
+
+StatementCache::Statement::~Statement() {
+    if (!query) return;
+    const qint64 elapsedNs = held.nsecsElapsed();
+    const qint64 thresholdNs = StorageMetrics::global().slowQueryThresholdNs();
+    const bool slow = thresholdNs > 0 && elapsedNs >= thresholdNs;
+    const QVariantList values = slow ? query->boundValues() : QVariantList();
+    if (inUse) {
+        query->finish(); // Keeps the compiled statement, resets the cursor
+        *inUse = false;
+    } else {
+        delete query;
+    }
+    if (slow) StorageMetrics::global().slowQuery(cache->db, sql, values, elapsedNs);
+}
+
+StatementCache::StatementCache(const QSqlDatabase &db, int capacity) : db(db), capacity(capacity) {}
+
+StatementCache::~StatementCache() {
+    qDeleteAll(entries);
+}
+
+StatementCache::Statement StatementCache::statement(const QString &sql) {
+    Entry *entry = entries.value(sql);
+    if (entry && !entry->inUse) {
+        ++hitCount;
+        entry->inUse = true;
+        return Statement(this, sql, &entry->query, &entry->inUse);
+    }
+
+    ++missCount;
+    if (!entry && entries.size() < capacity) {
+        entry = new Entry(db);
+        entry->query.setForwardOnly(true);
+        if (entry->query.prepare(sql)) {
+            entries.insert(sql, entry);
+            entry->inUse = true;
+            return Statement(this, sql, &entry->query, &entry->inUse);
+        }
+        delete entry;
+    }
+
+    QSqlQuery *query = new QSqlQuery(db);
+    query->setForwardOnly(true);
+    query->prepare(sql);
+    return Statement(this, sql, query, nullptr);
+}
+
+// Handles still out keep working: only idle statements are dropped.
+void StatementCache::clear() {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it.value()->inUse) {
+            ++it;
+        } else {
+            delete it.value();
+            it = entries.erase(it);
+        }
+    }
+}
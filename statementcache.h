@@ -0,0 +1,74 @@
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+// Prepared statements kept per connection, keyed by their SQL text, so a
+// hot statement is compiled by SQLite once and only rebound on later calls.
+// Owned by the storage classes next to the connection they use; like the
+// connection itself, a cache belongs to one thread.
+//
+// statement() hands out a scoped handle; its destructor finish()es the
+// query so a half-read SELECT doesn't keep its read lock between calls.
+// A handle held longer than the slow-query threshold (binding, exec and
+// reading the rows) is reported to StorageMetrics with its plan, so
+// callers release handles as soon as they have the rows.
+// Values bound on an earlier call stay bound, so callers bind every
+// placeholder each time. A statement already handed out (a nested call
+// with the same SQL) and anything past the capacity is prepared for that
+// one call instead, as is SQL that fails to prepare (exec() then reports
+// the error as usual).
+class StatementCache {
+public:
+    static constexpr int DefaultCapacity = 64;
+
+    class Statement {
+    public:
+        Statement(Statement &&other) noexcept;
+        ~Statement();
+        QSqlQuery &operator*() const { return *query; }
+        QSqlQuery *operator->() const { return query; }
+
+    private:
+        friend class StatementCache;
+        Statement(const StatementCache *cache, const QString &sql, QSqlQuery *query, bool *inUse);
+        Q_DISABLE_COPY(Statement)
+
+        const StatementCache *cache;
+        QString sql;
+        QSqlQuery *query;
+        bool *inUse; // nullptr for a one-off query, which the handle owns
+        QElapsedTimer held;
+    };
+
+    explicit StatementCache(const QSqlDatabase &db, int capacity = DefaultCapacity);
+    ~StatementCache();
+
+    Statement statement(const QString &sql);
+    void clear();
+
+    int size() const { return int(entries.size()); }
+    int hits() const { return hitCount; }
+    int misses() const { return missCount; }
+
+private:
+    Q_DISABLE_COPY(StatementCache)
+
+    struct Entry {
+        QSqlQuery query;
+        bool inUse = false;
+        explicit Entry(const QSqlDatabase &db) : query(db) {}
+    };
+
+    QSqlDatabase db;
+    int capacity;
+    QHash<QString, Entry *> entries;
+    int hitCount = 0;
+    int missCount = 0;
+};
+
+#endif // STATEMENTCACHE_H
@@ -0,0 +1,148 @@
+#include "storagemetrics.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+
+void LatencyHistogram::add(qint64 elapsedNs) {
+    const quint64 us = quint64(qMax<qint64>(0, elapsedNs)) / 1000;
+    int i = 0;
+    while (i < Buckets - 1 && (us >> i) != 0) ++i;
+    ++counts[i];
+    ++calls;
+    total += elapsedNs;
+    slowest = qMax(slowest, elapsedNs);
+}
+
+qint64 LatencyHistogram::percentileUs(double fraction) const {
+    if (calls == 0) return 0;
+    const qint64 rank = qMax<qint64>(1, qint64(fraction * calls + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < Buckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) return qint64(1) << i;
+    }
+    return qint64(1) << (Buckets - 1);
+}
+
+StorageMetrics &StorageMetrics::global() {
+    static StorageMetrics metrics;
+    return metrics;
+}
+
+void StorageMetrics::record(const QString &operation, qint64 elapsedNs) {
+    QMutexLocker locker(&mutex);
+    operations[operation].add(elapsedNs);
+}
+
+QMap<QString, LatencyHistogram> StorageMetrics::histograms() const {
+    QMutexLocker locker(&mutex);
+    QMap<QString, LatencyHistogram> sorted;
+    for (auto it = operations.cbegin(); it != operations.cend(); ++it) sorted.insert(it.key(), it.value());
+    return sorted;
+}
+
+QString StorageMetrics::report() const {
+    const QMap<QString, LatencyHistogram> all = histograms();
+    QStringList lines;
+    for (auto it = all.cbegin(); it != all.cend(); ++it) {
+        const LatencyHistogram &h = it.value();
+        lines << QString("%1: %2 calls, p50 <%3 us, p95 <%4 us, p99 <%5 us, max %6 us, mean %7 us")
+                     .arg(it.key()).arg(h.count())
+                     .arg(h.percentileUs(0.50)).arg(h.percentileUs(0.95)).arg(h.percentileUs(0.99))
+                     .arg(h.maxNs() / 1000).arg(h.totalNs() / 1000 / qMax<qint64>(1, h.count()));
+    }
+    return lines.join('\n');
+}
+
+void StorageMetrics::reset() {
+    QMutexLocker locker(&mutex);
+    operations.clear();
+    recent.clear();
+}
+
+bool StorageMetrics::thresholdFromString(const QString &text, int *thresholdMs) {
+    const QString value = text.trimmed().toLower();
+    if (value.isEmpty()) {
+        *thresholdMs = DefaultSlowQueryMs;
+        return true;
+    }
+    if (value == "off") {
+        *thresholdMs = 0;
+        return true;
+    }
+    bool ok = false;
+    const int ms = value.toInt(&ok);
+    if (!ok || ms <= 0) return false;
+    *thresholdMs = ms;
+    return true;
+}
+
+void StorageMetrics::setSlowQueryThreshold(int thresholdMs) {
+    thresholdNs.storeRelaxed(thresholdMs > 0 ? qint64(thresholdMs) * 1000000 : 0);
+}
+
+qint64 StorageMetrics::slowQueryThresholdNs() const {
+    return thresholdNs.loadRelaxed();
+}
+
+bool StorageMetrics::setSlowQueryLog(const QString &path, QString *error) {
+    QMutexLocker locker(&mutex);
+    log.close();
+    if (path.isEmpty()) return true;
+    log.setFileName(path);
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        if (error) *error = log.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Called on the connection's own thread once the statement is finished.
+// The plan is taken with the same values bound, as SQLite may plan
+// differently for them.
+void StorageMetrics::slowQuery(QSqlDatabase db, const QString &sql, const QVariantList &values, qint64 elapsedNs) {
+    QStringList plan;
+    QSqlQuery explain(db);
+    if (!explain.prepare("EXPLAIN QUERY PLAN " + sql)) {
+        plan << "(no plan: " + explain.lastError().text() + ")";
+    } else {
+        for (int i = 0; i < values.size(); ++i) explain.bindValue(i, values[i]);
+        if (!explain.exec()) {
+            plan << "(no plan: " + explain.lastError().text() + ")";
+        }
+        while (explain.next()) plan << explain.value(3).toString();
+    }
+
+    QStringList bound;
+    for (const QVariant &value : values) {
+        bound << (value.isNull() ? QString("NULL") : value.toString().left(64));
+    }
+    const QString entry = QString("%1 %2 ms on %3\n  %4\n  values: %5\n  plan: %6\n")
+                              .arg(QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs))
+                              .arg(elapsedNs / 1000000.0, 0, 'f', 1)
+                              .arg(db.connectionName(), sql, bound.join(", "), plan.join("; "));
+    qWarning().noquote() << "Slow query:" << entry.trimmed();
+
+    QMutexLocker locker(&mutex);
+    recent.append(entry);
+    if (recent.size() > RecentSlowQueries) recent.removeFirst();
+    if (log.isOpen()) {
+        log.write(entry.toUtf8());
+        log.flush();
+    }
+}
+
+QStringList StorageMetrics::recentSlowQueries() const {
+    QMutexLocker locker(&mutex);
+    return recent;
+}
+
+void StorageMetrics::writeReport() {
+    const QString text = report();
+    QMutexLocker locker(&mutex);
+    if (!log.isOpen() || text.isEmpty()) return;
+    log.write(QString("%1 storage latency since start\n%2\n")
+                  .arg(QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs), text).toUtf8());
+    log.flush();
+}
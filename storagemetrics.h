@@ -0,0 +1,84 @@
+#ifndef STORAGEMETRICS_H
+#define STORAGEMETRICS_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVariantList>
+
+// Latencies of one kind of storage call in power-of-two buckets: bucket 0
+// counts calls under 1 us, bucket i those in [2^(i-1), 2^i) us.
+class LatencyHistogram {
+public:
+    static constexpr int Buckets = 32;
+
+    void add(qint64 elapsedNs);
+    qint64 count() const { return calls; }
+    qint64 totalNs() const { return total; }
+    qint64 maxNs() const { return slowest; }
+    qint64 bucket(int i) const { return counts[i]; }
+    qint64 percentileUs(double fraction) const; // Upper bound of the bucket holding it
+
+private:
+    qint64 counts[Buckets] = {};
+    qint64 calls = 0;
+    qint64 total = 0;
+    qint64 slowest = 0;
+};
+
+// Storage timings for the whole process. The store wrappers (see
+// timedstores.h) and the writer thread record every call by operation
+// name; statements taken from a StatementCache that run longer than the
+// threshold go to the slow-query log with their bound values and
+// EXPLAIN QUERY PLAN, so a slowdown can be traced to a query and an index.
+// Safe to use from any thread.
+class StorageMetrics {
+public:
+    static constexpr int DefaultSlowQueryMs = 50;
+    static constexpr int RecentSlowQueries = 100; // Kept in memory
+
+    // Times the enclosing scope with a monotonic clock
+    class Timer {
+    public:
+        explicit Timer(const char *operation) : operation(operation) { timer.start(); }
+        ~Timer() { StorageMetrics::global().record(QLatin1String(operation), timer.nsecsElapsed()); }
+
+    private:
+        Q_DISABLE_COPY(Timer)
+        const char *operation;
+        QElapsedTimer timer;
+    };
+
+    static StorageMetrics &global();
+
+    void record(const QString &operation, qint64 elapsedNs);
+    QMap<QString, LatencyHistogram> histograms() const;
+    QString report() const; // One line per operation: calls, p50/p95/p99, max
+    void reset();
+
+    // "off" or milliseconds; TICTACTOE_SLOW_QUERY_MS, DefaultSlowQueryMs when unset
+    static bool thresholdFromString(const QString &text, int *thresholdMs);
+    void setSlowQueryThreshold(int thresholdMs); // 0 turns the log off
+    qint64 slowQueryThresholdNs() const;
+    bool setSlowQueryLog(const QString &path, QString *error = nullptr); // Appended to; empty for memory and qWarning only
+    void slowQuery(QSqlDatabase db, const QString &sql, const QVariantList &values, qint64 elapsedNs);
+    QStringList recentSlowQueries() const;
+    void writeReport(); // Appends report() to the slow-query log, if there is one
+
+private:
+    StorageMetrics() = default;
+    Q_DISABLE_COPY(StorageMetrics)
+
+    mutable QMutex mutex;
+    QHash<QString, LatencyHistogram> operations;
+    QAtomicInteger<qint64> thresholdNs = qint64(DefaultSlowQueryMs) * 1000000;
+    QFile log;
+    QStringList recent;
+};
+
+#endif // STORAGEMETRICS_H
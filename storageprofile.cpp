@@ -0,0 +1,64 @@
+#include "storageprofile.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+QStringList StorageProfile::names() {
+    return {"default", "durable", "balanced", "fast"};
+}
+
+// default:  SQLite's own settings (rollback journal, full sync, ~2 MB cache)
+// durable:  WAL + full sync; readers never block the writer
+// balanced: WAL + normal sync (fsync only at checkpoints), mmap and a bigger cache
+// fast:     no fsync at all; for benchmarks and throwaway self-play databases
+StorageProfile StorageProfile::byName(const QString &name) {
+    StorageProfile profile;
+    const QString key = name.trimmed().toLower();
+    if (key == "durable") {
+        profile.name = key;
+        profile.journalMode = "WAL";
+        profile.synchronous = "FULL";
+        profile.cacheSize = -8000;
+        profile.tempStore = "MEMORY";
+        profile.busyTimeoutMs = 5000;
+    } else if (key == "balanced") {
+        profile.name = key;
+        profile.journalMode = "WAL";
+        profile.synchronous = "NORMAL";
+        profile.mmapSize = 64LL * 1024 * 1024;
+        profile.cacheSize = -16000;
+        profile.tempStore = "MEMORY";
+        profile.busyTimeoutMs = 5000;
+    } else if (key == "fast") {
+        profile.name = key;
+        profile.journalMode = "WAL";
+        profile.synchronous = "OFF";
+        profile.mmapSize = 256LL * 1024 * 1024;
+        profile.cacheSize = -64000;
+        profile.tempStore = "MEMORY";
+        profile.busyTimeoutMs = 5000;
+    }
+    return profile;
+}
+
+bool StorageProfile::apply(QSqlDatabase &db, QString *error) const {
+    // busy_timeout goes first so the journal_mode switch can wait for other connections
+    const QStringList pragmas = {
+        QString("PRAGMA busy_timeout = %1").arg(busyTimeoutMs),
+        QString("PRAGMA journal_mode = %1").arg(journalMode),
+        QString("PRAGMA synchronous = %1").arg(synchronous),
+        QString("PRAGMA mmap_size = %1").arg(mmapSize),
+        QString("PRAGMA cache_size = %1").arg(cacheSize),
+        QString("PRAGMA temp_store = %1").arg(tempStore)
+    };
+
+    QSqlQuery query(db);
+    for (const QString &pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            if (error) *error = pragma + ": " + query.lastError().text();
+            qWarning() << "StorageProfile" << name << "failed:" << pragma << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
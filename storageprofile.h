@@ -0,0 +1,26 @@
+#ifndef STORAGEPROFILE_H
+#define STORAGEPROFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QSqlDatabase>
+
+// Connection-level SQLite tuning applied right after a connection opens.
+// journal_mode is persistent in the database file; everything else is per
+// connection, so every connection (GUI, writer thread, ...) applies it.
+struct StorageProfile {
+    QString name = "default";
+    QString journalMode = "DELETE"; // DELETE, TRUNCATE, WAL, ...
+    QString synchronous = "FULL";   // OFF, NORMAL, FULL
+    qint64 mmapSize = 0;            // Bytes, 0 disables memory-mapped I/O
+    int cacheSize = -2000;          // Pages if positive, KiB if negative (SQLite convention)
+    QString tempStore = "DEFAULT";  // DEFAULT, FILE, MEMORY
+    int busyTimeoutMs = 0;
+
+    static StorageProfile byName(const QString &name);
+    static QStringList names();
+
+    bool apply(QSqlDatabase &db, QString *error = nullptr) const;
+};
+
+#endif // STORAGEPROFILE_H
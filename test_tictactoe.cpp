@@ -1,8 +1,18 @@
 #include <QtTest>
 #include "tictactoe.h"
+#include "matchimport.h"
+#include "statementcache.h"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlDriver>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtConcurrent/QtConcurrentRun>
+#include <set>
 
 class TestTicTacToe : public QObject
 {
@@ -38,6 +48,18 @@ private slots:
     //Test Database
     void testUserRegistrationInDatabase();
     void testGameSaveToDatabase();
+    void testMoveCodec_RoundTrip();
+    void testGameBodies_DedupUnderSymmetry();
+    void testSchemaMigrations_LegacyUpgrade();
+    void testWriteBehindQueue();
+    void testSeriesBatchingAndTailRecovery();
+    void testDbBackup_SnapshotRetentionAndRestore();
+    void testStorageProfile_WalReaderDuringWrite();
+    void testPerformance_StorageProfiles();
+    void testPerformance_MatchStores();
+    void testMemoryStores_AccountLifecycle();
+    void testPerformance_GameFlowStorage();
+    void testUserStats_IncrementalAndRebuild();
 
     // Test Login settings
     void testGuestLogin();
@@ -52,13 +74,33 @@ private slots:
     // Ai resposnse
     void testPerformance_HardAiMove() ;
 
+    // Perft (game-tree oracle)
+    void testPerft_ReferenceCounts();
+    void testPerft_SymmetricStarter();
+    void testPerformance_Perft();
+
     // Integration tests
     void testIntegration_ButtonClick();
     void testIntegration_GameSettings();
     void testIntegration_RegistrationAndLoginFlow();
     void testMatchHistoryPopulation();
+    void testHistoryQueryPlans_UseIndexes();
+    void testMatchHistoryModel_KeysetPaging();
+    void testMatchLogStore_IndexesAndCompaction();
+    void testMatchExport_JsonlAndColumnar();
+    void testLeaderboard_RankAndNeighbourhood();
+    void testOpeningTrie_SymmetryAndSnapshot();
+    void testGameJournal_ResumeInterruptedSeries();
+    void testMatchImport_ValidationAndResume();
+    void testMatchArchive_RetentionAndReplay();
+    void testMatchHistory_DateRangeFilter();
+    void testHistorySearch_FacetsAndFullText();
+    void testStatementCache_ReuseAndSavings();
+    void testConnectionManager_ConcurrentReadsAndWrites();
+    void testStorageMetrics_HistogramsAndSlowQueryLog();
     void testGameSettingsIntegration();
 private:
+    QSqlDatabase openFileDatabase(const QString &connectionName, const QString &path);
     TicTacToe *game; // We will use a pointer to the game object
 };
 
@@ -72,10 +114,14 @@ void TestTicTacToe::initTestCase()
     QSqlDatabase testDb = QSqlDatabase::addDatabase("QSQLITE", "test_connection");
     testDb.setDatabaseName(":memory:");
     QVERIFY(testDb.open());
+    // Configured as ConnectionManager would; account deletion relies on ON DELETE CASCADE
+    QVERIFY(QSqlQuery(testDb).exec("PRAGMA foreign_keys = ON"));
     game = new TicTacToe();
     game->isTestRun = true;
     game->db = testDb;
     game->createTablesIfNeeded();
+    game->openStores();
+    game->openGameJournal(); // Disabled for :memory:
     qDebug() << "Test Database and Game object created.";
 }
 
@@ -200,13 +246,752 @@ void TestTicTacToe::testGameSaveToDatabase()
     game->player2Name = "PlayerTwo";
     game->moveHistory = {0, 3, 1, 4, 2}; // A sample move history
     game->gameStartingPlayer = 'X'; // Set a starting player
-    game->saveIndividualGame("PlayerOne", "Win");
+    game->saveIndividualGameWithNumber("PlayerOne", "Win", 1);
     QSqlQuery query(game->db);
-    query.exec("SELECT winner, result, moves FROM matches WHERE player1 = 'PlayerOne'");
+    query.exec(QString("SELECT m.winner, m.result, %1 FROM matches m %2 WHERE m.player1 = 'PlayerOne'")
+                   .arg(GameBody::MovesColumns, GameBody::BodyJoin));
     QVERIFY(query.next()); // Verify we found the saved match
     QCOMPARE(query.value(0).toString(), "PlayerOne");
     QCOMPARE(query.value(1).toString(), "Win");
-    QCOMPARE(query.value(2).toString(), "0,3,1,4,2");
+    QCOMPARE(query.value(2).toByteArray().size(), 4); // Body: board byte + 3 bytes of nibbles
+    QByteArray moves = GameBody::movesFromColumns(query.value(2), query.value(3), query.value(4), query.value(5));
+    QCOMPARE(decodeMoves(moves), std::vector<int>({0, 3, 1, 4, 2}));
+}
+
+void TestTicTacToe::testMoveCodec_RoundTrip()
+{
+    // 3x3: nibble per move, odd counts padded
+    for (const std::vector<int> &moves : {std::vector<int>{}, std::vector<int>{4},
+                                         std::vector<int>{0, 8, 2, 6}, std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8}}) {
+        QByteArray blob = encodeMoves(moves);
+        QCOMPARE(blob.size(), 1 + (int(moves.size()) + 1) / 2);
+        QCOMPARE(decodeMoves(blob), moves);
+    }
+
+    // Larger boards: varint cell indices
+    const int bigMoves[] = {0, 127, 128, 399};
+    unsigned char buffer[MoveCodec::maxEncodedSize(4, 20)];
+    int size = MoveCodec::encode(bigMoves, 4, 20, buffer, sizeof(buffer));
+    QCOMPARE(size, 1 + 1 + 1 + 2 + 2);
+    int decoded[4];
+    int side = 0;
+    QCOMPARE(MoveCodec::decode(buffer, size, decoded, 4, &side), 4);
+    QCOMPARE(side, 20);
+    QVERIFY(std::equal(std::begin(bigMoves), std::end(bigMoves), decoded));
+
+    // Malformed input is rejected rather than misread
+    const int offBoard[] = {9};
+    QCOMPARE(MoveCodec::encode(offBoard, 1, 3, buffer, sizeof(buffer)), -1);
+    const unsigned char badPadding[] = {3, 0xF0, 0x21};
+    QCOMPARE(MoveCodec::decode(badPadding, 3, decoded, 4), -1);
+}
+
+void TestTicTacToe::testGameBodies_DedupUnderSymmetry()
+{
+    // The same opening in all 8 orientations, on 3x3 and on a 5x5 board
+    const std::vector<int> classic = {0, 4, 1, 2, 6, 3, 5, 7, 8};
+    const std::vector<int> large = {0, 12, 1, 7, 24, 3};
+    for (const auto &sample : {std::make_pair(classic, 3), std::make_pair(large, 5)}) {
+        const int side = sample.second;
+        GameBody::Canonical first;
+        for (int t = 0; t < 8; ++t) {
+            std::vector<int> image;
+            for (int cell : sample.first) image.push_back(GameBody::transformCell(t, cell, side));
+            const QByteArray blob = encodeMoves(image, side);
+            const GameBody::Canonical canonical = GameBody::canonicalize(blob);
+            if (t == 0) first = canonical;
+            QCOMPARE(canonical.hash, first.hash);
+            QCOMPARE(canonical.body, first.body);
+            QCOMPARE(GameBody::restore(canonical.body, canonical.symmetry), blob);
+        }
+    }
+
+    // 16 saved games, two distinct up to symmetry
+    game->guestMode = false;
+    game->player1Name = "body_x";
+    game->player2Name = "body_o";
+    for (int i = 0; i < 16; ++i) {
+        const int t = i % 8;
+        game->moveHistory.clear();
+        for (int cell : (i < 8 ? classic : std::vector<int>{4, 0, 8, 2, 1, 7, 6, 3, 5})) {
+            game->moveHistory.push_back(GameBody::transformCell(t, cell, 3));
+        }
+        game->saveIndividualGameWithNumber("-", "🤝 Tie", i + 1);
+    }
+    QSqlQuery query(game->db);
+    QVERIFY(query.exec("SELECT COUNT(*), SUM(refcount) FROM game_bodies"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 2);
+    QCOMPARE(query.value(1).toInt(), 16);
+
+    // Every match still replays its own orientation
+    QVERIFY(query.exec(QString("SELECT %1 FROM matches m %2 ORDER BY m.id").arg(GameBody::MovesColumns, GameBody::BodyJoin)));
+    for (int i = 0; i < 16; ++i) {
+        QVERIFY(query.next());
+        const std::vector<int> moves = decodeMoves(
+            GameBody::movesFromColumns(query.value(0), query.value(1), query.value(2), query.value(3)));
+        QCOMPARE(moves.front(), GameBody::transformCell(i % 8, i < 8 ? classic.front() : 4, 3));
+        QCOMPARE(int(moves.size()), 9);
+    }
+
+    // Dropping the last reference drops the body
+    QVERIFY(query.exec("DELETE FROM matches WHERE id IN (SELECT id FROM matches ORDER BY id LIMIT 8)"));
+    QVERIFY(query.exec("SELECT COUNT(*), SUM(refcount) FROM game_bodies"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 1);
+    QCOMPARE(query.value(1).toInt(), 8);
+}
+
+void TestTicTacToe::testSchemaMigrations_LegacyUpgrade()
+{
+    {
+        // A pre-versioning database: no starting_player, no moves_blob, TEXT moves
+        QSqlDatabase legacyDb = QSqlDatabase::addDatabase("QSQLITE", "legacy_test");
+        legacyDb.setDatabaseName(":memory:");
+        QVERIFY(legacyDb.open());
+        QSqlQuery setup(legacyDb);
+        QVERIFY(setup.exec("CREATE TABLE users (id INTEGER PRIMARY KEY AUTOINCREMENT, username TEXT UNIQUE NOT NULL, "
+                           "password_hash TEXT NOT NULL, salt TEXT NOT NULL)"));
+        QVERIFY(setup.exec("INSERT INTO users (username, password_hash, salt) VALUES ('legacy_user', 'h', 's')"));
+        QVERIFY(setup.exec("CREATE TABLE matches (id INTEGER PRIMARY KEY AUTOINCREMENT, player1 TEXT NOT NULL, "
+                           "player2 TEXT NOT NULL, winner TEXT, result TEXT, moves TEXT, timestamp TEXT, "
+                           "series_id TEXT, game_number INTEGER, series_total INTEGER, series_target INTEGER)"));
+        for (int i = 0; i < 1234; ++i) {
+            QVERIFY(setup.exec(QString("INSERT INTO matches (player1, player2, moves, timestamp, "
+                                       "series_id, game_number, series_total, series_target) "
+                                       "VALUES ('legacy_user', 'AI', '4,0,8,2', '2024-01-01T00:%1:%2', "
+                                       "'legacy_series_%3', %4, 3, 2)")
+                                   .arg(i / 60, 2, 10, QChar('0')).arg(i % 60, 2, 10, QChar('0'))
+                                   .arg(i / 3).arg(i % 3 + 1)));
+        }
+        // Moves that don't parse (by a player without an account)
+        QVERIFY(setup.exec("INSERT INTO matches (player1, player2, moves, timestamp, series_id, game_number, "
+                           "series_total, series_target) "
+                           "VALUES ('ghost', 'AI', '4,x,8', '2024-01-01T00:00:00', 'legacy_series_0', 4, 3, 2)"));
+
+        SchemaMigrator migrator(legacyDb);
+        TicTacToe::registerSchemaMigrations(migrator);
+        QCOMPARE(migrator.schemaVersion(), 0);
+        QVERIFY(migrator.migrate());
+        QCOMPARE(migrator.schemaVersion(), migrator.latestVersion());
+        QVERIFY(SchemaMigrator::columnExists(legacyDb, "matches", "starting_player"));
+        QVERIFY(SchemaMigrator::columnExists(legacyDb, "matches", "moves_blob"));
+        QVERIFY(migrator.migrate()); // Re-running is a no-op
+
+        // Online backfill: bounded batches until done. A batch that can't
+        // begin its transaction is retried, not counted as the end.
+        QVERIFY(migrator.backfillsPending());
+        QVERIFY(legacyDb.transaction());
+        QVERIFY(migrator.runBackfillBatch(100));
+        QVERIFY(migrator.backfillsPending());
+        QVERIFY(legacyDb.rollback());
+        int batches = 0;
+        while (migrator.runBackfillBatch(100)) ++batches;
+        QVERIFY(batches > 10);
+        QVERIFY(!migrator.backfillsPending());
+
+        QVERIFY(setup.exec("SELECT COUNT(*) FROM match_players p JOIN users u ON u.id = p.user_id "
+                           "WHERE u.username = 'legacy_user'"));
+        QVERIFY(setup.next());
+        QCOMPARE(setup.value(0).toInt(), 1234);
+        // Series settings moved off the game rows, stored once per series
+        QVERIFY(setup.exec("SELECT COUNT(*), SUM(total) FROM series"));
+        QVERIFY(setup.next());
+        QCOMPARE(setup.value(0).toInt(), (1234 + 2) / 3);
+        QCOMPARE(setup.value(1).toInt(), 3 * ((1234 + 2) / 3));
+        // Linking legacy rows feeds user_stats through the same trigger as new games
+        QVERIFY(setup.exec("SELECT games FROM user_stats"));
+        QVERIFY(setup.next());
+        QCOMPARE(setup.value(0).toInt(), 1234);
+        QVERIFY(setup.exec("SELECT COUNT(*) FROM matches WHERE series_ref IS NULL OR series_id IS NOT NULL"));
+        QVERIFY(setup.next());
+        QCOMPARE(setup.value(0).toInt(), 0);
+        // TEXT -> moves_blob -> one shared game body
+        QVERIFY(setup.exec("SELECT player1, moves FROM matches "
+                           "WHERE moves IS NOT NULL OR moves_blob IS NOT NULL OR body_id IS NULL"));
+        QVERIFY(setup.next());
+        QCOMPARE(setup.value(0).toString(), QString("ghost")); // Kept as text, not turned into cell 0
+        QCOMPARE(setup.value(1).toString(), QString("4,x,8"));
+        QVERIFY(!setup.next());
+        QVERIFY(setup.exec("SELECT COUNT(*), SUM(refcount) FROM game_bodies"));
+        QVERIFY(setup.next());
+        QCOMPARE(setup.value(0).toInt(), 1);
+        QCOMPARE(setup.value(1).toInt(), 1234);
+        QVERIFY(setup.exec(QString("SELECT %1 FROM matches m %2 LIMIT 1").arg(GameBody::MovesColumns, GameBody::BodyJoin)));
+        QVERIFY(setup.next());
+        QByteArray moves = GameBody::movesFromColumns(setup.value(0), setup.value(1), setup.value(2), setup.value(3));
+        QCOMPARE(decodeMoves(moves), std::vector<int>({4, 0, 8, 2}));
+        // Local-time text -> played_at, on the games and their history rows
+        QVERIFY(setup.exec("SELECT COUNT(*), MIN(m.played_at), MAX(m.played_at) FROM matches m "
+                           "JOIN match_players p ON p.match_id = m.id "
+                           "WHERE m.timestamp IS NULL AND p.played_at = m.played_at"));
+        QVERIFY(setup.next());
+        QCOMPARE(setup.value(0).toInt(), 1234);
+        const QDateTime legacyStart(QDate(2024, 1, 1), QTime(0, 0));
+        QCOMPARE(setup.value(1).toLongLong(), legacyStart.toMSecsSinceEpoch());
+        QCOMPARE(setup.value(2).toLongLong(), legacyStart.addSecs(1233).toMSecsSinceEpoch());
+        setup.finish();
+        legacyDb.close();
+    }
+    QSqlDatabase::removeDatabase("legacy_test");
+}
+
+// Opens a file-backed database with the game's schema (the writer thread
+// can't share the in-memory test connection).
+QSqlDatabase TestTicTacToe::openFileDatabase(const QString &connectionName, const QString &path)
+{
+    QSqlDatabase fileDb = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    fileDb.setDatabaseName(path);
+    if (fileDb.open()) {
+        SchemaMigrator migrator(fileDb);
+        TicTacToe::registerSchemaMigrations(migrator);
+        migrator.migrate();
+    }
+    return fileDb;
+}
+
+void TestTicTacToe::testWriteBehindQueue()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("writer_test.db");
+    {
+        QSqlDatabase fileDb = openFileDatabase("writer_test", path);
+        QVERIFY(fileDb.isOpen());
+
+        DbWriter writer(path, 8); // Small capacity exercises back-pressure
+        writer.start();
+        for (int i = 0; i < 100; ++i) {
+            MatchRecord record;
+            record.player1 = "writer_user";
+            record.player2 = "AI";
+            record.winner = "AI";
+            record.result = "Defeat";
+            record.moves = encodeMovesText("0,4,8");
+            record.timestamp = QDateTime::currentDateTime().toString(Qt::ISODate);
+            writer.enqueue(record);
+        }
+        writer.flush();
+
+        QSqlQuery query(fileDb);
+        QVERIFY(query.exec("SELECT COUNT(*) FROM matches WHERE player1 = 'writer_user'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 100);
+        writer.stop();
+        fileDb.close();
+    }
+    QSqlDatabase::removeDatabase("writer_test");
+}
+
+void TestTicTacToe::testSeriesBatchingAndTailRecovery()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("series_test.db");
+    {
+        QSqlDatabase fileDb = openFileDatabase("series_test", path);
+        QVERIFY(fileDb.isOpen());
+
+        // Simulate a crash that left two games in the pending tail
+        QFile tail(path + "-pending");
+        QVERIFY(tail.open(QIODevice::WriteOnly));
+        tail.write("{\"player1\":\"tail_user\",\"player2\":\"AI\",\"moves\":\"0,1,2\",\"timestamp\":\"2024-01-01T10:00:00\"}\n");
+        tail.write("{\"player1\":\"tail_user\",\"player2\":\"AI\",\"moves\":\"4,0,8\",\"timestamp\":\"2024-01-01T10:01:00\"}\n");
+        tail.write("{\"player1\":\"tail_us"); // Torn final line is ignored
+        tail.close();
+
+        DbWriter writer(path);
+        writer.setFlushPolicy(DbWriter::FlushPolicy::PerSeries);
+        writer.start();
+        for (int i = 1; i <= 3; ++i) {
+            MatchRecord record;
+            record.player1 = "series_user";
+            record.player2 = "AI";
+            record.winner = "AI";
+            record.result = "Defeat";
+            record.moves = encodeMovesText("0,4,8");
+            record.timestamp = QDateTime::currentDateTime().toString(Qt::ISODate);
+            record.seriesId = "series_test";
+            record.gameNumber = i;
+            record.seriesTotal = 3;
+            record.seriesTarget = 2;
+            writer.enqueue(record);
+        }
+
+        // Per-series batching holds every row until the series ends
+        QTest::qWait(100);
+        QSqlQuery query(fileDb);
+        QVERIFY(query.exec("SELECT COUNT(*) FROM matches"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 0);
+
+        writer.endSeries();
+        writer.flush();
+        QVERIFY(query.exec("SELECT COUNT(*) FROM matches WHERE player1 = 'series_user'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 3);
+        QVERIFY(query.exec("SELECT COUNT(*) FROM matches WHERE player1 = 'tail_user'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 2);
+        QCOMPARE(QFileInfo(path + "-pending").size(), qint64(0));
+
+        // A failed batch stays in the tail while later games commit and leave it
+        QVERIFY(query.exec("CREATE TRIGGER reject_bad BEFORE INSERT ON matches WHEN NEW.player1 = 'bad_user' "
+                           "BEGIN SELECT RAISE(ABORT, 'rejected'); END"));
+        MatchRecord bad;
+        bad.player1 = "bad_user";
+        bad.player2 = "AI";
+        bad.winner = "AI";
+        bad.result = "Defeat";
+        bad.moves = encodeMovesText("0,4,8");
+        bad.timestamp = "not a date";
+        writer.enqueue(bad);
+        writer.flush();
+        MatchRecord good = bad;
+        good.player1 = "series_user";
+        writer.enqueue(good);
+        writer.flush();
+        writer.stop();
+        QVERIFY(tail.open(QIODevice::ReadOnly));
+        const QList<QByteArray> failedLines = tail.readAll().split('\n');
+        tail.close();
+        QCOMPARE(failedLines.size(), 2); // One line and the trailing newline
+        QVERIFY(failedLines.first().contains("bad_user"));
+        QVERIFY(failedLines.first().contains("\"client_id\":\""));
+
+        // Replayed on next start; a tail that outlived its commit is not duplicated,
+        // even when the timestamp doesn't parse
+        QVERIFY(query.exec("DROP TRIGGER reject_bad"));
+        for (int replay = 0; replay < 2; ++replay) {
+            if (replay > 0) {
+                QVERIFY(tail.open(QIODevice::WriteOnly));
+                tail.write(failedLines.first() + "\n");
+                tail.close();
+            }
+            DbWriter recovered(path);
+            recovered.start();
+            recovered.flush();
+            recovered.stop();
+            QVERIFY(query.exec("SELECT COUNT(*) FROM matches WHERE player1 = 'bad_user'"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 1);
+        }
+        QVERIFY(query.exec("SELECT played_at, timestamp FROM matches WHERE player1 = 'bad_user'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toLongLong(), qint64(0));
+        QCOMPARE(query.value(1).toString(), QString("not a date"));
+        // Every write-behind row carries its own client id, pre-id tails included
+        QVERIFY(query.exec("SELECT COUNT(*), COUNT(DISTINCT client_id) FROM matches"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(1).toInt(), query.value(0).toInt());
+
+        fileDb.close();
+    }
+    QSqlDatabase::removeDatabase("series_test");
+}
+
+void TestTicTacToe::testDbBackup_SnapshotRetentionAndRestore()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("backup_test.db");
+    {
+        QSqlDatabase fileDb = openFileDatabase("backup_test", path);
+        QVERIFY(fileDb.isOpen());
+        QVERIFY(StorageProfile::byName("balanced").apply(fileDb)); // WAL, as in the game
+        QSqlQuery query(fileDb);
+        QVERIFY(query.exec("INSERT INTO users (username, password_hash, salt) VALUES ('backup_user', 'h', 's')"));
+
+        // Snapshots come from the backup thread while this connection stays open
+        DbBackup backup(path);
+        QSignalSpy taken(&backup, &DbBackup::snapshotTaken);
+        backup.setSchedule(0, 2);
+        backup.start();
+        for (int i = 0; i < 3; ++i) {
+            backup.requestSnapshot();
+            QVERIFY(taken.wait(5000));
+        }
+        backup.stop();
+
+        const QStringList kept = DbBackup::snapshots(path);
+        QCOMPARE(kept.size(), 2); // Oldest pruned
+        QCOMPARE(kept.last(), taken.last().first().toString());
+        QVERIFY(DbBackup::verify(kept.last()));
+
+        QVERIFY(query.exec("DELETE FROM users"));
+        fileDb.close();
+    }
+    QSqlDatabase::removeDatabase("backup_test");
+
+    // A damaged snapshot is refused and the database is left in place
+    const QString damaged = dir.filePath("damaged.db");
+    QVERIFY(QFile::copy(DbBackup::snapshots(path).last(), damaged));
+    {
+        QFile file(damaged);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        file.write(QByteArray(100, '\xff')); // Database header
+    }
+    QString error;
+    QVERIFY(!DbBackup::restore(damaged, path, &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!QFileInfo::exists(path + "-replaced"));
+
+    QVERIFY(DbBackup::restore(DbBackup::snapshots(path).last(), path, &error));
+    QVERIFY(QFileInfo::exists(path + "-replaced"));
+    {
+        QSqlDatabase restored = QSqlDatabase::addDatabase("QSQLITE", "backup_restored");
+        restored.setDatabaseName(path);
+        QVERIFY(restored.open());
+        QSqlQuery query(restored);
+        QVERIFY(query.exec("SELECT COUNT(*) FROM users WHERE username = 'backup_user'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 1);
+        restored.close();
+    }
+    QSqlDatabase::removeDatabase("backup_restored");
+}
+
+void TestTicTacToe::testStorageProfile_WalReaderDuringWrite()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("wal_test.db");
+    {
+        QSqlDatabase writerDb = openFileDatabase("wal_writer", path);
+        QVERIFY(writerDb.isOpen());
+        QVERIFY(StorageProfile::byName("balanced").apply(writerDb));
+
+        QSqlQuery mode(writerDb);
+        QVERIFY(mode.exec("PRAGMA journal_mode"));
+        QVERIFY(mode.next());
+        QCOMPARE(mode.value(0).toString().toLower(), QString("wal"));
+
+        QSqlDatabase readerDb = QSqlDatabase::addDatabase("QSQLITE", "wal_reader");
+        readerDb.setDatabaseName(path);
+        QVERIFY(readerDb.open());
+        QVERIFY(StorageProfile::byName("balanced").apply(readerDb));
+
+        // An open write transaction must not block a history read
+        QVERIFY(writerDb.transaction());
+        QSqlQuery insert(writerDb);
+        QVERIFY(insert.exec("INSERT INTO matches (player1, player2) VALUES ('wal_user', 'AI')"));
+        QSqlQuery read(readerDb);
+        QVERIFY(read.exec("SELECT COUNT(*) FROM matches WHERE player1 = 'wal_user'"));
+        QVERIFY(read.next());
+        QCOMPARE(read.value(0).toInt(), 0); // Uncommitted row is invisible, not blocking
+        read.finish();
+        QVERIFY(writerDb.commit());
+
+        readerDb.close();
+        writerDb.close();
+    }
+    QSqlDatabase::removeDatabase("wal_reader");
+    QSqlDatabase::removeDatabase("wal_writer");
+}
+
+void TestTicTacToe::testPerformance_StorageProfiles()
+{
+    const int inserts = 200;
+    const int historyLoads = 50;
+    for (const QString &profileName : StorageProfile::names()) {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString connectionName = "profile_" + profileName;
+        {
+            QSqlDatabase fileDb = openFileDatabase(connectionName, dir.filePath("profile.db"));
+            QVERIFY(fileDb.isOpen());
+            QVERIFY(StorageProfile::byName(profileName).apply(fileDb));
+
+            // Autocommit inserts: one transaction (and sync) per game, as the GUI does
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < inserts; ++i) {
+                MatchRecord record;
+                record.player1 = (i % 2) ? "bench_user" : "AI";
+                record.player2 = (i % 2) ? "AI" : "bench_user";
+                record.winner = "AI";
+                record.result = "Defeat";
+                record.moves = encodeMovesText("0,4,8");
+                record.timestamp = QDateTime::currentDateTime().addSecs(i).toString(Qt::ISODate);
+                QVERIFY(DbWriter::insertRecord(fileDb, record));
+            }
+            qint64 insertUs = timer.nsecsElapsed() / 1000;
+
+            timer.restart();
+            int rows = 0;
+            for (int i = 0; i < historyLoads; ++i) {
+                QSqlQuery query(fileDb);
+                query.prepare("SELECT player1, player2, winner, result, timestamp FROM matches "
+                              "WHERE player1 = :user OR player2 = :user ORDER BY timestamp DESC");
+                query.bindValue(":user", "bench_user");
+                QVERIFY(query.exec());
+                while (query.next()) ++rows;
+            }
+            qint64 historyUs = timer.nsecsElapsed() / 1000;
+            QCOMPARE(rows, inserts * historyLoads);
+
+            qDebug() << "Storage profile" << profileName << ":"
+                     << (insertUs / inserts) << "us/insert,"
+                     << (historyUs / historyLoads) << "us/history load";
+            fileDb.close();
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+void TestTicTacToe::testPerformance_MatchStores()
+{
+    const int users = 20;
+    const int games = users * MatchHistoryModel::PageSize;
+    const int pageLoads = 200;
+    const int replayLoads = 500;
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    {
+        QSqlDatabase fileDb = openFileDatabase("match_store_bench", dir.filePath("bench.db"));
+        QVERIFY(fileDb.isOpen());
+        QSqlQuery query(fileDb);
+        for (int u = 0; u < users; ++u) {
+            QVERIFY(query.exec(QString("INSERT INTO users (username, password_hash, salt) "
+                                       "VALUES ('store_user_%1', 'h', 's')").arg(u)));
+        }
+
+        SqliteMatchStore sqliteStore(fileDb);
+        MatchLogStore logStore(dir.filePath("bench.db-matchlog"));
+        QVERIFY(logStore.open());
+        MemoryMatchStore memoryStore;
+        const QList<MatchStore *> stores = {&sqliteStore, &logStore, &memoryStore};
+        for (MatchStore *store : stores) {
+            // One append per finished game, as the GUI saves them
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < games; ++i) {
+                MatchRecord record;
+                record.player1 = QString("store_user_%1").arg(i % users);
+                record.player2 = "AI";
+                record.winner = "AI";
+                record.result = "Defeat";
+                record.moves = encodeMovesText("0,4,1,2,8,6");
+                record.timestamp = QDateTime::currentDateTime().addSecs(i).toString(Qt::ISODate);
+                record.startingPlayer = "X";
+                record.gameMode = "PvAI";
+                record.difficulty = 3;
+                QVERIFY(store->append(record));
+            }
+            store->flush();
+            const qint64 appendUs = timer.nsecsElapsed() / 1000;
+
+            timer.restart();
+            int rows = 0;
+            for (int i = 0; i < pageLoads; ++i) {
+                QVector<MatchSummary> page;
+                QVERIFY(store->historyPage(QString("store_user_%1").arg(i % users), nullptr,
+                                           MatchHistoryModel::PageSize, &page));
+                rows += page.size();
+            }
+            const qint64 pageUs = timer.nsecsElapsed() / 1000;
+            QCOMPARE(rows, pageLoads * MatchHistoryModel::PageSize);
+
+            timer.restart();
+            QRandomGenerator random(7);
+            for (int i = 0; i < replayLoads; ++i) {
+                MatchRecord loaded;
+                QVERIFY(store->loadMatch(store->lastMatchId() - random.bounded(games), &loaded));
+                QCOMPARE(loaded.player2, QString("AI"));
+            }
+            const qint64 replayUs = timer.nsecsElapsed() / 1000;
+
+            qDebug() << "Match store" << store->name() << ":"
+                     << (appendUs / games) << "us/append,"
+                     << (pageUs / pageLoads) << "us/history page,"
+                     << (replayUs / replayLoads) << "us/replay load";
+        }
+        query.finish();
+        fileDb.close();
+    }
+    QSqlDatabase::removeDatabase("match_store_bench");
+}
+
+void TestTicTacToe::testMemoryStores_AccountLifecycle()
+{
+    MatchStore *savedMatches = game->matchStore;
+    UserStore *savedUsers = game->userStore;
+    MemoryMatchStore memoryMatches;
+    MemoryUserStore memoryUsers;
+    game->matchStore = &memoryMatches;
+    game->userStore = &memoryUsers;
+    game->leaderboard.clear();
+
+    game->usernameEdit->setText("memory_user");
+    game->passwordEdit->setText("password123");
+    game->registerAccount();
+    UserAccount account;
+    bool found = false;
+    QVERIFY(memoryUsers.findUser("memory_user", &account, &found));
+    QVERIFY(found);
+
+    game->usernameEdit->setText("memory_user");
+    game->passwordEdit->setText("password123");
+    game->handleLogin();
+    QCOMPARE(game->loggedInUser, QString("memory_user"));
+
+    game->mode = 2;
+    game->player1Name = "AI";
+    game->player2Name = "memory_user";
+    game->moveHistory = {4, 0, 8, 2, 1, 7, 6, 3, 5};
+    game->saveIndividualGameWithNumber("memory_user", "🏆 Victory", 1);
+    game->saveIndividualGameWithNumber("AI", "Defeat", 2);
+
+    game->loadMatchHistory();
+    QCOMPARE(game->matchHistoryModel->rowCount(), 2);
+    game->loadLeaderboard();
+    const QVector<Leaderboard::Entry> entries = game->leaderboard.around("memory_user", 0);
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries[0].wins, 1);
+    QCOMPARE(entries[0].losses, 1);
+
+    // Nothing reached SQLite
+    QSqlQuery query(game->db);
+    QVERIFY(query.exec("SELECT (SELECT COUNT(*) FROM users), (SELECT COUNT(*) FROM matches)"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 0);
+    QCOMPARE(query.value(1).toInt(), 0);
+
+    game->performAccountDeletion();
+    QVERIFY(memoryUsers.findUser("memory_user", &account, &found));
+    QVERIFY(!found);
+    MatchRecord loaded;
+    QVERIFY(!memoryMatches.loadMatch(1, &loaded));
+
+    game->matchStore = savedMatches;
+    game->userStore = savedUsers;
+    game->leaderboard.clear();
+}
+
+// Cost of saving a finished game (encode, store, stats, leaderboard and
+// opening trie) per backend; the memory stores leave only the game's own work.
+void TestTicTacToe::testPerformance_GameFlowStorage()
+{
+    const int games = 500;
+    MatchStore *savedMatches = game->matchStore;
+    UserStore *savedUsers = game->userStore;
+    MemoryMatchStore memoryMatches;
+    MemoryUserStore memoryUsers;
+
+    game->guestMode = false;
+    game->mode = 2;
+    game->player1Name = "AI";
+    game->player2Name = "flow_user";
+    game->moveHistory = {4, 0, 8, 2, 1, 7, 6, 3, 5};
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            game->matchStore = &memoryMatches;
+            game->userStore = &memoryUsers;
+        }
+        qint64 userId = 0;
+        QVERIFY(game->userStore->addUser("flow_user", "h", "s", &userId));
+        game->leaderboard.clear();
+        QVERIFY(game->leaderboard.load(*game->userStore));
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < games; ++i) {
+            game->saveIndividualGameWithNumber("-", "🤝 Tie", i % 3 + 1);
+        }
+        game->flushPendingWrites();
+        const qint64 saveUs = timer.nsecsElapsed() / 1000;
+
+        QVector<MatchSummary> page;
+        QVERIFY(game->matchStore->historyPage("flow_user", nullptr, 1, &page));
+        QCOMPARE(page.size(), 1);
+        QCOMPARE(game->leaderboard.around("flow_user", 0).value(0).ties, games);
+        qDebug() << "Game flow on" << game->matchStore->name() << "storage:"
+                 << (saveUs / games) << "us/saved game";
+    }
+
+    game->matchStore = savedMatches;
+    game->userStore = savedUsers;
+    game->leaderboard.clear();
+}
+
+void TestTicTacToe::testUserStats_IncrementalAndRebuild()
+{
+    game->guestMode = false;
+    QSqlQuery query(game->db);
+    QVERIFY(query.exec("INSERT INTO users (username, password_hash, salt) VALUES ('stats_user', 'h', 's')"));
+
+    // PvAI: the AI is player 1 (X), the user player 2 (O)
+    game->mode = 2;
+    game->player1Name = "AI";
+    game->player2Name = "stats_user";
+    game->difficulty = 3;
+    game->gameStartingPlayer = 'O';
+    game->saveIndividualGameWithNumber("stats_user", "🏆 Victory", 1);
+    game->saveIndividualGameWithNumber("stats_user", "🏆 Victory", 2);
+    game->difficulty = 1;
+    game->gameStartingPlayer = 'X';
+    game->saveIndividualGameWithNumber("-", "🤝 Tie", 3);
+    game->saveIndividualGameWithNumber("AI", "🏳️ Surrender", 4);
+
+    const QString statsQuery =
+        "SELECT games, wins, losses, ties, surrenders, current_streak, best_streak, "
+        "hard_wins, easy_ties, easy_losses, first_wins, second_ties, second_losses "
+        "FROM user_stats WHERE user_id = (SELECT id FROM users WHERE username = 'stats_user')";
+    QVERIFY(query.exec(statsQuery));
+    QVERIFY(query.next());
+    QList<int> incremental;
+    for (int column = 0; column < 13; ++column) incremental << query.value(column).toInt();
+    QCOMPARE(incremental, QList<int>({4, 2, 1, 1, 1, -1, 2, 2, 1, 1, 2, 1, 1}));
+
+    // A full rebuild from history reproduces the incrementally maintained row
+    QVERIFY(game->db.transaction());
+    QString error;
+    QVERIFY2(TicTacToe::rebuildUserStats(game->db, &error), qPrintable(error));
+    QVERIFY(game->db.commit());
+    QVERIFY(query.exec(statsQuery));
+    QVERIFY(query.next());
+    QList<int> rebuilt;
+    for (int column = 0; column < 13; ++column) rebuilt << query.value(column).toInt();
+    QCOMPARE(rebuilt, incremental);
+
+    // Rows written before the stats trigger are counted by the batched seeding backfill
+    QVERIFY(query.exec("DELETE FROM user_stats"));
+    QVERIFY(query.exec("CREATE TABLE user_stats_seed AS SELECT MAX(match_id) AS max_match_id FROM match_players"));
+    QVERIFY(query.exec("DELETE FROM schema_backfills WHERE name IN ('user_stats', 'user_streaks')"));
+    // Streaks as left by newer games counted before older ones are recomputed in play order
+    QVERIFY(query.exec("INSERT INTO user_stats (user_id, current_streak, best_streak) "
+                       "SELECT id, 7, 7 FROM users WHERE username = 'stats_user'"));
+    SchemaMigrator migrator(game->db);
+    TicTacToe::registerSchemaMigrations(migrator);
+    while (migrator.runBackfillBatch(1)) {}
+    QVERIFY(!migrator.backfillsPending());
+    QVERIFY(query.exec(statsQuery));
+    QVERIFY(query.next());
+    QList<int> seeded;
+    for (int column = 0; column < 13; ++column) seeded << query.value(column).toInt();
+    QCOMPARE(seeded, incremental);
+    QVERIFY(query.exec("SELECT 1 FROM sqlite_master WHERE name = 'user_stats_seed'"));
+    QVERIFY(!query.next());
+
+    // With matches in the log store, the user store applies games to user_stats itself
+    SqliteUserStore logUsers(game->db, true);
+    MatchRecord logged;
+    logged.player1 = "AI";
+    logged.player2 = "stats_user";
+    logged.winner = "stats_user";
+    logged.result = "🏆 Victory";
+    logged.difficulty = 3;
+    logged.startingPlayer = "O";
+    logUsers.recordGame(logged);
+    QVERIFY(query.exec(statsQuery));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 5);
+    QCOMPARE(query.value(1).toInt(), 3);
+    QCOMPARE(query.value(5).toInt(), 1); // Streak restarts after the surrender
+    QCOMPARE(query.value(7).toInt(), 3);
+    QCOMPARE(query.value(10).toInt(), 3);
+
+    game->mode = 1;
 }
 
 void TestTicTacToe::testGuestLogin()
@@ -228,6 +1013,20 @@ void TestTicTacToe::testSuccessfulRegistration()
     QVERIFY(query.exec());
     QVERIFY(query.next());
     QCOMPARE(query.value(0).toInt(), 1); // We expect to find exactly 1 user with that name.
+
+    // Names are limited in UTF-8 bytes, the width of the match log's name fields
+    const QString longest = QString(19, QChar(0x00E9)) + "x";
+    for (const QString &name : {longest, longest + "x"}) {
+        game->usernameEdit->setText(name);
+        game->passwordEdit->setText("password123");
+        game->registerAccount();
+    }
+    query.prepare("SELECT username FROM users WHERE username LIKE :prefix");
+    query.bindValue(":prefix", QString(19, QChar(0x00E9)) + "%");
+    QVERIFY(query.exec());
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toString(), longest);
+    QVERIFY(!query.next());
 }
 
 void TestTicTacToe::testFailedRegistration_WhenUserExists()
@@ -313,6 +1112,42 @@ void TestTicTacToe::testPerformance_HardAiMove()
     QVERIFY(elapsedMicroseconds < 2000000);
 }
 
+void TestTicTacToe::testPerft_ReferenceCounts()
+{
+    // Leaves per depth from an empty board with X to move (terminal positions stop early)
+    const quint64 expectedLeaves[] = { 9, 72, 504, 3024, 15120, 56160, 154944, 255168, 255168 };
+    for (int depth = 1; depth <= 9; ++depth) {
+        QCOMPARE(TicTacToe::perft(depth).leaves, expectedLeaves[depth - 1]);
+    }
+    TicTacToe::PerftResult full = TicTacToe::perft(9);
+    QCOMPARE(full.leaves, quint64(255168));
+    QCOMPARE(full.xWins, quint64(131184));
+    QCOMPARE(full.oWins, quint64(77904));
+    QCOMPARE(full.draws, quint64(46080));
+    QCOMPARE(full.xWins + full.oWins + full.draws, full.leaves);
+}
+
+void TestTicTacToe::testPerft_SymmetricStarter()
+{
+    TicTacToe::PerftResult xFirst = TicTacToe::perft(9, 'X');
+    TicTacToe::PerftResult oFirst = TicTacToe::perft(9, 'O');
+    QCOMPARE(oFirst.leaves, xFirst.leaves);
+    QCOMPARE(oFirst.oWins, xFirst.xWins);
+    QCOMPARE(oFirst.xWins, xFirst.oWins);
+    QCOMPARE(oFirst.draws, xFirst.draws);
+}
+
+void TestTicTacToe::testPerformance_Perft()
+{
+    QElapsedTimer timer;
+    timer.start();
+    TicTacToe::PerftResult result = TicTacToe::perft(9);
+    qint64 elapsedMicroseconds = qMax<qint64>(1, timer.nsecsElapsed() / 1000);
+    qDebug() << "Perft(9) benchmark:" << result.leaves << "leaves in" << elapsedMicroseconds << "us ("
+             << (result.leaves * 1000000 / elapsedMicroseconds) << "leaves/s).";
+    QVERIFY(elapsedMicroseconds < 5000000);
+}
+
 void TestTicTacToe::testIntegration_ButtonClick()
 {
     game->setPlayerVsPlayer();
@@ -361,19 +1196,414 @@ void TestTicTacToe::testIntegration_RegistrationAndLoginFlow()
 
 void TestTicTacToe::testMatchHistoryPopulation()
 {
+    QSqlQuery user(game->db);
+    QVERIFY(user.exec("INSERT INTO users (username, password_hash, salt) VALUES ('history_user', 'h', 's')"));
     game->loggedInUser = "history_user";
     game->player1Name = "history_user";
     game->player2Name = "AI";
-    game->saveIndividualGame("history_user", "Win");
-    game->saveIndividualGame("AI", "Defeat");
-    game->saveIndividualGame("history_user", "Win");
+    game->saveIndividualGameWithNumber("history_user", "Win", 1);
+    game->saveIndividualGameWithNumber("AI", "Defeat", 2);
+    game->saveIndividualGameWithNumber("history_user", "Win", 3);
     QPushButton* historyButton = game->findChild<QPushButton*>("View Match History");
     QVERIFY(historyButton != nullptr); // Make sure we found the button.
     QTest::mouseClick(historyButton, Qt::LeftButton);
     QCOMPARE(game->stackedWidget->currentIndex(), 6);
-    QTableWidget* table = game->findChild<QTableWidget*>("matchHistoryTable");
+    QTableView* table = game->findChild<QTableView*>("matchHistoryTable");
     QVERIFY(table != nullptr); // Make sure we found the table.
-    QCOMPARE(table->rowCount(), 3);
+    QCOMPARE(table->model()->rowCount(), 3);
+}
+
+void TestTicTacToe::testHistoryQueryPlans_UseIndexes()
+{
+    game->guestMode = false;
+    game->loggedInUser = "plan_user";
+    QSqlQuery user(game->db);
+    QVERIFY(user.exec("INSERT INTO users (username, password_hash, salt) VALUES ('plan_user', 'h', 's')"));
+    for (int i = 0; i < 50; ++i) {
+        game->player1Name = (i % 2) ? "plan_user" : "AI";
+        game->player2Name = (i % 2) ? "AI" : "plan_user";
+        game->saveIndividualGameWithNumber("AI", "Defeat", 1);
+    }
+
+    // Every history access path must be an index search: no full scan, no sort
+    const QStringList statements = {
+        SqliteMatchStore::FIRST_PAGE_QUERY,
+        SqliteMatchStore::NEXT_PAGE_QUERY,
+        SqliteUserStore::DELETE_USER_QUERY
+    };
+    for (const QString &statement : statements) {
+        QSqlQuery plan(game->db);
+        plan.prepare("EXPLAIN QUERY PLAN " + statement);
+        if (statement.contains(":username")) {
+            plan.bindValue(":username", "plan_user");
+        } else {
+            plan.bindValue(":user", "plan_user");
+            plan.bindValue(":limit", MatchHistoryModel::PageSize);
+            plan.bindValue(":from", QDateTime::currentDateTime().addDays(-7).toMSecsSinceEpoch());
+            if (statement.contains(":played_at")) {
+                plan.bindValue(":played_at", QDateTime::currentMSecsSinceEpoch());
+                plan.bindValue(":id", 1000);
+            } else {
+                plan.bindValue(":to", QDateTime::currentMSecsSinceEpoch());
+            }
+        }
+        QVERIFY2(plan.exec(), qPrintable(plan.lastError().text()));
+        QStringList details;
+        while (plan.next()) {
+            details << plan.value(3).toString();
+        }
+        QVERIFY(!details.isEmpty());
+        for (const QString &detail : details) {
+            QVERIFY2(!detail.startsWith("SCAN"), qPrintable(statement + " -> " + detail));
+            QVERIFY2(!detail.contains("TEMP B-TREE"), qPrintable(statement + " -> " + detail));
+        }
+    }
+
+    QSqlQuery count(game->db);
+    QVERIFY(count.exec("SELECT COUNT(*) FROM match_players"));
+    QVERIFY(count.next());
+    QCOMPARE(count.value(0).toInt(), 50); // AI has no account, so one row per game
+
+    // A legacy row the backfill has not linked yet goes by name
+    QVERIFY(count.exec("INSERT INTO matches (player1, player2, winner, result, played_at) "
+                       "VALUES ('plan_user', 'AI', 'AI', 'Defeat', 0)"));
+
+    // Cascade: users -> matches -> match_players
+    game->performAccountDeletion();
+    QVERIFY(count.exec("SELECT (SELECT COUNT(*) FROM users), (SELECT COUNT(*) FROM matches), "
+                       "(SELECT COUNT(*) FROM match_players)"));
+    QVERIFY(count.next());
+    QCOMPARE(count.value(0).toInt(), 0);
+    QCOMPARE(count.value(1).toInt(), 0);
+    QCOMPARE(count.value(2).toInt(), 0);
+}
+
+void TestTicTacToe::testMatchHistoryModel_KeysetPaging()
+{
+    const int games = MatchHistoryModel::PageSize * 2 + 17;
+    QSqlQuery insert(game->db);
+    QVERIFY(insert.exec("INSERT INTO users (username, password_hash, salt) VALUES ('page_user', 'h', 's')"));
+    insert.prepare("INSERT INTO matches (player1, player2, player1_id, winner, result, moves, timestamp) "
+                   "VALUES ('page_user', 'AI', (SELECT id FROM users WHERE username = 'page_user'), "
+                   "'AI', 'Defeat', '0,4,8', :timestamp)");
+    QDateTime start = QDateTime::currentDateTime();
+    for (int i = 0; i < games; ++i) {
+        // Pairs of games share a timestamp so the match id tie-break is exercised
+        insert.bindValue(":timestamp", start.addSecs(i / 2).toString(Qt::ISODate));
+        QVERIFY(insert.exec());
+    }
+
+    MatchHistoryModel model(MatchHistoryModel::Layout::Recorded);
+    model.setSource(game->matchStore, "page_user");
+    QCOMPARE(model.rowCount(), MatchHistoryModel::PageSize); // Only the first page is loaded
+    while (model.canFetchMore(QModelIndex())) {
+        model.fetchMore(QModelIndex());
+    }
+    QCOMPARE(model.rowCount(), games);
+
+    // Newest first, no duplicates or gaps across page boundaries
+    QSet<qint64> ids;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        ids.insert(model.matchId(row));
+        if (row > 0) {
+            QString previous = model.data(model.index(row - 1, 5)).toString();
+            QString current = model.data(model.index(row, 5)).toString();
+            QVERIFY(previous >= current);
+            if (previous == current) QVERIFY(model.matchId(row - 1) > model.matchId(row));
+        }
+    }
+    QCOMPARE(ids.size(), games);
+
+    // A timestamp that never parsed has played_at 0 and is shown as stored, not as 1970
+    insert.bindValue(":timestamp", "sometime in 2019");
+    QVERIFY(insert.exec());
+    model.setSource(game->matchStore, "page_user");
+    while (model.canFetchMore(QModelIndex())) model.fetchMore(QModelIndex());
+    QCOMPARE(model.data(model.index(model.rowCount() - 1, 5)).toString(), QString("sometime in 2019"));
+}
+
+void TestTicTacToe::testMatchLogStore_IndexesAndCompaction()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("matches.db-matchlog");
+    // Match id i + 1; odd games are against rival_a, even ones against rival_b
+    auto makeRecord = [](int i) {
+        MatchRecord record;
+        record.player1 = "log_user";
+        record.player2 = (i % 2) ? "rival_a" : "rival_b";
+        record.winner = (i % 3) ? record.player1 : record.player2;
+        record.result = "🏆 Victory";
+        record.moves = encodeMoves(std::vector<int>{4, 0, 8, 2, 1, 7, 6, 3, 5});
+        record.timestamp = QDateTime(QDate(2026, 1, 1), QTime(0, 0)).addSecs(i).toString(Qt::ISODate);
+        record.startingPlayer = "X";
+        record.gameMode = "PvP";
+        record.seriesId = "20260101_000000_1234";
+        record.gameNumber = i % 5 + 1;
+        record.seriesTotal = 5;
+        record.seriesTarget = 3;
+        return record;
+    };
+    const int games = MatchHistoryModel::PageSize + 50;
+    {
+        MatchLogStore store(path);
+        QVERIFY(store.open());
+        for (int i = 0; i < games; ++i) QVERIFY(store.append(makeRecord(i)));
+        MatchRecord tooLong = makeRecord(0);
+        tooLong.player2 = QString(64, 'x');
+        QString error;
+        QVERIFY(!store.append(tooLong, &error));
+        QVERIFY(error.contains("too long"));
+        QCOMPARE(store.lastMatchId(), qint64(games));
+    }
+
+    // Reopened: newest first across the page boundary, replays round-trip every field
+    MatchLogStore store(path);
+    QVERIFY(store.open());
+    MatchHistoryModel model(MatchHistoryModel::Layout::Recorded);
+    model.setSource(&store, "log_user");
+    QCOMPARE(model.rowCount(), MatchHistoryModel::PageSize);
+    while (model.canFetchMore(QModelIndex())) model.fetchMore(QModelIndex());
+    QCOMPARE(model.rowCount(), games);
+    for (int row = 1; row < model.rowCount(); ++row) QVERIFY(model.matchId(row - 1) > model.matchId(row));
+
+    MatchRecord loaded;
+    QVERIFY(store.loadMatch(7, &loaded));
+    const MatchRecord expected = makeRecord(6);
+    QCOMPARE(loaded.player2, expected.player2);
+    QCOMPARE(loaded.winner, expected.winner);
+    QCOMPARE(loaded.result, expected.result);
+    QCOMPARE(loaded.moves, expected.moves);
+    QCOMPARE(loaded.timestamp, expected.timestamp);
+    QCOMPARE(loaded.startingPlayer, expected.startingPlayer);
+    QCOMPARE(loaded.seriesId, expected.seriesId);
+    QCOMPARE(loaded.gameNumber, expected.gameNumber);
+    QCOMPARE(loaded.seriesTarget, expected.seriesTarget);
+
+    // Tombstoning half the log triggers compaction; surviving ids are kept
+    QVERIFY(store.removeUserMatches("rival_a"));
+    QCOMPARE(store.recordCount(), qint64(games / 2));
+    QCOMPARE(store.tombstoneCount(), qint64(0));
+    QVERIFY(!store.loadMatch(2, &loaded));
+    QVERIFY(store.loadMatch(7, &loaded));
+    QVector<MatchSummary> page;
+    QVERIFY(store.historyPage("rival_a", nullptr, MatchHistoryModel::PageSize, &page));
+    QVERIFY(page.isEmpty());
+    int scanned = 0;
+    QVERIFY(store.scan(100, [&scanned](qint64 id, const MatchRecord &record) {
+        QVERIFY(id > 100);
+        QCOMPARE(record.player2, QString("rival_b"));
+        ++scanned;
+    }));
+    QCOMPARE(scanned, 25); // Odd ids 101..149
+
+    // A torn append is dropped on open and the indexes are rebuilt
+    {
+        QFile log(path);
+        QVERIFY(log.open(QIODevice::Append));
+        log.write(QByteArray(MatchLogStore::RecordSize / 2, 'x'));
+    }
+    MatchLogStore reopened(path);
+    QVERIFY(reopened.open());
+    QCOMPARE(reopened.recordCount(), qint64(games / 2));
+    QCOMPARE(reopened.lastMatchId(), qint64(games)); // The deleted last id isn't reused
+    model.setSource(&reopened, "log_user");
+    while (model.canFetchMore(QModelIndex())) model.fetchMore(QModelIndex());
+    QCOMPARE(model.rowCount(), games / 2);
+}
+
+void TestTicTacToe::testMatchExport_JsonlAndColumnar()
+{
+    // More than one row group, two players, a handful of distinct games
+    MemoryMatchStore store;
+    const int total = MatchExport::RowGroupRows + 10;
+    for (int i = 0; i < total; ++i) {
+        MatchRecord record;
+        record.player1 = (i % 3 == 0) ? "export_a" : "export_b";
+        record.player2 = "AI";
+        record.winner = (i % 2 == 0) ? "AI" : record.player1;
+        record.result = (i % 2 == 0) ? "Defeat" : "Win";
+        record.moves = encodeMoves(std::vector<int>{i % 9, (i + 4) % 9, (i + 8) % 9});
+        record.timestamp = QDateTime(QDate(2024, 1, 1), QTime(0, 0)).addSecs(i).toString(Qt::ISODate);
+        record.startingPlayer = "X";
+        record.gameMode = "PvAI";
+        record.difficulty = 1 + i % 3;
+        record.seriesId = QString("export_series_%1").arg(i / 3);
+        record.gameNumber = 1 + i % 3;
+        record.seriesTotal = 3;
+        record.seriesTarget = 2;
+        QVERIFY(store.append(record));
+    }
+
+    QBuffer columnar;
+    QVERIFY(columnar.open(QIODevice::WriteOnly));
+    qint64 rows = 0;
+    QVERIFY(MatchExport::write(store, QString(), MatchExport::Format::Columnar, &columnar, &rows));
+    QCOMPARE(rows, qint64(total));
+    columnar.close();
+
+    QVERIFY(columnar.open(QIODevice::ReadOnly));
+    qint64 expectedId = 1;
+    bool allMatch = true;
+    QVERIFY(MatchExport::readColumnar(&columnar, [&](qint64 id, const MatchRecord &record) {
+        MatchRecord original;
+        store.loadMatch(id, &original);
+        allMatch = allMatch && id == expectedId++ && record.player1 == original.player1
+                   && record.winner == original.winner && record.moves == original.moves
+                   && record.timestamp == original.timestamp && record.difficulty == original.difficulty
+                   && record.seriesId == original.seriesId && record.gameNumber == original.gameNumber;
+    }));
+    QVERIFY(allMatch);
+    QCOMPARE(expectedId, qint64(total + 1));
+    columnar.close();
+
+    // One player's matches as JSONL, keyed like the write-behind journal
+    QBuffer jsonl;
+    QVERIFY(jsonl.open(QIODevice::WriteOnly));
+    QVERIFY(MatchExport::write(store, "export_a", MatchExport::Format::Jsonl, &jsonl, &rows));
+    QCOMPARE(rows, qint64((total + 2) / 3));
+    const QList<QByteArray> lines = jsonl.data().split('\n');
+    QCOMPARE(lines.size(), int(rows) + 1); // Trailing newline
+    const QJsonObject first = QJsonDocument::fromJson(lines.first()).object();
+    QCOMPARE(first["id"].toInteger(), qint64(1));
+    QCOMPARE(first["player1"].toString(), QString("export_a"));
+    QCOMPARE(first["moves"].toString(), QString("0,4,8"));
+
+    // Dictionary encoding pays off even with near-unique timestamps
+    qDebug() << "Export of" << total << "matches: columnar" << columnar.size() << "bytes, JSONL (a third of them)"
+             << jsonl.size() << "bytes";
+    QVERIFY(columnar.size() < jsonl.size());
+
+    // A truncated file is reported, not half-read silently
+    QBuffer truncated;
+    truncated.setData(columnar.data().left(columnar.size() / 2));
+    QVERIFY(truncated.open(QIODevice::ReadOnly));
+    QString error;
+    QVERIFY(!MatchExport::readColumnar(&truncated, [](qint64, const MatchRecord &) {}, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestTicTacToe::testLeaderboard_RankAndNeighbourhood()
+{
+    // rank/at agree with a sorted copy through random inserts and erases
+    RankTree<int> tree;
+    std::set<int> reference;
+    QRandomGenerator random(42);
+    for (int i = 0; i < 5000; ++i) {
+        int key = random.bounded(1000);
+        if (random.bounded(3)) QCOMPARE(tree.insert(key), reference.insert(key).second);
+        else QCOMPARE(tree.erase(key), reference.erase(key) > 0);
+    }
+    QCOMPARE(tree.size(), int(reference.size()));
+    int index = 0;
+    for (int key : reference) {
+        QCOMPARE(tree.rank(key), index);
+        QCOMPARE(tree.at(index++), key);
+    }
+
+    // user_i has i wins, so ranks run backwards from the last user
+    QSqlQuery query(game->db);
+    for (int i = 1; i <= 30; ++i) {
+        QVERIFY(query.exec(QString("INSERT INTO users (username, password_hash, salt) VALUES ('rank_user_%1', 'h', 's')").arg(i)));
+        QVERIFY(query.exec(QString("UPDATE user_stats SET wins = %1 WHERE user_id = (SELECT id FROM users "
+                                   "WHERE username = 'rank_user_%1')").arg(i)));
+    }
+    game->leaderboard.clear();
+    game->guestMode = false;
+    game->loggedInUser = "rank_user_5";
+    game->loadLeaderboard();
+    QCOMPARE(game->stackedWidget->currentIndex(), 8);
+    QCOMPARE(game->leaderboard.rankOf("rank_user_30"), 1);
+    QCOMPARE(game->leaderboard.rankOf("rank_user_5"), 26);
+    QCOMPARE(game->leaderboardRankLabel->text(), QString("Your rank: #26 of 30"));
+    QTableWidget *table = game->findChild<QTableWidget *>("leaderboardTable");
+    QVERIFY(table != nullptr);
+    QCOMPARE(table->rowCount(), 10 + 1 + 7); // Top 10, "...", 3 above + user + 3 below
+    QCOMPARE(table->item(11, 0)->text(), QString("#23"));
+
+    // Saving games re-ranks incrementally, matching a fresh load from user_stats
+    game->mode = 1;
+    game->player1Name = "rank_user_5";
+    game->player2Name = "rank_user_29";
+    for (int i = 0; i < 25; ++i) {
+        game->saveIndividualGameWithNumber("rank_user_5", "🥇 Win", i + 1);
+    }
+    QCOMPARE(game->leaderboard.rankOf("rank_user_5"), 1);
+    QCOMPARE(game->leaderboard.top(2).last().username, QString("rank_user_30"));
+    QVector<Leaderboard::Entry> incremental = game->leaderboard.around("rank_user_29", 2);
+    Leaderboard reloaded;
+    QVERIFY(reloaded.load(game->db));
+    QVector<Leaderboard::Entry> fresh = reloaded.around("rank_user_29", 2);
+    QCOMPARE(incremental.size(), fresh.size());
+    for (int i = 0; i < fresh.size(); ++i) {
+        QCOMPARE(incremental[i].username, fresh[i].username);
+        QCOMPARE(incremental[i].rank, fresh[i].rank);
+        QCOMPARE(incremental[i].losses, fresh[i].losses);
+    }
+    game->leaderboard.clear();
+}
+
+void TestTicTacToe::testOpeningTrie_SymmetryAndSnapshot()
+{
+    // All four corner openings (and all four edges) are one canonical position
+    auto keyAfter = [](int cell) {
+        std::array<quint8, 9> cells{};
+        cells[cell] = 1;
+        return OpeningTrie::canonicalKey(cells);
+    };
+    QCOMPARE(keyAfter(2), keyAfter(0));
+    QCOMPARE(keyAfter(6), keyAfter(0));
+    QCOMPARE(keyAfter(8), keyAfter(0));
+    QCOMPARE(keyAfter(7), keyAfter(1));
+    QVERIFY(keyAfter(4) != keyAfter(0));
+    QVERIFY(keyAfter(1) != keyAfter(0));
+
+    OpeningTrie trie;
+    QVERIFY(trie.addGame({0, 3, 1, 4, 2}));             // First mover wins on the top row
+    QVERIFY(trie.addGame({2, 5, 1, 4, 0}));             // Its mirror image
+    QVERIFY(trie.addGame({0, 4, 8, 1, 7, 6, 2, 5, 3})); // Draw
+    QVERIFY(!trie.addGame({0, 1}));                     // No board outcome
+    QVERIFY(!trie.addGame({0, 3, 1, 4, 2, 5}));         // Moves after the win
+    QCOMPARE(trie.gameCount(), quint32(3));
+    QCOMPARE(trie.statsAt({8}).games(), quint32(3)); // Any corner reaches the shared node
+    QCOMPARE(trie.statsAt({0, 3}).firstWins, quint32(2));
+    QCOMPARE(trie.statsAt({4}).games(), quint32(0));
+    const QVector<OpeningTrie::Continuation> openings = trie.continuations({});
+    QCOMPARE(openings.size(), 4); // The four corners, nothing else was played
+    QCOMPARE(openings.first().stats.draws, quint32(1));
+
+    // Snapshot round trip keeps every count and the covered match id
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("openings");
+    QVERIFY(trie.saveSnapshot(path, 42));
+    OpeningTrie restored;
+    QVERIFY(restored.loadSnapshot(path));
+    QCOMPARE(restored.watermark(), qint64(42));
+    QCOMPARE(restored.nodeCount(), trie.nodeCount());
+    for (const std::vector<int> &prefix : {std::vector<int>{}, std::vector<int>{6, 7},
+                                          std::vector<int>{0, 4, 8, 1, 7, 6, 2, 5, 3}}) {
+        QCOMPARE(restored.statsAt(prefix).games(), trie.statsAt(prefix).games());
+        QCOMPARE(restored.statsAt(prefix).firstWins, trie.statsAt(prefix).firstWins);
+    }
+
+    // Saved games update the game's trie incrementally, matching a rebuild from matches
+    game->guestMode = false;
+    game->loadOpeningTrie();
+    game->moveHistory = {4, 0, 8, 2, 1, 7, 6, 3, 5}; // Draw
+    game->saveIndividualGameWithNumber("-", "🤝 Tie", 1);
+    game->moveHistory = {4, 0, 2, 6, 3, 5, 1, 7, 8}; // Draw
+    game->saveIndividualGameWithNumber("-", "🤝 Tie", 2);
+    OpeningTrie scanned;
+    QVERIFY(scanned.catchUp(*game->matchStore));
+    QCOMPARE(scanned.gameCount(), quint32(2));
+    QCOMPARE(game->openingTrie.gameCount(), scanned.gameCount());
+    QCOMPARE(game->openingTrie.statsAt({4}).draws, quint32(2));
+
+    game->toggleOpeningExplorer();
+    QVERIFY(game->openingExplorerLabel->text().startsWith("Opening explorer: 2 recorded games"));
+    QVERIFY(game->openingExplorerLabel->text().contains("centre: 2 games, 0% W / 100% D / 0% L"));
+    game->toggleOpeningExplorer();
 }
 
 void TestTicTacToe::testGameSettingsIntegration()
@@ -390,4 +1620,807 @@ void TestTicTacToe::testGameSettingsIntegration()
     QCOMPARE(game->gamesToWin, 3);
 }
 QTEST_MAIN(TestTicTacToe)
+void TestTicTacToe::testGameJournal_ResumeInterruptedSeries()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("tictactoe.db-game");
+    game->gameJournal.setPath(path);
+    game->loggedInUser = "journal_user";
+    game->guestMode = false;
+    game->mode = 1;
+    game->player1Name = "journal_user";
+    game->player2Name = "Rival";
+    game->totalGames = 5;
+    game->gamesToWin = 3;
+    game->player1Wins = 1;
+    game->player2Wins = 0;
+    game->ties = 0;
+    game->currentSeriesId = "S1";
+
+    game->resetGame(); // Journals the series state at the start of the game
+    const char starter = game->gameStartingPlayer;
+    const char second = (starter == 'X') ? 'O' : 'X';
+    game->makeMove(0);
+    game->makeMove(4);
+    game->makeMove(8);
+
+    GameJournal::State state;
+    QVERIFY(game->gameJournal.load(&state));
+    QCOMPARE(state.user, QString("journal_user"));
+    QCOMPARE(state.seriesId, QString("S1"));
+    QCOMPARE(state.player1Wins, 1);
+    QCOMPARE(state.startingPlayer, starter);
+    QVERIFY(!state.betweenGames);
+    QCOMPARE(state.moves, (std::vector<int>{0, 4, 8}));
+
+    // A crash mid-append leaves a torn last line, which only loses that move
+    {
+        QFile torn(path);
+        QVERIFY(torn.open(QIODevice::WriteOnly | QIODevice::Append));
+        torn.write("{\"m\":");
+    }
+    QVERIFY(game->gameJournal.load(&state));
+    QCOMPARE(state.moves.size(), size_t(3));
+
+    // "Restart": everything in memory is gone, the next login resumes the game
+    game->resetGameState();
+    game->player1Name.clear();
+    game->player2Name.clear();
+    game->totalGames = 3;
+    game->offerResume();
+    QCOMPARE(game->board[0], starter);
+    QCOMPARE(game->board[4], second);
+    QCOMPARE(game->board[8], starter);
+    QCOMPARE(game->currentPlayer, second);
+    QCOMPARE(game->player1Wins, 1);
+    QCOMPARE(game->totalGames, 5);
+    QCOMPARE(game->player2Name, QString("Rival"));
+    QCOMPARE(game->currentSeriesId, QString("S1"));
+
+    // The journal restarts from the resumed position and keeps appending
+    game->makeMove(2);
+    QVERIFY(game->gameJournal.load(&state));
+    QCOMPARE(state.moves, (std::vector<int>{0, 4, 8, 2}));
+
+    // Leaving the series normally discards it
+    game->backToModeSelection();
+    QVERIFY(!QFile::exists(path));
+    game->gameJournal.setPath(QString());
+    game->loggedInUser.clear();
+    game->totalGames = 3;
+    game->gamesToWin = 2;
+}
+
+void TestTicTacToe::testMatchImport_ValidationAndResume()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("import_test.db");
+    auto game = [](const QString &moves, const QString &starting, const QString &winner, const QString &result, int i) {
+        QJsonObject object;
+        object["player1"] = "import_a";
+        object["player2"] = "import_b";
+        object["winner"] = winner;
+        object["result"] = result;
+        object["moves"] = moves;
+        object["timestamp"] = QDateTime(QDate(2024, 1, 1), QTime(0, 0)).addSecs(i).toString(Qt::ISODate);
+        object["starting_player"] = starting;
+        object["game_mode"] = "PvP";
+        return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+    };
+    auto writeFile = [](const QString &filePath, const QByteArray &bytes) {
+        QFile file(filePath);
+        return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+    };
+    auto count = [](QSqlDatabase &db) {
+        QSqlQuery query(db);
+        return query.exec("SELECT COUNT(*) FROM matches WHERE player1 = 'import_a'") && query.next()
+               ? query.value(0).toInt() : -1;
+    };
+
+    {
+        QSqlDatabase fileDb = openFileDatabase("import_test", path);
+        QVERIFY(fileDb.isOpen());
+
+        // Three legal games, four that must be turned away
+        QByteArray archive;
+        archive += game("0,3,1,4,2", "X", "import_a", "Win", 0);          // X takes the top row
+        archive += game("0,3,1,4,2", "O", "import_b", "Win", 1);          // Same cells, O moved first
+        archive += game("0,4", "X", "import_b", "🏳️ Surrender", 2);       // Gave up early
+        archive += game("0,0", "X", "-", "Draw", 3);                      // Occupied cell
+        archive += game("0,3,1,4,2", "X", "import_b", "Win", 4);          // Wrong winner
+        archive += game("0,4", "X", "-", "Draw", 5);                      // Unfinished, no surrender
+        archive += "{not json\n";
+        const QString jsonl = dir.filePath("games.jsonl");
+        QVERIFY(writeFile(jsonl, archive));
+
+        MatchImport import(fileDb, jsonl);
+        import.setBatchRows(2); // Several batches in flight
+        QString error;
+        QVERIFY2(import.run(&error), qPrintable(error));
+        QCOMPARE(import.progress().imported, qint64(3));
+        QCOMPARE(import.progress().rejected, qint64(4));
+        QCOMPARE(import.rejections().size(), 4);
+        QCOMPARE(count(fileDb), 3);
+
+        // Importing the same file again adds nothing
+        MatchImport again(fileDb, jsonl);
+        QVERIFY(again.run());
+        QCOMPARE(again.progress().importedThisRun, qint64(0));
+        QCOMPARE(count(fileDb), 3);
+
+        // CSV: header first, quoted fields
+        const QString csv = dir.filePath("games.csv");
+        QVERIFY(writeFile(csv, "player1,player2,winner,result,moves,timestamp,starting_player\n"
+                               "import_a,import_b,-,Draw,\"4,0,8,2,1,7,6,3,5\",2024-02-01T00:00:00,X\n"
+                               "import_a,import_b,import_a,Win,\"0,3,1,4,2\",2024-02-01T00:01:00,X\n"));
+        MatchImport fromCsv(fileDb, csv);
+        QVERIFY2(fromCsv.run(&error), qPrintable(error));
+        QCOMPARE(fromCsv.progress().imported, qint64(2));
+        QCOMPARE(count(fileDb), 5);
+
+        // An interrupted import: the checkpoint says the first part is in
+        const int total = 20000;
+        const int done = 5000;
+        QByteArray bulk;
+        qint64 offset = 0;
+        for (int i = 0; i < total; ++i) {
+            bulk += (i % 2 == 0) ? game("0,3,1,4,2", "X", "import_a", "Win", 100 + i)
+                                 : game("4,0,8,2,1,7,6,3,5", "X", "-", "Draw", 100 + i);
+            if (i == done - 1) offset = bulk.size();
+        }
+        const QString bulkPath = dir.filePath("bulk.jsonl");
+        QVERIFY(writeFile(bulkPath, bulk));
+        QSqlQuery checkpoint(fileDb);
+        checkpoint.prepare("INSERT INTO import_checkpoints (source, position, imported) VALUES (:source, :position, :imported)");
+        checkpoint.bindValue(":source", QFileInfo(bulkPath).canonicalFilePath());
+        checkpoint.bindValue(":position", offset);
+        checkpoint.bindValue(":imported", done);
+        QVERIFY(checkpoint.exec());
+
+        MatchImport resumed(fileDb, bulkPath);
+        resumed.setBatchRows(4096);
+        QVERIFY2(resumed.run(&error), qPrintable(error));
+        QCOMPARE(resumed.progress().importedThisRun, qint64(total - done));
+        QCOMPARE(resumed.progress().imported, qint64(total));
+        QCOMPARE(resumed.progress().rejected, qint64(0));
+        QCOMPARE(count(fileDb), 5 + total - done);
+        const qint64 ms = qMax<qint64>(1, resumed.progress().elapsedMs);
+        qDebug() << "Imported" << total - done << "games in" << ms << "ms ("
+                 << (total - done) * 1000 / ms << "games/s)";
+        fileDb.close();
+    }
+    QSqlDatabase::removeDatabase("import_test");
+}
+
+void TestTicTacToe::testMatchArchive_RetentionAndReplay()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    {
+        QSqlDatabase fileDb = openFileDatabase("archive_test", dir.filePath("archive_test.db"));
+        QVERIFY(fileDb.isOpen());
+        QSqlQuery query(fileDb);
+        QVERIFY(query.exec("PRAGMA foreign_keys = ON"));
+        QVERIFY(query.exec("INSERT INTO users (username, password_hash, salt) VALUES "
+                           "('archive_a', 'x', 'x'), ('archive_b', 'x', 'x')"));
+
+        // Ten three-game series; the first eight are old, against archive_b or the AI
+        const int games = 30;
+        const int oldGames = 24;
+        for (int i = 0; i < games; ++i) {
+            MatchRecord record;
+            record.player1 = "archive_a";
+            record.player2 = (i / 3) % 2 == 0 ? "archive_b" : "AI";
+            record.winner = (i % 3 == 2) ? "-" : (i % 2 == 0 ? record.player1 : record.player2);
+            record.result = record.winner == "-" ? "Draw" : "Win";
+            record.moves = encodeMoves(std::vector<int>{i % 9, (i + 4) % 9, (i + 8) % 9});
+            record.timestamp = (i < oldGames ? QDateTime(QDate(2020, 1, 1), QTime(0, 0)).addSecs(i * 60)
+                                             : QDateTime::currentDateTime().addSecs(i - games)).toString(Qt::ISODate);
+            record.startingPlayer = "X";
+            record.gameMode = record.player2 == "AI" ? "PvAI" : "PvP";
+            record.seriesId = QString("archive_series_%1").arg(i / 3);
+            record.gameNumber = 1 + i % 3;
+            record.seriesTotal = 3;
+            record.seriesTarget = 2;
+            QVERIFY(DbWriter::insertRecord(fileDb, record));
+        }
+
+        SqliteMatchStore store(fileDb);
+        auto history = [&store](const QString &user, int pageSize) {
+            QVector<MatchSummary> all;
+            QVector<MatchSummary> page;
+            do {
+                if (!store.historyPage(user, all.isEmpty() ? nullptr : &all.last(), pageSize, &page)) return QVector<MatchSummary>();
+                all += page;
+            } while (page.size() == pageSize);
+            return all;
+        };
+        auto scanned = [&store]() {
+            QVector<QPair<qint64, MatchRecord>> rows;
+            store.scan(0, [&rows](qint64 id, const MatchRecord &record) { rows.append({id, record}); });
+            return rows;
+        };
+        auto statsGames = [&query]() {
+            return query.exec("SELECT games FROM user_stats s JOIN users u ON u.id = s.user_id "
+                              "WHERE u.username = 'archive_a'") && query.next() ? query.value(0).toInt() : -1;
+        };
+        const QVector<MatchSummary> before = history("archive_a", 1000);
+        const QVector<QPair<qint64, MatchRecord>> scanBefore = scanned();
+        QCOMPARE(before.size(), games);
+        QCOMPARE(statsGames(), games);
+
+        // Small batches: only the old games move, oldest first
+        const qint64 cutoff = MatchArchive::cutoffFor(30);
+        int moved = 0;
+        int total = 0;
+        QString error;
+        while ((moved = MatchArchive::archiveBatch(fileDb, cutoff, 5, &error)) > 0) total += moved;
+        QVERIFY2(moved == 0, qPrintable(error));
+        QCOMPARE(total, oldGames);
+        QVERIFY(query.exec("SELECT (SELECT COUNT(*) FROM matches), (SELECT COUNT(*) FROM archive_chunks)"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), games - oldGames);
+        QCOMPARE(query.value(1).toInt(), (oldGames + 4) / 5);
+        QCOMPARE(statsGames(), games); // Aggregates are kept
+        QVERIFY(query.exec("SELECT wins, best_streak FROM user_stats s JOIN users u ON u.id = s.user_id "
+                           "WHERE u.username = 'archive_a'") && query.next());
+        const int wins = query.value(0).toInt();
+        const int bestStreak = query.value(1).toInt();
+        QVERIFY2(TicTacToe::rebuildUserStats(fileDb, &error), qPrintable(error));
+        QCOMPARE(statsGames(), games); // ...and so is a rebuild, which replays the chunks
+        QVERIFY(query.exec("SELECT wins, best_streak FROM user_stats s JOIN users u ON u.id = s.user_id "
+                           "WHERE u.username = 'archive_a'") && query.next());
+        QCOMPARE(query.value(0).toInt(), wins);
+        QCOMPARE(query.value(1).toInt(), bestStreak);
+
+        // History pages straddle the two tiers and come back unchanged
+        const QVector<MatchSummary> after = history("archive_a", 7);
+        QCOMPARE(after.size(), before.size());
+        for (int i = 0; i < before.size(); ++i) {
+            QCOMPARE(after[i].id, before[i].id);
+            QCOMPARE(after[i].winner, before[i].winner);
+            QCOMPARE(after[i].seriesId, before[i].seriesId);
+        }
+        const QVector<QPair<qint64, MatchRecord>> scanAfter = scanned();
+        QCOMPARE(scanAfter.size(), scanBefore.size());
+        for (int i = 0; i < scanBefore.size(); ++i) {
+            QCOMPARE(scanAfter[i].first, scanBefore[i].first);
+            QCOMPARE(scanAfter[i].second.moves, scanBefore[i].second.moves);
+        }
+        // A player's own games come from match_players/archived_players, both tiers, in id order
+        QVector<qint64> playerIds;
+        QVERIFY(store.scanUser("archive_b", [&playerIds](qint64 id, const MatchRecord &record) {
+            if (record.player2 == "archive_b") playerIds.append(id);
+        }));
+        QVector<qint64> expectedIds;
+        for (const auto &row : scanBefore)
+            if (row.second.player2 == "archive_b") expectedIds.append(row.first);
+        QCOMPARE(playerIds, expectedIds);
+        QCOMPARE(playerIds.size(), games / 2);
+
+        // Archived games replay like live ones
+        MatchRecord replay;
+        QVERIFY(store.loadMatch(scanBefore.first().first, &replay));
+        QCOMPARE(replay.moves, scanBefore.first().second.moves);
+        QCOMPARE(replay.seriesId, QString("archive_series_0"));
+
+        MatchArchive::SeriesTotals totals;
+        QVERIFY(MatchArchive::seriesTotals(fileDb, "archive_series_0", &totals));
+        QCOMPARE(totals.games, 3);
+        QCOMPARE(totals.player1Wins + totals.player2Wins + totals.ties, 3);
+        QCOMPARE(totals.ties, 1);
+        QCOMPARE(totals.firstPlayedAt, QDateTime(QDate(2020, 1, 1), QTime(0, 0)).toMSecsSinceEpoch());
+        QCOMPARE(totals.lastPlayedAt, QDateTime(QDate(2020, 1, 1), QTime(0, 2)).toMSecsSinceEpoch());
+        QVERIFY(!MatchArchive::seriesTotals(fileDb, "archive_series_9", &totals)); // Still live
+
+        // Deleting an account takes its archived games along
+        QVERIFY(store.removeUserMatches("archive_b", &error));
+        QCOMPARE(history("archive_b", 100).size(), 3); // The live series goes with the users row
+        QVERIFY(!MatchArchive::seriesTotals(fileDb, "archive_series_0", &totals));
+        QVERIFY(MatchArchive::seriesTotals(fileDb, "archive_series_1", &totals));
+        QCOMPARE(history("archive_a", 100).size(), games - oldGames + oldGames / 2);
+        fileDb.close();
+    }
+    QSqlDatabase::removeDatabase("archive_test");
+}
+
+void TestTicTacToe::testMatchHistory_DateRangeFilter()
+{
+    QSqlQuery query(game->db);
+    QVERIFY(query.exec("INSERT INTO users (username, password_hash, salt) VALUES ('range_user', 'h', 's')"));
+
+    // One game a day at noon UTC through January 2025, two on the 10th to tie-break on id
+    const QDateTime january(QDate(2025, 1, 1), QTime(12, 0), QTimeZone::UTC);
+    for (int day = 0; day < 31; ++day) {
+        for (int copy = 0; copy < (day == 9 ? 2 : 1); ++copy) {
+            MatchRecord record;
+            record.player1 = "range_user";
+            record.player2 = "AI";
+            record.winner = "AI";
+            record.result = "Defeat";
+            record.moves = encodeMoves(std::vector<int>{0, 4, 8});
+            record.playedAt = january.addDays(day).toMSecsSinceEpoch();
+            record.timestamp = timestampText(record.playedAt);
+            record.startingPlayer = "X";
+            record.gameMode = "PvAI";
+            QVERIFY(DbWriter::insertRecord(game->db, record));
+        }
+    }
+    // Writers that only send text are converted by the insert trigger
+    QVERIFY(query.exec("INSERT INTO matches (player1, player2, player1_id, winner, result, timestamp) "
+                       "VALUES ('range_user', 'AI', (SELECT id FROM users WHERE username = 'range_user'), "
+                       "'AI', 'Defeat', '2025-01-20T18:30:00Z')"));
+    QVERIFY(query.exec("SELECT played_at, timestamp FROM matches ORDER BY id DESC LIMIT 1"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toLongLong(), QDateTime(QDate(2025, 1, 20), QTime(18, 30), QTimeZone::UTC).toMSecsSinceEpoch());
+    QVERIFY(query.value(1).isNull());
+
+    // [Jan 10, Jan 20) in pages of 3: ten days, eleven games, newest first
+    HistoryFilter filter;
+    filter.range.from = january.addDays(9).addSecs(-12 * 3600).toMSecsSinceEpoch();
+    filter.range.to = january.addDays(19).addSecs(-12 * 3600).toMSecsSinceEpoch();
+    const DateRange &range = filter.range;
+    QVector<MatchSummary> all;
+    QVector<MatchSummary> page;
+    do {
+        QVERIFY(game->matchStore->historyPage("range_user", filter, all.isEmpty() ? nullptr : &all.last(), 3, &page));
+        all += page;
+    } while (page.size() == 3);
+    QCOMPARE(all.size(), 11);
+    QCOMPARE(all.first().playedAt, january.addDays(18).toMSecsSinceEpoch());
+    QCOMPARE(all.last().playedAt, january.addDays(9).toMSecsSinceEpoch());
+    QVERIFY(all[all.size() - 2].id > all.last().id);
+    for (const MatchSummary &row : std::as_const(all)) QVERIFY(range.contains(row.playedAt));
+
+    // The model passes the range to every page and formats only what's shown
+    MatchHistoryModel model(MatchHistoryModel::Layout::History);
+    model.setSource(game->matchStore, "range_user", filter);
+    QCOMPARE(model.rowCount(), 11);
+    QCOMPARE(model.data(model.index(0, 0)).toString(),
+             january.addDays(18).toLocalTime().toString(Qt::ISODate));
+    model.setSource(game->matchStore, "range_user");
+    QCOMPARE(model.rowCount(), 33);
+
+    // The range is a bounded search of the played_at index, no sort
+    QSqlQuery plan(game->db);
+    QVERIFY(plan.prepare(QString("EXPLAIN QUERY PLAN ") + SqliteMatchStore::FIRST_PAGE_QUERY));
+    plan.bindValue(":user", "range_user");
+    plan.bindValue(":from", range.from);
+    plan.bindValue(":to", range.to);
+    plan.bindValue(":limit", 3);
+    QVERIFY2(plan.exec(), qPrintable(plan.lastError().text()));
+    QStringList details;
+    while (plan.next()) details << plan.value(3).toString();
+    QVERIFY2(details.join('\n').contains("idx_match_players_played"), qPrintable(details.join('\n')));
+    QVERIFY2(!details.join('\n').contains("TEMP B-TREE"), qPrintable(details.join('\n')));
+}
+
+void TestTicTacToe::testHistorySearch_FacetsAndFullText()
+{
+    QSqlQuery query(game->db);
+    QVERIFY(query.exec("INSERT INTO users (username, password_hash, salt) VALUES "
+                       "('search_user', 'h', 's'), ('search_rival', 'h', 's')"));
+
+    // 60 games in both backends: rival PvP series of three, AI games, a few surrenders
+    MemoryMatchStore memory;
+    const QDateTime start(QDate(2025, 3, 1), QTime(12, 0), QTimeZone::UTC);
+    for (int i = 0; i < 60; ++i) {
+        MatchRecord record;
+        record.player1 = "search_user";
+        record.player2 = i % 3 == 0 ? "AI" : "search_rival";
+        record.winner = i % 4 == 0 ? "-" : (i % 2 == 0 ? record.player1 : record.player2);
+        record.result = record.winner == "-" ? "Draw" : (i % 10 == 1 ? "Surrender" : "Victory");
+        record.moves = encodeMoves(std::vector<int>{i % 9, (i + 4) % 9});
+        record.playedAt = start.addSecs(i * 3600).toMSecsSinceEpoch();
+        record.timestamp = timestampText(record.playedAt);
+        record.startingPlayer = "X";
+        record.gameMode = record.player2 == "AI" ? "PvAI" : "PvP";
+        record.difficulty = record.player2 == "AI" ? 2 : 0;
+        if (record.player2 != "AI") {
+            record.seriesId = QString("search_series_%1").arg(i / 6);
+            record.gameNumber = 1 + i % 3;
+            record.seriesTotal = 3;
+            record.seriesTarget = 2;
+        }
+        QVERIFY(DbWriter::insertRecord(game->db, record));
+        QVERIFY(memory.append(record));
+    }
+
+    auto search = [](MatchStore &store, const QString &text, int pageSize) {
+        HistoryFilter filter;
+        QVector<qint64> times;
+        if (!HistoryFilter::parse(text, &filter)) return QVector<qint64>{-1};
+        QVector<MatchSummary> all;
+        QVector<MatchSummary> page;
+        do {
+            if (!store.historyPage("search_user", filter, all.isEmpty() ? nullptr : &all.last(), pageSize, &page)) {
+                return QVector<qint64>{-2};
+            }
+            all += page;
+        } while (page.size() == pageSize);
+        for (const MatchSummary &row : std::as_const(all)) times.append(row.playedAt); // Same in both stores
+        return times;
+    };
+
+    // SQLite (indexes, FTS5 or LIKE) and the in-memory walk find the same games
+    const QStringList searches = {
+        "opponent:search_rival", "result:win", "result:tie mode:pvp", "mode:pvai result:loss",
+        "surrender", "SURR opponent:search_rival", "series:search_series_3", "vic rival",
+        "from:2025-03-02 to:2025-03-02 result:win", "nothing_like_this", "ictory"
+    };
+    for (const QString &text : searches) {
+        const QVector<qint64> fromSqlite = search(*game->matchStore, text, 4);
+        QVERIFY2(!fromSqlite.contains(-1) && !fromSqlite.contains(-2), qPrintable(text));
+        QCOMPARE(fromSqlite, search(memory, text, 4));
+    }
+    QCOMPARE(search(*game->matchStore, "opponent:search_rival", 100).size(), 40);
+    QCOMPARE(search(*game->matchStore, "series:search_series_3", 100).size(), 4);
+    QCOMPARE(search(*game->matchStore, "surrender", 100).size(), 6);
+    QCOMPARE(search(*game->matchStore, "nothing_like_this", 100).size(), 0);
+    QCOMPARE(search(memory, "ictory", 100).size(), 0); // Word prefixes, not substrings
+
+    HistoryFilter filter;
+    QString error;
+    QVERIFY(!HistoryFilter::parse("result:maybe", &filter, &error));
+    QVERIFY(error.contains("result"));
+    QVERIFY(!HistoryFilter::parse("colour:red", &filter, &error));
+    QVERIFY(HistoryFilter::parse("vs:\"search_rival\" \"Victory\"", &filter));
+    QCOMPARE(filter.opponent, QString("search_rival"));
+    QCOMPARE(filter.terms, QStringList{"Victory"});
+
+    // Each facet is a range scan of its own index in history order; a series is read from its games
+    struct Plan { QString text; QString index; };
+    const QVector<Plan> plans = {
+        {"opponent:search_rival", "idx_match_players_opponent"},
+        {"result:win", "idx_match_players_outcome"},
+        {"mode:pvai", "idx_match_players_mode"},
+        {"series:search_series_3", "idx_matches_series_ref"}
+    };
+    for (const Plan &expected : plans) {
+        QVERIFY(HistoryFilter::parse(expected.text, &filter));
+        QSqlQuery plan(game->db);
+        QVERIFY(plan.prepare("EXPLAIN QUERY PLAN " + SqliteMatchStore::searchPageQuery(filter, true, false)));
+        plan.bindValue(":user", "search_user");
+        plan.bindValue(":from", filter.range.from);
+        plan.bindValue(":to", filter.range.to);
+        plan.bindValue(":opponent", filter.opponent);
+        plan.bindValue(":outcome", 1);
+        plan.bindValue(":mode", filter.gameMode);
+        plan.bindValue(":series", filter.seriesId);
+        plan.bindValue(":limit", MatchHistoryModel::PageSize);
+        QVERIFY2(plan.exec(), qPrintable(plan.lastError().text()));
+        QStringList details;
+        while (plan.next()) details << plan.value(3).toString();
+        const QString text = details.join('\n');
+        QVERIFY2(text.contains(expected.index), qPrintable(expected.text + " -> " + text));
+        QVERIFY2(!text.contains("SCAN p") && !text.contains("SCAN m"), qPrintable(expected.text + " -> " + text));
+        if (filter.seriesId.isEmpty()) QVERIFY2(!text.contains("TEMP B-TREE"), qPrintable(expected.text + " -> " + text));
+    }
+
+    // Games deleted with an account leave the full-text index too
+    QVERIFY(query.exec("DELETE FROM users WHERE username = 'search_rival'"));
+    QCOMPARE(search(*game->matchStore, "rival", 100).size(), 0);
+}
+
+void TestTicTacToe::testStatementCache_ReuseAndSavings()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    {
+        QSqlDatabase fileDb = openFileDatabase("statement_cache", dir.filePath("cache.db"));
+        QVERIFY(fileDb.isOpen());
+
+        // Reuse, rebinding, nesting and bad SQL
+        StatementCache cache(fileDb, 3);
+        const QString lookup = "SELECT username FROM users WHERE username = :username";
+        for (const QString name : {"cache_a", "cache_b"}) {
+            StatementCache::Statement insert = cache.statement(
+                "INSERT INTO users (username, password_hash, salt) VALUES (:username, 'h', 's')");
+            insert->bindValue(":username", name);
+            QVERIFY(insert->exec());
+        }
+        QCOMPARE(cache.misses(), 1);
+        QCOMPARE(cache.hits(), 1);
+        {
+            StatementCache::Statement outer = cache.statement(lookup);
+            outer->bindValue(":username", "cache_a");
+            QVERIFY(outer->exec() && outer->next());
+            StatementCache::Statement nested = cache.statement(lookup); // Outer still reading: a one-off
+            nested->bindValue(":username", "cache_b");
+            QVERIFY(nested->exec() && nested->next());
+            QCOMPARE(outer->value(0).toString(), QString("cache_a"));
+            QCOMPARE(nested->value(0).toString(), QString("cache_b"));
+        }
+        QCOMPARE(cache.size(), 2);
+        {
+            StatementCache::Statement again = cache.statement(lookup);
+            again->bindValue(":username", "cache_b");
+            QVERIFY(again->exec() && again->next());
+            QCOMPARE(again->value(0).toString(), QString("cache_b"));
+        }
+        {
+            StatementCache::Statement broken = cache.statement("SELECT nope FROM nowhere");
+            QVERIFY(!broken->exec());
+            QVERIFY(broken->lastError().isValid());
+        }
+        QCOMPARE(cache.size(), 2); // Not kept
+        for (const QString sql : {"SELECT COUNT(*) FROM users", "SELECT COUNT(*) FROM users WHERE salt = 's'"}) {
+            StatementCache::Statement count = cache.statement(sql); // The second is over capacity
+            QVERIFY(count->exec() && count->next());
+            QCOMPARE(count->value(0).toInt(), 2);
+        }
+        QCOMPARE(cache.size(), 3);
+
+        // The same inserts and lookups prepared per call and through the stores' caches
+        const int rows = 2000;
+        QVERIFY(fileDb.transaction());
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < rows; ++i) {
+            QSqlQuery insert(fileDb);
+            insert.prepare("INSERT INTO users (username, password_hash, salt) VALUES (:username, :password_hash, :salt)");
+            insert.bindValue(":username", QString("uncached_%1").arg(i));
+            insert.bindValue(":password_hash", "h");
+            insert.bindValue(":salt", "s");
+            QVERIFY(insert.exec());
+        }
+        const qint64 uncachedInsertUs = timer.nsecsElapsed() / 1000;
+
+        SqliteUserStore users(fileDb);
+        timer.restart();
+        for (int i = 0; i < rows; ++i) {
+            QVERIFY(users.addUser(QString("cached_%1").arg(i), "h", "s", nullptr));
+        }
+        const qint64 cachedInsertUs = timer.nsecsElapsed() / 1000;
+        QVERIFY(fileDb.commit());
+
+        timer.restart();
+        for (int i = 0; i < rows; ++i) {
+            QSqlQuery find(fileDb);
+            find.prepare("SELECT id, password_hash, salt FROM users WHERE username = :username");
+            find.bindValue(":username", QString("uncached_%1").arg(i));
+            QVERIFY(find.exec() && find.next());
+        }
+        const qint64 uncachedLookupUs = timer.nsecsElapsed() / 1000;
+
+        timer.restart();
+        for (int i = 0; i < rows; ++i) {
+            UserAccount account;
+            bool found = false;
+            QVERIFY(users.findUser(QString("cached_%1").arg(i), &account, &found));
+            QVERIFY(found);
+            QCOMPARE(account.username, QString("cached_%1").arg(i));
+        }
+        const qint64 cachedLookupUs = timer.nsecsElapsed() / 1000;
+
+        // Inline match inserts: DbWriter::insertRecord(db, ...) prepares three statements a game
+        SqliteMatchStore matches(fileDb);
+        MatchRecord record;
+        record.player1 = "cached_1";
+        record.player2 = "AI";
+        record.winner = "AI";
+        record.result = "Defeat";
+        record.moves = encodeMovesText("0,4,1,2,8,6");
+        record.startingPlayer = "X";
+        record.gameMode = "PvAI";
+        record.difficulty = 3;
+        QVERIFY(fileDb.transaction());
+        timer.restart();
+        for (int i = 0; i < rows; ++i) {
+            record.playedAt = i + 1;
+            QVERIFY(DbWriter::insertRecord(fileDb, record));
+        }
+        const qint64 uncachedMatchUs = timer.nsecsElapsed() / 1000;
+        timer.restart();
+        for (int i = 0; i < rows; ++i) {
+            record.playedAt = rows + i + 1;
+            QVERIFY(matches.append(record));
+        }
+        const qint64 cachedMatchUs = timer.nsecsElapsed() / 1000;
+        QVERIFY(fileDb.commit());
+
+        MatchRecord loaded;
+        QVERIFY(matches.loadMatch(matches.lastMatchId(), &loaded));
+        QCOMPARE(loaded.playedAt, qint64(2 * rows));
+        QVector<MatchSummary> page;
+        QVERIFY(matches.historyPage("cached_1", nullptr, 3, &page));
+        QCOMPARE(page.size(), 3);
+        QCOMPARE(page.first().playedAt, qint64(2 * rows));
+
+        qDebug() << "Statement cache: user insert" << (uncachedInsertUs * 1000 / rows) << "->"
+                 << (cachedInsertUs * 1000 / rows) << "ns, user lookup" << (uncachedLookupUs * 1000 / rows) << "->"
+                 << (cachedLookupUs * 1000 / rows) << "ns, match insert" << (uncachedMatchUs * 1000 / rows) << "->"
+                 << (cachedMatchUs * 1000 / rows) << "ns";
+        QVERIFY(cachedLookupUs < uncachedLookupUs);
+        fileDb.close();
+    }
+    QSqlDatabase::removeDatabase("statement_cache");
+}
+
+void TestTicTacToe::testConnectionManager_ConcurrentReadsAndWrites()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("connections.db");
+    {
+        ConnectionManager connections(path, StorageProfile::byName("balanced"), "connections_test");
+        QSqlDatabase db = connections.connection();
+        QVERIFY(db.isOpen());
+        QCOMPARE(db.connectionName(), QString("connections_test"));
+        SchemaMigrator migrator(db);
+        TicTacToe::registerSchemaMigrations(migrator);
+        QVERIFY(migrator.migrate());
+        QSqlQuery query(db);
+        QVERIFY(query.exec("INSERT INTO users (username, password_hash, salt) VALUES ('conn_user', 'h', 's')"));
+
+        // Every connection is set up alike, whichever thread opens it
+        auto settings = [](QSqlDatabase db) {
+            QStringList values;
+            QSqlQuery pragma(db);
+            for (const QString name : {"journal_mode", "foreign_keys", "busy_timeout"}) {
+                values << (pragma.exec("PRAGMA " + name) && pragma.next() ? pragma.value(0).toString() : QString());
+            }
+            return values;
+        };
+        const QStringList expected = {"wal", "1", "5000"};
+        QCOMPARE(settings(db), expected);
+        QString workerName;
+        QStringList workerSettings;
+        QThread *thread = QThread::create([&]() {
+            QSqlDatabase own = connections.connection();
+            workerName = own.connectionName();
+            workerSettings = settings(own);
+        });
+        thread->start();
+        QVERIFY(thread->wait(10000));
+        delete thread;
+        QCOMPARE(workerSettings, expected);
+        QVERIFY(workerName.startsWith("connections_test_"));
+        QVERIFY(!QSqlDatabase::contains(workerName)); // Closed as the thread finished
+
+        // History pages on a pool thread while the writer commits on its own
+        const int games = 300;
+        DbWriter writer(path, 16);
+        writer.setConnections(&connections);
+        writer.start();
+        QAtomicInt writing(1);
+        QFuture<int> reads = QtConcurrent::run([&connections, &writing]() {
+            int failures = 0;
+            {
+                SqliteMatchStore store(connections.connection());
+                do {
+                    QVector<MatchSummary> page;
+                    QString error;
+                    if (!store.historyPage("conn_user", nullptr, MatchHistoryModel::PageSize, &page, &error)) ++failures;
+                } while (writing.loadAcquire());
+            }
+            connections.release();
+            return failures;
+        });
+        for (int i = 0; i < games; ++i) {
+            MatchRecord record;
+            record.player1 = "conn_user";
+            record.player2 = "AI";
+            record.winner = "AI";
+            record.result = "Defeat";
+            record.moves = encodeMovesText("0,4,8");
+            record.playedAt = i + 1;
+            writer.enqueue(record);
+        }
+        writer.flush();
+        writing.storeRelease(0);
+        QCOMPARE(reads.result(), 0);
+        writer.stop();
+
+        QVERIFY(query.exec("SELECT COUNT(*) FROM matches WHERE player1 = 'conn_user'"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), games);
+        query.finish();
+
+        // In-memory databases can't be shared across threads
+        ConnectionManager memory(":memory:", StorageProfile(), "connections_memory");
+        QVERIFY(memory.connection().isOpen());
+        QString error;
+        QFuture<bool> shared = QtConcurrent::run([&memory, &error]() { return memory.connection(&error).isValid(); });
+        QVERIFY(!shared.result());
+        QVERIFY(!error.isEmpty());
+    }
+    QVERIFY(!QSqlDatabase::contains("connections_test"));
+    QVERIFY(!QSqlDatabase::contains("connections_memory"));
+}
+
+void TestTicTacToe::testStorageMetrics_HistogramsAndSlowQueryLog()
+{
+    LatencyHistogram histogram;
+    for (int i = 0; i < 90; ++i) histogram.add(3000);     // 3 us: [2, 4) us
+    for (int i = 0; i < 10; ++i) histogram.add(900000);   // 900 us: [512, 1024) us
+    QCOMPARE(histogram.count(), qint64(100));
+    QCOMPARE(histogram.bucket(2), qint64(90));
+    QCOMPARE(histogram.bucket(10), qint64(10));
+    QCOMPARE(histogram.percentileUs(0.5), qint64(4));
+    QCOMPARE(histogram.percentileUs(0.95), qint64(1024));
+    QCOMPARE(histogram.maxNs(), qint64(900000));
+
+    int thresholdMs = 0;
+    QVERIFY(StorageMetrics::thresholdFromString("", &thresholdMs));
+    QCOMPARE(thresholdMs, int(StorageMetrics::DefaultSlowQueryMs));
+    QVERIFY(StorageMetrics::thresholdFromString("off", &thresholdMs));
+    QCOMPARE(thresholdMs, 0);
+    QVERIFY(StorageMetrics::thresholdFromString("250", &thresholdMs));
+    QCOMPARE(thresholdMs, 250);
+    QVERIFY(!StorageMetrics::thresholdFromString("-3", &thresholdMs));
+
+    // Every call through the game's stores lands in its operation's histogram
+    StorageMetrics &metrics = StorageMetrics::global();
+    metrics.reset();
+    qint64 userId = 0;
+    QVERIFY(game->userStore->addUser("metrics_user", "h", "s", &userId));
+    UserAccount account;
+    bool found = false;
+    for (int i = 0; i < 3; ++i) QVERIFY(game->userStore->findUser("metrics_user", &account, &found));
+    MatchRecord record;
+    record.player1 = "metrics_user";
+    record.player2 = "AI";
+    record.winner = "AI";
+    record.result = "Defeat";
+    record.moves = encodeMovesText("0,4,8");
+    record.playedAt = QDateTime::currentMSecsSinceEpoch();
+    QVERIFY(game->matchStore->append(record));
+    QVector<MatchSummary> page;
+    QVERIFY(game->matchStore->historyPage("metrics_user", nullptr, 10, &page));
+    QCOMPARE(page.size(), 1);
+    MatchRecord loaded;
+    QVERIFY(game->matchStore->loadMatch(page.first().id, &loaded));
+    QVERIFY(game->userStore->removeUser("metrics_user"));
+    QVERIFY(game->matchStore->removeUserMatches("metrics_user"));
+
+    const QMap<QString, LatencyHistogram> histograms = metrics.histograms();
+    QCOMPARE(histograms.value("register").count(), qint64(1));
+    QCOMPARE(histograms.value("login lookup").count(), qint64(3));
+    QCOMPARE(histograms.value("save game").count(), qint64(1));
+    QCOMPARE(histograms.value("history load").count(), qint64(1));
+    QCOMPARE(histograms.value("replay load").count(), qint64(1));
+    QCOMPARE(histograms.value("account deletion").count(), qint64(1));
+    QVERIFY(histograms.value("login lookup").totalNs() > 0);
+    QVERIFY(metrics.report().contains("login lookup: 3 calls"));
+
+    // A statement held past the threshold is logged with its values and plan
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString logPath = dir.filePath("slow.log");
+    QVERIFY(metrics.setSlowQueryLog(logPath));
+    metrics.setSlowQueryThreshold(1);
+    {
+        StatementCache cache(game->db);
+        {
+            StatementCache::Statement quick = cache.statement("SELECT 1");
+            QVERIFY(quick->exec());
+        }
+        QCOMPARE(metrics.recentSlowQueries().size(), 0);
+        {
+            StatementCache::Statement slow = cache.statement("SELECT id FROM users WHERE username = :username");
+            slow->bindValue(":username", "slow_user");
+            QVERIFY(slow->exec());
+            QThread::msleep(5);
+        }
+    }
+    metrics.writeReport();
+    metrics.setSlowQueryThreshold(StorageMetrics::DefaultSlowQueryMs);
+    QVERIFY(metrics.setSlowQueryLog(QString()));
+
+    const QStringList slowQueries = metrics.recentSlowQueries();
+    QCOMPARE(slowQueries.size(), 1);
+    QVERIFY(slowQueries.first().contains("SELECT id FROM users WHERE username = :username"));
+    QVERIFY(slowQueries.first().contains("values: slow_user"));
+    QVERIFY2(slowQueries.first().contains("USING COVERING INDEX sqlite_autoindex_users_1"), qPrintable(slowQueries.first()));
+    QFile log(logPath);
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    const QString logged = QString::fromUtf8(log.readAll());
+    QVERIFY(logged.contains(slowQueries.first()));
+    QVERIFY(logged.contains("storage latency since start"));
+    metrics.reset();
+}
+
 #include "test_tictactoe.moc"
@@ -1,7 +1,275 @@
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
 #include "tictactoe.h"
+#include "matchimport.h"
+
+// Headless perft mode: "--perft [depth]" prints the game-tree counts for both
+// starting sides and exits without creating the window.
+static int runPerft(int depth) {
+    QTextStream out(stdout);
+    for (char starter : {'X', 'O'}) {
+        QElapsedTimer timer;
+        timer.start();
+        TicTacToe::PerftResult result = TicTacToe::perft(depth, starter);
+        qint64 elapsedUs = qMax<qint64>(1, timer.nsecsElapsed() / 1000);
+        out << "perft(" << depth << ") " << starter << " starts: "
+            << "leaves=" << result.leaves
+            << " xWins=" << result.xWins
+            << " oWins=" << result.oWins
+            << " draws=" << result.draws
+            << " time=" << elapsedUs << "us"
+            << " (" << (result.leaves * 1000000 / elapsedUs) << " leaves/s)\n";
+    }
+    return 0;
+}
+
+// Headless "--rebuild-stats [database]": migrates the database if needed and
+// recomputes user_stats from the full match history in one transaction.
+static int runRebuildStats(int argc, char *argv[], const QString &path) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    int status = 1;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "rebuild_stats");
+        db.setDatabaseName(path);
+        QString error;
+        if (!db.open()) {
+            error = "cannot open " + path;
+        } else {
+            QSqlQuery(db).exec("PRAGMA foreign_keys = ON");
+            SchemaMigrator migrator(db);
+            TicTacToe::registerSchemaMigrations(migrator);
+            if (migrator.migrate(&error)) {
+                while (migrator.runBackfillBatch()) {} // Legacy rows must be linked to user ids first
+            }
+            if (error.isEmpty() && db.transaction()) {
+                QElapsedTimer timer;
+                timer.start();
+                if (TicTacToe::rebuildUserStats(db, &error) && db.commit()) {
+                    QSqlQuery count(db);
+                    count.exec("SELECT COUNT(*), COALESCE(SUM(games), 0) FROM user_stats");
+                    count.next();
+                    out << "Rebuilt stats for " << count.value(0).toLongLong() << " users ("
+                        << count.value(1).toLongLong() << " games) in " << timer.elapsed() << " ms\n";
+                    status = 0;
+                } else {
+                    if (error.isEmpty()) error = db.lastError().text();
+                    db.rollback();
+                }
+            } else if (error.isEmpty()) {
+                error = db.lastError().text();
+            }
+        }
+        if (status != 0) out << "Rebuild failed: " << error << "\n";
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("rebuild_stats");
+    return status;
+}
+
+// Headless "--backup [database]": takes a verified snapshot now, keeping as
+// many as TICTACTOE_BACKUP says (see dbbackup.h).
+static int runBackup(int argc, char *argv[], const QString &path) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    int intervalMs = 0;
+    int keep = 0;
+    DbBackup::scheduleFromString(qEnvironmentVariable("TICTACTOE_BACKUP"), &intervalMs, &keep);
+    QString snapshotPath;
+    QString error;
+    if (!DbBackup::snapshot(path, keep, &snapshotPath, &error)) {
+        out << "Backup failed: " << error << "\n";
+        return 1;
+    }
+    out << "Snapshot written to " << snapshotPath << " (keeping the newest " << keep << ")\n";
+    return 0;
+}
+
+// Headless "--restore <snapshot|latest> [database]", with the game closed:
+// swaps in the snapshot after an integrity check.
+static int runRestore(int argc, char *argv[], QString snapshotPath, const QString &path) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    if (snapshotPath == "latest") {
+        const QStringList available = DbBackup::snapshots(path);
+        snapshotPath = available.isEmpty() ? QString() : available.last();
+    }
+    if (snapshotPath.isEmpty()) {
+        out << "Restore failed: no snapshot given or found in " << DbBackup::backupDirectory(path) << "\n";
+        return 1;
+    }
+    QString error;
+    if (!DbBackup::restore(snapshotPath, path, &error)) {
+        out << "Restore failed: " << error << "\n";
+        return 1;
+    }
+    out << "Restored " << path << " from " << snapshotPath << " (previous database kept as " << path << "-replaced)\n";
+    return 0;
+}
+
+// Headless "--export <file.jsonl|file.tttc> [database] [--user <name>]":
+// streams every match, or one player's, in id order (see matchexport.h).
+static int runExport(int argc, char *argv[], const QString &outputPath, const QString &path, const QString &user) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    MatchExport::Format format;
+    if (!MatchExport::formatForPath(outputPath, &format)) {
+        out << "Export failed: the output file must end in .jsonl or .tttc\n";
+        return 1;
+    }
+    int status = 1;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "export");
+        db.setDatabaseName(path);
+        QString error;
+        if (!QFileInfo::exists(path) || !db.open()) {
+            error = "cannot open " + path;
+        } else {
+            SchemaMigrator migrator(db);
+            TicTacToe::registerSchemaMigrations(migrator);
+            if (migrator.migrate(&error)) {
+                SqliteMatchStore store(db);
+                QSaveFile file(outputPath);
+                qint64 rows = 0;
+                QElapsedTimer timer;
+                timer.start();
+                if (!file.open(QIODevice::WriteOnly)) {
+                    error = file.errorString();
+                } else if (MatchExport::write(store, user, format, &file, &rows, &error) && file.commit()) {
+                    out << "Exported " << rows << " matches to " << outputPath << " in " << timer.elapsed() << " ms\n";
+                    status = 0;
+                } else if (error.isEmpty()) {
+                    error = file.errorString();
+                }
+            }
+        }
+        if (status != 0) out << "Export failed: " << error << "\n";
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("export");
+    return status;
+}
+
+// Headless "--import <archive.jsonl|.csv|.tttc> [database]": checks and
+// inserts the games, resuming where an earlier import of the file stopped.
+static int runImport(int argc, char *argv[], const QString &archivePath, const QString &path) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    int status = 1;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "import");
+        db.setDatabaseName(path);
+        QString error;
+        if (!db.open()) {
+            error = "cannot open " + path;
+        } else {
+            QSqlQuery(db).exec("PRAGMA foreign_keys = ON");
+            StorageProfile::byName(qEnvironmentVariable("TICTACTOE_DB_PROFILE", "balanced")).apply(db);
+            SchemaMigrator migrator(db);
+            TicTacToe::registerSchemaMigrations(migrator);
+            if (migrator.migrate(&error)) {
+                MatchImport import(db, archivePath);
+                import.setProgressCallback([&out](const MatchImport::Progress &progress) {
+                    out << "\r" << progress.imported << " imported, " << progress.rejected << " rejected";
+                    if (progress.elapsedMs > 0) out << " (" << progress.importedThisRun * 1000 / progress.elapsedMs << " games/s)";
+                    out.flush();
+                });
+                if (import.run(&error)) {
+                    const MatchImport::Progress &done = import.progress();
+                    out << "\nImported " << done.importedThisRun << " games in " << done.elapsedMs << " ms ("
+                        << done.imported << " imported, " << done.rejected << " rejected in total)\n";
+                    for (const QString &reason : import.rejections()) out << "  rejected " << reason << "\n";
+                    status = 0;
+                }
+            }
+        }
+        if (status != 0) out << "\nImport failed: " << error << "\n";
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("import");
+    return status;
+}
+
+// Headless "--archive <days> [database]": one full retention pass, moving
+// games older than <days> into the compressed archive (see matcharchive.h).
+static int runArchive(int argc, char *argv[], int retentionDays, const QString &path) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    if (retentionDays <= 0) {
+        out << "Archive failed: give the retention period in days\n";
+        return 1;
+    }
+    int status = 1;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "archive");
+        db.setDatabaseName(path);
+        QString error;
+        if (!QFileInfo::exists(path) || !db.open()) {
+            error = "cannot open " + path;
+        } else {
+            QSqlQuery(db).exec("PRAGMA foreign_keys = ON");
+            SchemaMigrator migrator(db);
+            TicTacToe::registerSchemaMigrations(migrator);
+            if (migrator.migrate(&error)) {
+                const qint64 cutoff = MatchArchive::cutoffFor(retentionDays);
+                QElapsedTimer timer;
+                timer.start();
+                qint64 total = 0;
+                int moved = 0;
+                while ((moved = MatchArchive::archiveBatch(db, cutoff, MatchArchive::DefaultBatchRows, &error)) > 0) {
+                    total += moved;
+                }
+                if (moved == 0) {
+                    out << "Archived " << total << " games played before " << timestampText(cutoff) << " in " << timer.elapsed() << " ms\n";
+                    status = 0;
+                }
+            }
+        }
+        if (status != 0) out << "Archive failed: " << error << "\n";
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("archive");
+    return status;
+}
 
 int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (QString(argv[i]) == "--perft") {
+            int depth = (i + 1 < argc) ? QString(argv[i + 1]).toInt() : 9;
+            return runPerft(depth > 0 ? depth : 9);
+        }
+        if (QString(argv[i]) == "--rebuild-stats") {
+            return runRebuildStats(argc, argv, (i + 1 < argc) ? QString(argv[i + 1]) : QString("tictactoe.db"));
+        }
+        if (QString(argv[i]) == "--export") {
+            QStringList rest;
+            QString user;
+            for (int j = i + 1; j < argc; ++j) {
+                if (QString(argv[j]) == "--user" && j + 1 < argc) user = QString(argv[++j]);
+                else rest << QString(argv[j]);
+            }
+            return runExport(argc, argv, rest.value(0), rest.value(1, "tictactoe.db"), user);
+        }
+        if (QString(argv[i]) == "--import") {
+            return runImport(argc, argv, (i + 1 < argc) ? QString(argv[i + 1]) : QString(),
+                             (i + 2 < argc) ? QString(argv[i + 2]) : QString("tictactoe.db"));
+        }
+        if (QString(argv[i]) == "--archive") {
+            return runArchive(argc, argv, (i + 1 < argc) ? QString(argv[i + 1]).toInt() : 0,
+                              (i + 2 < argc) ? QString(argv[i + 2]) : QString("tictactoe.db"));
+        }
+        if (QString(argv[i]) == "--backup") {
+            return runBackup(argc, argv, (i + 1 < argc) ? QString(argv[i + 1]) : QString("tictactoe.db"));
+        }
+        if (QString(argv[i]) == "--restore") {
+            return runRestore(argc, argv, (i + 1 < argc) ? QString(argv[i + 1]) : QString(),
+                              (i + 2 < argc) ? QString(argv[i + 2]) : QString("tictactoe.db"));
+        }
+    }
+
     QApplication app(argc, argv);
     TicTacToe game;
     game.resize(600, 700);
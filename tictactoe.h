@@ -10,11 +10,14 @@
 #include <QSpinBox>
 #include <QTextEdit>
 #include <QTableWidget>
+#include <QTableView>
 #include <QHeaderView>
 #include <QSqlDatabase>   // SQL
 #include <QSqlQuery>      // SQL
 #include <vector>
 #include <QComboBox>
+#include <QCheckBox>
+#include <QDateEdit>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
@@ -35,6 +38,25 @@
 #include <QCryptographicHash>
 #include <QByteArray>
 #include <QRandomGenerator>
+#include <QFuture>
+#include "connectionmanager.h"
+#include "dbbackup.h"
+#include "dbwriter.h"
+#include "gamebody.h"
+#include "gamejournal.h"
+#include "leaderboard.h"
+#include "matcharchive.h"
+#include "matchexport.h"
+#include "matchhistorymodel.h"
+#include "matchlogstore.h"
+#include "memorymatchstore.h"
+#include "memoryuserstore.h"
+#include "openingtrie.h"
+#include "schemamigrator.h"
+#include "sqlitematchstore.h"
+#include "sqliteuserstore.h"
+#include "storagemetrics.h"
+#include "timedstores.h"
 
 class TicTacToe : public QMainWindow {
     Q_OBJECT;
@@ -42,11 +64,26 @@ class TicTacToe : public QMainWindow {
 public:
      bool isTestRun = false; // <-- ADD THIS LINE
     explicit TicTacToe(QWidget *parent = nullptr);
+    ~TicTacToe() override;
 
     // ADD THESE TWO HELPER FUNCTIONS:...............................
     char getBoardState(int row, int col);
     char getCurrentPlayer();
 //........................................
+    // Perft: exhaustive game-tree enumeration (rules oracle + move generation benchmark)
+    struct PerftResult {
+        quint64 leaves = 0; // positions at the depth limit plus terminal positions
+        quint64 xWins = 0;
+        quint64 oWins = 0;
+        quint64 draws = 0;
+    };
+    static PerftResult perft(int depth, char startingPlayer = PLAYER1);
+    // Rules check for games from outside the app: empty if consistent, else why not
+    static QString checkRecordedGame(const MatchRecord &record);
+
+    // Schema (also used headless by main)
+    static void registerSchemaMigrations(SchemaMigrator &migrator);
+    static bool rebuildUserStats(QSqlDatabase &db, QString *error);
 private slots:
     void handleButtonClick(int index);
     void setPlayerVsPlayer();
@@ -62,8 +99,11 @@ private slots:
     void logout();
     void backToModeSelection();
     void toggleScoreboard();
+    void toggleOpeningExplorer();
     void handleSurrender();
     void deleteAccount();
+    void handleMatchWriteFailed(const QString &error);
+    void exportMatchHistory();
     //Q Test
     void setTestBoardState(const std::vector<char>& testBoard, char nextPlayer);
 private:
@@ -82,6 +122,7 @@ private:
     bool firstMoveMade = false;
     bool nightMode = false;
     bool scoreboardVisible = false;
+    bool explorerVisible = false;
     int totalGames = 3;
     int gamesToWin = 2;
     int player1Wins = 0;
@@ -106,6 +147,7 @@ private:
     char replayStartingPlayer;
     char gameStartingPlayer = PLAYER1; // Store starting player when game begins
     bool inReplayMode = false;
+    GameJournal gameJournal; // Series in progress, for resuming after a crash
     // UI elements
     QButtonGroup *buttonGroup;
     QLabel *statusLabel;
@@ -118,18 +160,52 @@ private:
     QLabel *scoreLabel;
     QPushButton *nightModeButton;
     QPushButton *scoreboardToggleButton;
+    QPushButton *explorerToggleButton;
+    QLabel *openingExplorerLabel;
     QTextEdit *matchHistoryTextEdit;
-    QTableWidget *matchHistoryTable;
+    QTableView *matchHistoryTable;
+    MatchHistoryModel *matchHistoryModel;
+    QLineEdit *historySearchEdit;
+    QLabel *historySearchStatus;
+    QTimer *historySearchTimer;
+    QCheckBox *historyRangeCheck;
+    QDateEdit *historyFromEdit;
+    QDateEdit *historyToEdit;
     QString selectedTheme = "Light"; // Default theme
     QComboBox *themeSelector;
-    QTableWidget *recordedMatchesTable;
+    QTableView *recordedMatchesTable;
+    MatchHistoryModel *recordedMatchesModel;
+    QTableWidget *leaderboardTable;
+    QLabel *leaderboardRankLabel;
+    Leaderboard leaderboard; // Loaded on first view, then updated per saved game
+    OpeningTrie openingTrie;
+    bool openingSnapshotValid = true; // False once a counted game failed to reach the database
     // Database
-    QSqlDatabase db;
+    ConnectionManager *connections = nullptr; // Per-thread connections to tictactoe.db
+    QSqlDatabase db; // The GUI thread's
+    DbWriter *dbWriter = nullptr; // Write-behind queue (file-backed databases only)
+    DbBackup *dbBackup = nullptr; // Scheduled snapshots (file-backed databases only)
+    MatchArchive *matchArchive = nullptr; // Retention tiering (file-backed databases, opt-in)
+    MatchStore *matchStore = nullptr; // Where finished games are kept, see openStores()
+    UserStore *userStore = nullptr;
+    StorageProfile storageProfile;
+    SchemaMigrator *schemaMigrator = nullptr;
+    QFuture<void> matchExport; // Background export on its own connection, see exportMatchHistory()
     // DB Methods
     void connectToDatabase(const QString& connectionName = QSqlDatabase::defaultConnection);
     void createTablesIfNeeded();
     void saveMatchResult(const QString &winner, const QString &result);
+    void startDbWriter();
+    void startDbBackup();
+    void startMatchArchive();
+    void openStores();
+    void queueMatchRecord(const MatchRecord &record);
+    void flushPendingWrites();
     void loadMatchHistory();
+    void loadLeaderboard();
+    void loadOpeningTrie();
+    void saveOpeningTrie();
+    void updateOpeningExplorer();
     QString pbkdf2Hash(const QString &password, const QByteArray &salt, int iterations, int dkLen);
     QByteArray generateSalt(int length);
     // Game Methods
@@ -148,8 +224,9 @@ private:
     // In tictactoe.h
     // ...
     int minimax(std::vector<char> &tempBoard, bool isMaximizing);
-    bool checkWin(char player, const std::vector<char>& targetBoard); // <-- MODIFIED
-    bool checkTie(const std::vector<char>& targetBoard);             // <-- MODIFIED
+    static bool checkWin(char player, const std::vector<char>& targetBoard); // <-- MODIFIED
+    static bool checkTie(const std::vector<char>& targetBoard);             // <-- MODIFIED
+    static void perftRecursive(std::vector<char> &tempBoard, char player, int depth, PerftResult &result);
     bool isMatchUnfinished();
     // ...
     void loadRecordedMatchesScreen();
@@ -158,6 +235,11 @@ private:
     void saveIndividualGameWithNumber(const QString &winner, const QString &result, int gameNumber);
     void handleSeriesEnd();
     void resetGameState();
+    // Game journal
+    void openGameJournal();
+    void journalSeries(bool betweenGames);
+    void offerResume();
+    void resumeFromJournal(const GameJournal::State &state);
 };
 
 #endif // TICTACTOE_H
@@ -0,0 +1,71 @@
+#include "timedstores.h"
+#include "storagemetrics.h"
+
+bool TimedUserStore::findUser(const QString &username, UserAccount *account, bool *found, QString *error) {
+    StorageMetrics::Timer timer("login lookup");
+    return store->findUser(username, account, found, error);
+}
+
+bool TimedUserStore::addUser(const QString &username, const QString &passwordHash, const QString &salt,
+                             qint64 *id, QString *error) {
+    StorageMetrics::Timer timer("register");
+    return store->addUser(username, passwordHash, salt, id, error);
+}
+
+bool TimedUserStore::removeUser(const QString &username, QString *error) {
+    StorageMetrics::Timer timer("account deletion");
+    return store->removeUser(username, error);
+}
+
+bool TimedUserStore::standings(QVector<UserStanding> *users, QString *error) {
+    StorageMetrics::Timer timer("standings");
+    return store->standings(users, error);
+}
+
+void TimedUserStore::recordGame(const MatchRecord &record) {
+    StorageMetrics::Timer timer("record game");
+    store->recordGame(record);
+}
+
+// With the write-behind queue this is the enqueue (and any back-pressure
+// wait); the commit itself is timed on the writer thread as "commit batch".
+bool TimedMatchStore::append(const MatchRecord &record, QString *error) {
+    StorageMetrics::Timer timer("save game");
+    return store->append(record, error);
+}
+
+void TimedMatchStore::flush() {
+    StorageMetrics::Timer timer("flush");
+    store->flush();
+}
+
+bool TimedMatchStore::historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                                  QVector<MatchSummary> *page, QString *error) {
+    StorageMetrics::Timer timer(filter.hasFacets() ? "history search" : "history load");
+    return store->historyPage(user, filter, after, limit, page, error);
+}
+
+bool TimedMatchStore::loadMatch(qint64 id, MatchRecord *record, QString *error) {
+    StorageMetrics::Timer timer("replay load");
+    return store->loadMatch(id, record, error);
+}
+
+bool TimedMatchStore::removeUserMatches(const QString &user, QString *error) {
+    StorageMetrics::Timer timer("account deletion (matches)");
+    return store->removeUserMatches(user, error);
+}
+
+bool TimedMatchStore::scan(qint64 afterId, const Visitor &visit, QString *error) {
+    StorageMetrics::Timer timer("scan");
+    return store->scan(afterId, visit, error);
+}
+
+bool TimedMatchStore::scanUser(const QString &user, const Visitor &visit, QString *error) {
+    StorageMetrics::Timer timer("player scan");
+    return store->scanUser(user, visit, error);
+}
+
+qint64 TimedMatchStore::lastMatchId() {
+    StorageMetrics::Timer timer("last match id");
+    return store->lastMatchId();
+}
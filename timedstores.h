@@ -0,0 +1,50 @@
+#ifndef TIMEDSTORES_H
+#define TIMEDSTORES_H
+
+#include "matchstore.h"
+#include "userstore.h"
+
+// Wrap whichever backends openStores() picked and time every call into
+// StorageMetrics, one histogram per operation ("login lookup", "save
+// game", "history load", ...). They own the wrapped store.
+class TimedUserStore : public UserStore {
+public:
+    explicit TimedUserStore(UserStore *store) : store(store) {}
+    ~TimedUserStore() override { delete store; }
+
+    QString name() const override { return store->name(); }
+    bool findUser(const QString &username, UserAccount *account, bool *found, QString *error = nullptr) override;
+    bool addUser(const QString &username, const QString &passwordHash, const QString &salt,
+                 qint64 *id, QString *error = nullptr) override;
+    bool removeUser(const QString &username, QString *error = nullptr) override;
+    bool standings(QVector<UserStanding> *users, QString *error = nullptr) override;
+    void recordGame(const MatchRecord &record) override;
+
+private:
+    Q_DISABLE_COPY(TimedUserStore)
+    UserStore *store;
+};
+
+class TimedMatchStore : public MatchStore {
+public:
+    explicit TimedMatchStore(MatchStore *store) : store(store) {}
+    ~TimedMatchStore() override { delete store; }
+
+    QString name() const override { return store->name(); }
+    bool append(const MatchRecord &record, QString *error = nullptr) override;
+    void flush() override;
+    using MatchStore::historyPage;
+    bool historyPage(const QString &user, const HistoryFilter &filter, const MatchSummary *after, int limit,
+                     QVector<MatchSummary> *page, QString *error = nullptr) override;
+    bool loadMatch(qint64 id, MatchRecord *record, QString *error = nullptr) override;
+    bool removeUserMatches(const QString &user, QString *error = nullptr) override;
+    bool scan(qint64 afterId, const Visitor &visit, QString *error = nullptr) override;
+    bool scanUser(const QString &user, const Visitor &visit, QString *error = nullptr) override;
+    qint64 lastMatchId() override;
+
+private:
+    Q_DISABLE_COPY(TimedMatchStore)
+    MatchStore *store;
+};
+
+#endif // TIMEDSTORES_H
@@ -0,0 +1,44 @@
+#ifndef USERSTORE_H
+#define USERSTORE_H
+
+#include <QString>
+#include <QVector>
+#include "matchrecord.h"
+
+struct UserAccount {
+    qint64 id = 0;
+    QString username;
+    QString passwordHash; // PBKDF2, hex
+    QString salt;         // Hex
+};
+
+// A user's record for the leaderboard
+struct UserStanding {
+    qint64 id = 0;
+    QString username;
+    int wins = 0;
+    int losses = 0;
+    int ties = 0;
+};
+
+// Accounts and their win/loss counts. Like MatchStore, picked at startup
+// (see TicTacToe::openStores()); login, registration, account deletion and
+// the leaderboard only go through this interface.
+class UserStore {
+public:
+    virtual ~UserStore() = default;
+
+    virtual QString name() const = 0;
+    // *found is false (and the call succeeds) for an unknown name
+    virtual bool findUser(const QString &username, UserAccount *account, bool *found, QString *error = nullptr) = 0;
+    virtual bool addUser(const QString &username, const QString &passwordHash, const QString &salt,
+                         qint64 *id, QString *error = nullptr) = 0; // Fails if the name is taken
+    virtual bool removeUser(const QString &username, QString *error = nullptr) = 0;
+    virtual bool standings(QVector<UserStanding> *users, QString *error = nullptr) = 0;
+
+    // Called for every saved game; stores whose database doesn't derive
+    // the counts from the match rows update them here.
+    virtual void recordGame(const MatchRecord &) {}
+};
+
+#endif // USERSTORE_H